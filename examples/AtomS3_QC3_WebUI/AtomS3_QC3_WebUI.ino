@@ -24,11 +24,57 @@
  ********************/
 CRGB leds[NUM_LEDS];
 
-// ESP32_QC3ライブラリのインスタンスを作成
-ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+// 再起動時に前回の出力ON/OFFも復元する場合はtrue
+#define RESTORE_OUTPUT false
+
+// ESP32_QC3ライブラリのインスタンスを作成（ピンはPinDefinitions.hで固定）
+QC3Port qc3;
 
 // グローバル変数の宣言（WebUI.hでexternとして宣言済み）
 
+// 充電器検出の完了通知
+void onDetectComplete(uint8_t hostType, void *arg) {
+  (void)arg;
+  Serial.print("Charger type: ");
+
+  switch(hostType){
+  case ESP32_QC3_CTL::BC_NA:
+    Serial.println("No charging port");
+    break;
+  case ESP32_QC3_CTL::BC_DCP:
+    Serial.println("USB BC1.2 DCP");
+    break;
+  case ESP32_QC3_CTL::QC3:
+    Serial.println("QC3.0");
+    if (qc3.isResumed()) {
+      // 前回の電圧（NVSに保存済み）へ復帰済み
+      Serial.printf("Resumed: %u mV\n", qc3.getVarTarget());
+    } else {
+      // 初期値は5Vに設定
+      qc3.set_VBUS(ESP32_QC3_CTL::QC_5V);
+    }
+    break;
+  default:
+    Serial.println("Unknown");
+    break;
+  }
+  isOn = qc3.getOutput();
+}
+
+// 充電器の抜き差し通知（制御タスクから呼ばれる）
+// 再接続後の検出結果はonDetectComplete()でも通知される
+void onHotplug(uint8_t event, uint8_t hostType, void *arg) {
+  (void)hostType;
+  (void)arg;
+  if (event == ESP32_QC3_CTL::HOTPLUG_EV_DETACH) {
+    // 切断時は出力OFF
+    Serial.println("Charger unplugged");
+    isOn = false;
+  } else if (event == ESP32_QC3_CTL::HOTPLUG_EV_ATTACH) {
+    Serial.println("Charger plugged in, re-detecting");
+  }
+}
+
 void setup() {
   pinMode(OUT_EN, INPUT_PULLDOWN);
   digitalWrite(OUT_EN, LOW);
@@ -48,45 +94,20 @@ void setup() {
 
   // QC3ライブラリの初期化
   qc3.begin();
-
-  // Chargerの種類を検出する
-  uint8_t HOST_TYPE = qc3.detect_Charger();
-
-  Serial.print("Charger type: ");
-
-  switch(HOST_TYPE){
-  case ESP32_QC3_CTL::BC_NA:
-    Serial.println("No charging port");
-    // NAの時はLEDを黄色にする
-    leds[0] = CRGB::Yellow;
-    FastLED.show();
-    delay(10);
-    break;
-  case ESP32_QC3_CTL::BC_DCP:
-    Serial.println("USB BC1.2 DCP");
-    // BC_DCPの時はLEDを橙色にする
-    leds[0] = CRGB::Orange;
-    FastLED.show();
-    delay(10);
-    break;
-  case ESP32_QC3_CTL::QC3:
-    Serial.println("QC3.0");
-    // QC3の時はLEDを赤にする
-    leds[0] = CRGB::Red;
-    FastLED.show();
-    delay(10);
-    // 初期値は5Vに設定
-    qc3.set_VBUS(ESP32_QC3_CTL::QC_5V);
-    delay(100);
-    break;
-  default:
-    Serial.println("Unknown");
-    // 不明の時はLEDを黄色にする
-    leds[0] = CRGB::Yellow;
-    FastLED.show();
-    delay(10);
-    break;
-  }
+  // VBUS_DETの抵抗分割: 100kΩ / 15kΩ
+  qc3.setVbusDividerRatio(7.67f);
+
+  // Chargerの種類を検出する（完了はonDetectComplete()で通知）
+  // 検出・パルス出力・計測・NVSへの自動保存は制御タスク(コア0, 10ms周期)が行い、
+  // loop()のHTTPハンドラとボタンはコマンドを投入するだけで待たない
+  // 前回QC3だった場合はClass B判定を省略して前回の電圧へ復帰する
+  qc3.setDetectCallback(onDetectComplete);
+  qc3.setAutoSave(true);
+  qc3.startResume(RESTORE_OUTPUT);
+  // 充電器を抜き差しした場合は切断前の電圧へ再検出・復帰する
+  qc3.setHotplugCallback(onHotplug);
+  qc3.setHotplugMonitor(true, RESTORE_OUTPUT);
+  qc3.startControlTask(0, 5, 10);
 
   // WebUIのセットアップ
   setupWebUI();
@@ -95,15 +116,20 @@ void setup() {
 void loop() {
   M5.update();
   if (M5.BtnA.wasPressed()) {
-    isOn = !isOn;
-    digitalWrite(OUT_EN, isOn ? HIGH : LOW);
+    applyOutput(!isOn);
     Serial.println("Button toggle: " + String(isOn ? "ON" : "OFF"));
   }
 
-  server.handleClient();
+  // HTTPの処理とテレメトリ(/events)の送信
+  handleWebUI();
 
-  // ON/OFF状態に応じてLEDを制御
-  if(isOn == true){
+  // ON/OFF状態に応じてLEDを制御（検出中は青、完了後はDETECT_DONEのまま）
+  ESP32_QC3_CTL::Snapshot snap;
+  const bool detecting = !qc3.getSnapshot(&snap) ||
+    ((snap.detect_state != ESP32_QC3_CTL::DETECT_IDLE) && (snap.detect_state != ESP32_QC3_CTL::DETECT_DONE));
+  if(detecting){
+    leds[0] = CRGB::Blue;
+  }else if(isOn == true){
     leds[0] = CRGB::Green;
   }else{
     leds[0] = CRGB::Red;
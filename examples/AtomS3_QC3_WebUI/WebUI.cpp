@@ -8,7 +8,163 @@ const char* password = "01234567"; // パスワード（8文字以上）
 // グローバル変数の定義
 WebServer server(80);
 bool isOn = false;    // ON/OFF状態のフラグ
-bool isQcVal = false; // 連続モードフラグ
+
+// テレメトリ（Server-Sent Events）の接続先と送信周期
+static WiFiClient telemetryClients[TELEMETRY_MAX_CLIENTS];
+static uint16_t telemetryIntervalMs = TELEMETRY_INTERVAL_MS;
+static uint32_t lastTelemetryMs = 0;
+
+// 動的な応答（API）はキャッシュさせない
+static void sendNoStore(int code, const char *type, const String &body) {
+  server.sendHeader("Cache-Control", "no-store");
+  server.send(code, type, body);
+}
+
+// 制御タスクが公開した最新の状態を取得（未公開の間は検出前の状態を返す）
+static ESP32_QC3_CTL::Snapshot readSnapshot() {
+  ESP32_QC3_CTL::Snapshot snap;
+  if (!qc3.getSnapshot(&snap)) {
+    memset(&snap, 0, sizeof(snap));
+  }
+  return snap;
+}
+
+// 接続中の全クライアントへ1フレーム送信
+// data: {"v":VBUS(mV),"i":電流(mA),"m":電圧モード,"o":出力ON/OFF,"b":Class B,"c":実行済みコマンドID}
+static void sendTelemetry() {
+  bool any = false;
+  for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+    any = any || telemetryClients[i].connected();
+  }
+  if (!any) {
+    return;
+  }
+
+  const ESP32_QC3_CTL::Snapshot snap = readSnapshot();
+  char frame[112];
+  const int len = snprintf(frame, sizeof(frame),
+    "data: {\"v\":%u,\"i\":%ld,\"m\":%u,\"o\":%u,\"b\":%u,\"c\":%lu}\n\n",
+    (unsigned)snap.vbus_mV, (long)snap.current_mA, (unsigned)snap.qc_mode,
+    snap.output ? 1U : 0U, snap.class_b ? 1U : 0U, (unsigned long)snap.last_cmd_id);
+  if ((len <= 0) || (len >= (int)sizeof(frame))) {
+    return;
+  }
+  for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+    if (!telemetryClients[i].connected()) {
+      continue;
+    }
+    // 送信できない（切断・輻輳）クライアントは閉じる。ブラウザ側が自動で再接続する
+    if (telemetryClients[i].write((const uint8_t *)frame, len) != (size_t)len) {
+      telemetryClients[i].stop();
+    }
+  }
+}
+
+// 出力ON/OFFの切り替え（/toggle, /api/cmd, 本体ボタン共通）
+uint32_t applyOutput(bool on) {
+  const uint32_t id = qc3.postCommand(ESP32_QC3_CTL::CMD_OUTPUT, on ? 1 : 0);
+  if (id != 0U) {
+    isOn = on;
+  }
+  return id;
+}
+
+// 全状態をJSONで送信
+static void sendStatusJson() {
+  const ESP32_QC3_CTL::Snapshot snap = readSnapshot();
+  char json[288];
+  const int len = snprintf(json, sizeof(json),
+    "{\"host\":%u,\"detecting\":%s,\"mode\":%u,\"class_b\":%s,\"output\":%s,"
+    "\"voltage\":%u,\"target\":%u,\"var_busy\":%s,\"vbus\":%u,\"current\":%ld,"
+    "\"last_cmd\":%lu}",
+    (unsigned)snap.host_type,
+    ((snap.detect_state != ESP32_QC3_CTL::DETECT_IDLE) &&
+     (snap.detect_state != ESP32_QC3_CTL::DETECT_DONE)) ? "true" : "false",
+    (unsigned)snap.qc_mode, snap.class_b ? "true" : "false", snap.output ? "true" : "false",
+    (unsigned)snap.voltage, (unsigned)snap.var_target, snap.var_busy ? "true" : "false",
+    (unsigned)snap.vbus_mV, (long)snap.current_mA, (unsigned long)snap.last_cmd_id);
+  if ((len <= 0) || (len >= (int)sizeof(json))) {
+    sendNoStore(500, "application/json", "{\"error\":\"status\"}");
+    return;
+  }
+  sendNoStore(200, "application/json", json);
+}
+
+// コマンドIDの応答（0: キューが満杯）
+static void sendCommandId(uint32_t id) {
+  if (id == 0U) {
+    sendNoStore(503, "text/plain", "Busy");
+    return;
+  }
+  sendNoStore(200, "text/plain", String(id));
+}
+
+// 固定電圧の指定値(V)を電圧モードへ変換
+static int8_t fixedModeOf(const String &value) {
+  if (value == "5") {
+    return ESP32_QC3_CTL::QC_5V;
+  } else if (value == "9") {
+    return ESP32_QC3_CTL::QC_9V;
+  } else if (value == "12") {
+    return ESP32_QC3_CTL::QC_12V;
+  } else if (value == "20") {
+    return ESP32_QC3_CTL::QC_20V;
+  }
+  return -1;
+}
+
+// /api/cmdの1コマンドを変換
+// mode=5|9|12|20 : 固定電圧
+// mv=5000～    : 可変モードの目標電圧（200mV単位に丸め）
+// step=±n      : 可変モードで±n×200mV
+// output=on|off : 出力ON/OFF
+// 戻り値: true（正常）/false（不正）
+static bool parseCommand(const String &name, const String &value, ESP32_QC3_CTL::Command *cmd) {
+  if (name == "mode") {
+    const int8_t mode = fixedModeOf(value);
+    if (mode < 0) {
+      return false;
+    }
+    cmd->type = ESP32_QC3_CTL::CMD_SET_MODE;
+    cmd->value = mode;
+    return true;
+  }
+  if ((name == "mv") || (name == "step")) {
+    const long v = value.toInt();
+    if ((v == 0) && (value != "0")) {
+      return false;
+    }
+    if (name == "step") {
+      cmd->type = ESP32_QC3_CTL::CMD_VAR_STEP;
+      cmd->value = (int32_t)(v * 200L);
+    } else {
+      cmd->type = ESP32_QC3_CTL::CMD_SET_VAR;
+      cmd->value = (int32_t)constrain(v, 0L, 20000L);
+    }
+    return true;
+  }
+  if (name == "output") {
+    if ((value != "on") && (value != "off")) {
+      return false;
+    }
+    cmd->type = ESP32_QC3_CTL::CMD_OUTPUT;
+    cmd->value = (value == "on") ? 1 : 0;
+    return true;
+  }
+  return false;
+}
+
+// 1コマンドの投入（戻り値はコマンドID、0: 不正またはキューが満杯）
+static uint32_t runCommand(const String &name, const String &value) {
+  ESP32_QC3_CTL::Command cmd;
+  if (!parseCommand(name, value, &cmd)) {
+    return 0U;
+  }
+  if (cmd.type == ESP32_QC3_CTL::CMD_OUTPUT) {
+    return applyOutput(cmd.value != 0);
+  }
+  return qc3.postCommand(cmd.type, cmd.value);
+}
 
 void setupWebUI() {
   // アクセスポイントを開始
@@ -27,126 +183,175 @@ void setupWebUI() {
   Serial.print("IP Address: ");
   Serial.println(WiFi.softAPIP()); // アクセスポイントのIPアドレスを表示
 
-  // HTMLページを表示
+  // HTMLページを表示（gzip圧縮済みをフラッシュから直接送信）
+  // ETagが一致すれば304を返し、ページ本体は再送しない
   server.on("/", HTTP_GET, [](){
     Serial.println("HTTP GET / ");
-    server.sendHeader("Cache-Control", "no-store, no-cache, must-revalidate, max-age=0");
-    server.sendHeader("Pragma", "no-cache");
-    server.sendHeader("Expires", "0");
-    server.send(200, "text/html", htmlPage);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", HTML_PAGE_GZ_ETAG);
+    if (server.header("If-None-Match") == HTML_PAGE_GZ_ETAG) {
+      server.send(304);
+      return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, "text/html", (const char *)htmlPageGz, htmlPageGzLen);
   });
 
+  // テレメトリの配信（Server-Sent Events）
+  // /events?interval=ms で送信周期を変更（50～2000ms, 全クライアント共通）
+  server.on("/events", HTTP_GET, [](){
+    Serial.println("HTTP GET /events");
+    int8_t slot = -1;
+    for (uint8_t i = 0; i < TELEMETRY_MAX_CLIENTS; i++) {
+      if (!telemetryClients[i].connected()) {
+        slot = i;
+        break;
+      }
+    }
+    if (slot < 0) {
+      sendNoStore(503, "text/plain", "Busy");
+      return;
+    }
+    if (server.hasArg("interval")) {
+      const long interval = server.arg("interval").toInt();
+      telemetryIntervalMs = (uint16_t)constrain(interval, 50L, 2000L);
+    }
+    // レスポンスヘッダのみ返し、接続を保持してloop()側から送信する
+    WiFiClient client = server.client();
+    client.setNoDelay(true);
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/event-stream\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\n\r\n"
+                 "retry: 1000\n\n");
+    telemetryClients[slot] = client;
+    lastTelemetryMs = millis() - telemetryIntervalMs;  // 接続直後に1フレーム送る
+  });
+
+  // 以下の操作系ハンドラは制御タスクへコマンドを投入して即座に応答する
+  // 応答はコマンドID。実行結果は/api/statusのlast_cmd、/eventsの"c"で確認できる
+
   // 電圧変更を処理
   server.on("/voltage", HTTP_GET, [](){
     Serial.println("HTTP GET /voltage");
-    if (server.hasArg("value")) {
-      const String value = server.arg("value");
-      Serial.print("  value=");
-      Serial.println(value);
-      // 連続モードの場合は一旦5Vに設定
-      if(isQcVal == true){
-        qc3.set_VBUS(ESP32_QC3_CTL::QC_5V);
-        isQcVal = false;
-        delay(100);
-      }
-
-      // 出力電圧設定
-      if(value == "5"){
-        qc3.set_VBUS(ESP32_QC3_CTL::QC_5V);
-      }else if(value == "9"){
-        qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
-      }else if(value == "12"){
-        qc3.set_VBUS(ESP32_QC3_CTL::QC_12V);
-      }else if(value == "20"){
-        qc3.set_VBUS(ESP32_QC3_CTL::QC_20V);
-      }
-      Serial.print("Voltage set to: ");
-      Serial.print(qc3.getVoltage());
-      Serial.println("mV");
-      delay(100);
+    if (!server.hasArg("value")) {
+      sendNoStore(400, "text/plain", "Bad Request");
+      return;
     }
-    server.send(200, "text/plain", "OK");
+    sendCommandId(runCommand("mode", server.arg("value")));
   });
 
-  // 連続モードの処理
+  // 連続モードの処理（可変モードへの移行とパルス出力は制御タスクが行う）
   server.on("/offset", HTTP_GET, [](){
     Serial.println("HTTP GET /offset");
-    if (server.hasArg("value")) {
-      //連続モードへ切り替え
-      qc3.set_VBUS(ESP32_QC3_CTL::QC_VAR);
-      delay(100);
-      //連続モードフラグをセット
-      isQcVal = true;
-      Serial.println("<Continuous mode>");
-
-      const String value = server.arg("value");
-      Serial.print("  value=");
-      Serial.println(value);
-      if(value == "200"){
-        qc3.var_inc();
-      }else if(value == "-200"){
-        qc3.var_dec();
-      }
-      Serial.print("Offset: " + value + " mV");
-      Serial.print("Voltage set to: ");
-      Serial.print(qc3.getVoltage());
-      Serial.println("mV");
-      delay(100);
+    const String value = server.hasArg("value") ? server.arg("value") : String();
+    if (value == "200") {
+      sendCommandId(runCommand("step", "1"));
+    } else if (value == "-200") {
+      sendCommandId(runCommand("step", "-1"));
+    } else {
+      sendNoStore(400, "text/plain", "Bad Request");
     }
-    server.send(200, "text/plain", "OK");
   });
 
   // ON/OFF切り替えを処理
   server.on("/toggle", HTTP_GET, [](){
     Serial.println("HTTP GET /toggle");
-    if (server.hasArg("state")) {
-      const String state = server.arg("state");
-      Serial.print("  state=");
-      Serial.println(state);
-      isOn = (state == "on");
-      if(isOn == true){
-        digitalWrite(OUT_EN, HIGH);
-      }else{
-        digitalWrite(OUT_EN, LOW);
-      }
-      Serial.println("Output " + String(isOn ? "ON" : "OFF"));
+    if (!server.hasArg("state")) {
+      sendNoStore(400, "text/plain", "Bad Request");
+      return;
     }
-    server.send(200, "text/plain", "OK");
+    sendCommandId(runCommand("output", server.arg("state")));
   });
 
   // 現在のON/OFF状態をUIに送信
   server.on("/state", HTTP_GET, [](){
     Serial.println("HTTP GET /state");
-    server.send(200, "text/plain", isOn ? "on" : "off");
+    sendNoStore(200, "text/plain", readSnapshot().output ? "on" : "off");
   });
 
   // 現在の電圧値を測定しUIに送信
   server.on("/current", HTTP_GET, [](){
     Serial.println("HTTP GET /current");
-    const float vbusDetV = qc3.readVoltage((uint8_t)VBUS_DET);
-    const float vbusDetMv = vbusDetV * 1000.0f;
-    // 抵抗分割: 100kΩ / 15kΩ
-    const float VBUS_DIVIDER_RATIO = 7.67f;
-    const uint32_t vbusMv = (uint32_t)(vbusDetMv * VBUS_DIVIDER_RATIO);
-    const String currentValue = String((uint32_t)vbusMv);
-    Serial.println("Output: " + currentValue);
-    server.send(200, "text/plain", currentValue);
+    // 分圧比はsetup()でsetVbusDividerRatio()により設定済み
+    sendNoStore(200, "text/plain", String((uint32_t)readSnapshot().vbus_mV));
   });
 
   // _use_class_bの値をUIに送信
   server.on("/use_class_b", HTTP_GET, [](){
     Serial.println("HTTP GET /use_class_b");
-    const String useClassBValue = qc3.getUseClassB() ? "true" : "false";
-    server.send(200, "text/plain", useClassBValue);
+    const String useClassBValue = readSnapshot().class_b ? "true" : "false";
+    sendNoStore(200, "text/plain", useClassBValue);
+  });
+
+  // 全状態をJSONで取得
+  server.on("/api/status", HTTP_GET, [](){
+    sendStatusJson();
+  });
+
+  // 複数コマンドを1回で投入（例: /api/cmd?mv=9000&output=on）
+  // 全コマンドを検証してから指定順に一括投入し、1つでも不正なら何も投入しない
+  // キューの空きが足りなければ何も投入せず503を返す。投入したコマンドは同じupdate()で続けて実行される
+  // 応答は最後のコマンドID（{"id":N}）
+  server.on("/api/cmd", HTTP_ANY, [](){
+    Serial.println("HTTP /api/cmd");
+    const int n = server.args();
+    ESP32_QC3_CTL::Command cmds[WEBUI_MAX_BATCH];
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+      if (server.argName(i) == "plain") {
+        continue;  // POSTの本文
+      }
+      if (count >= WEBUI_MAX_BATCH) {
+        sendNoStore(400, "application/json", "{\"error\":\"count\"}");
+        return;
+      }
+      if (!parseCommand(server.argName(i), server.arg(i), &cmds[count])) {
+        sendNoStore(400, "application/json", "{\"error\":\"" + server.argName(i) + "\"}");
+        return;
+      }
+      count++;
+    }
+    if (count == 0) {
+      sendNoStore(400, "application/json", "{\"error\":\"count\"}");
+      return;
+    }
+    const uint32_t id = qc3.postCommands(cmds, (uint8_t)count);
+    if (id == 0U) {
+      sendNoStore(503, "application/json", "{\"error\":\"busy\"}");
+      return;
+    }
+    // 出力の要求状態は投入に成功した場合のみ反映する
+    for (int i = 0; i < count; i++) {
+      if (cmds[i].type == ESP32_QC3_CTL::CMD_OUTPUT) {
+        isOn = (cmds[i].value != 0);
+      }
+    }
+    sendNoStore(200, "application/json", "{\"id\":" + String(id) + "}");
   });
 
   server.onNotFound([](){
     Serial.print("HTTP 404 ");
     Serial.println(server.uri());
-    server.send(404, "text/plain", "Not Found");
+    sendNoStore(404, "text/plain", "Not Found");
   });
 
+  // ETagの照合に使うリクエストヘッダ
+  static const char *headerKeys[] = { "If-None-Match" };
+  server.collectHeaders(headerKeys, 1);
+
   // サーバーを開始
   server.begin();
 }
  
+
+// HTTPリクエストの処理とテレメトリの送信（loop()から呼び出す）
+void handleWebUI() {
+  server.handleClient();
+
+  const uint32_t now = millis();
+  if ((uint32_t)(now - lastTelemetryMs) >= telemetryIntervalMs) {
+    lastTelemetryMs = now;
+    sendTelemetry();
+  }
+}
@@ -0,0 +1,154 @@
+// Generated by extras/tools/html2gz.py from data/index.html. Do not edit.
+// 5938 bytes -> 2230 bytes (gzip)
+#ifndef WEBUIPAGE_H
+#define WEBUIPAGE_H
+
+#include <Arduino.h>
+
+#define HTML_PAGE_GZ_ETAG "\"f4eb300c42cac7ca\""
+
+const size_t htmlPageGzLen = 2230;
+const uint8_t htmlPageGz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xb5, 0x58, 0xeb, 0x6f, 0xdb, 0xd6,
+  0x15, 0xff, 0xae, 0xbf, 0xe2, 0x86, 0x06, 0x2a, 0xb9, 0xb5, 0x44, 0x49, 0x7e, 0x20, 0xd1, 0xc3,
+  0x59, 0xe3, 0x3a, 0xad, 0xb7, 0x2e, 0xee, 0x12, 0x23, 0xd8, 0x3e, 0x0d, 0x57, 0xe4, 0x95, 0xc4,
+  0x85, 0x22, 0x35, 0xf2, 0x52, 0xb2, 0x97, 0x1a, 0x98, 0xa4, 0x36, 0x73, 0x1e, 0x5d, 0xb7, 0x6e,
+  0x69, 0x07, 0x34, 0x5b, 0x92, 0x61, 0x45, 0x81, 0x6d, 0x4d, 0x06, 0xac, 0xe8, 0x1e, 0x48, 0xe6,
+  0x3f, 0x86, 0x91, 0xd2, 0x7d, 0xea, 0xbf, 0xb0, 0x73, 0xee, 0xbd, 0xa4, 0x48, 0x59, 0x76, 0x92,
+  0x06, 0xf3, 0x07, 0x8a, 0x3a, 0xf7, 0x3c, 0x7e, 0xe7, 0x79, 0x8f, 0x55, 0x3b, 0xf5, 0xc6, 0xf6,
+  0xc6, 0xce, 0x8f, 0xde, 0xd9, 0x24, 0x6d, 0xde, 0xb1, 0xd7, 0x33, 0xb5, 0xe8, 0x83, 0x51, 0x13,
+  0x3e, 0x3a, 0x8c, 0x53, 0xe2, 0xd0, 0x0e, 0xab, 0x6b, 0x3d, 0x8b, 0xf5, 0xbb, 0xae, 0xc7, 0x35,
+  0x62, 0xb8, 0x0e, 0x67, 0x0e, 0xaf, 0x6b, 0x7d, 0xcb, 0xe4, 0xed, 0xba, 0xc9, 0x7a, 0x96, 0xc1,
+  0xf2, 0xe2, 0xcb, 0x12, 0xb1, 0x1c, 0x8b, 0x5b, 0xd4, 0xce, 0xfb, 0x06, 0xb5, 0x59, 0xbd, 0xa4,
+  0x11, 0x1d, 0xd4, 0x70, 0x8b, 0xdb, 0x6c, 0xfd, 0x07, 0x81, 0x65, 0x5c, 0xd9, 0x68, 0x53, 0xaf,
+  0xc5, 0xc8, 0x72, 0xa1, 0x48, 0x36, 0x40, 0x8f, 0xe7, 0xda, 0x35, 0x5d, 0x1e, 0x67, 0x6a, 0x3e,
+  0xdf, 0xc3, 0xcf, 0x86, 0x6b, 0xee, 0x91, 0xab, 0xa4, 0x09, 0xc7, 0xf9, 0x26, 0xed, 0x58, 0xf6,
+  0x5e, 0x85, 0xbc, 0xee, 0x81, 0xd2, 0x25, 0xe2, 0x53, 0xc7, 0xcf, 0xfb, 0xcc, 0xb3, 0x9a, 0x55,
+  0xc2, 0xd9, 0x2e, 0xcf, 0x53, 0xdb, 0x6a, 0x39, 0x15, 0x62, 0x00, 0x1e, 0xe6, 0x55, 0x49, 0x07,
+  0x94, 0x5b, 0xf0, 0xbd, 0x58, 0x25, 0x5d, 0x6a, 0x9a, 0x96, 0xd3, 0xaa, 0x90, 0x52, 0xb9, 0xbb,
+  0x5b, 0x95, 0xda, 0x7c, 0xeb, 0x67, 0x0c, 0x08, 0xa7, 0x91, 0xb0, 0x9f, 0x69, 0x97, 0xc0, 0x4a,
+  0x24, 0x81, 0x5c, 0x28, 0x96, 0xe0, 0x5b, 0x5e, 0x41, 0x3e, 0xdb, 0x72, 0x58, 0xbe, 0xcd, 0xac,
+  0x56, 0x9b, 0x03, 0x57, 0xa1, 0xb4, 0x5a, 0x25, 0x7d, 0xd7, 0x33, 0xf3, 0x0d, 0x8f, 0xd1, 0x2b,
+  0x15, 0x22, 0x3e, 0xf2, 0x48, 0x41, 0x95, 0x85, 0x46, 0xc0, 0xb9, 0xeb, 0xe4, 0x5b, 0x9e, 0x65,
+  0x82, 0x72, 0xd3, 0xf2, 0xbb, 0x36, 0x05, 0xf8, 0x4d, 0x9b, 0x21, 0x06, 0x78, 0xe6, 0xfb, 0x1e,
+  0xed, 0x56, 0x08, 0x3e, 0xab, 0xe4, 0x27, 0x81, 0xcf, 0xad, 0xe6, 0x5e, 0x5e, 0x45, 0x74, 0xea,
+  0x47, 0x0b, 0x79, 0x24, 0xf0, 0x18, 0x60, 0x51, 0x02, 0x8c, 0x8d, 0x80, 0xfe, 0xa9, 0x8f, 0x6b,
+  0x47, 0xd1, 0x0b, 0xe9, 0x06, 0x00, 0x63, 0x1e, 0x30, 0xc0, 0xb9, 0xef, 0xda, 0x80, 0x6a, 0xc1,
+  0x30, 0x8c, 0x88, 0x9e, 0xf7, 0xa8, 0x69, 0x05, 0x7e, 0x85, 0xac, 0x22, 0xaf, 0x11, 0x78, 0xbe,
+  0x0b, 0xbc, 0x5d, 0xd7, 0x92, 0x28, 0x1a, 0xd4, 0xb8, 0xd2, 0xf2, 0xdc, 0xc0, 0x31, 0x01, 0xa1,
+  0x8d, 0x47, 0x0b, 0xcd, 0x66, 0xd3, 0x34, 0x8b, 0x28, 0xbf, 0x8b, 0x76, 0x84, 0x71, 0xa5, 0x0b,
+  0x48, 0x88, 0x8e, 0x4e, 0xe1, 0xc5, 0xee, 0x5b, 0x8e, 0x88, 0x62, 0xc3, 0x76, 0x8d, 0x2b, 0x2a,
+  0x71, 0x26, 0x33, 0x5c, 0x8f, 0x72, 0xcb, 0x05, 0xd7, 0x1c, 0xd7, 0x61, 0x60, 0x5e, 0x9a, 0xb0,
+  0x9c, 0x36, 0xe4, 0x97, 0xa7, 0x1d, 0x15, 0xc5, 0x55, 0x21, 0x2b, 0xe5, 0x5e, 0x1f, 0x23, 0xb2,
+  0x9b, 0x57, 0x84, 0x72, 0xb1, 0x28, 0x62, 0x64, 0x39, 0x11, 0xa5, 0xb4, 0x52, 0x94, 0xd9, 0x55,
+  0xc2, 0x05, 0xa0, 0xb3, 0xa9, 0x86, 0xd3, 0xa7, 0x67, 0x34, 0xac, 0x94, 0x67, 0xf8, 0xb9, 0xdb,
+  0x6a, 0xd9, 0x09, 0x89, 0xb5, 0xe2, 0xac, 0xcd, 0xb5, 0xb4, 0x44, 0xa5, 0xed, 0xf6, 0x98, 0x07,
+  0x02, 0x27, 0x84, 0x0b, 0x98, 0xa1, 0x2a, 0xdc, 0x66, 0x73, 0x2e, 0x9b, 0xc7, 0xcc, 0xd8, 0xfd,
+  0x7e, 0xdb, 0xe2, 0x10, 0x8c, 0x7d, 0xa2, 0xbf, 0x4a, 0xc6, 0x07, 0xbf, 0x9f, 0xdc, 0xb9, 0xfb,
+  0xf4, 0xc6, 0x57, 0x93, 0xf7, 0x6f, 0x86, 0x83, 0x87, 0x4f, 0xff, 0xf1, 0x6b, 0xf2, 0xaa, 0x9e,
+  0x29, 0xf4, 0x5c, 0x9b, 0xd3, 0x16, 0xcb, 0xdb, 0xb4, 0xc1, 0xec, 0xa8, 0x51, 0x64, 0xd2, 0xcb,
+  0xaa, 0xb4, 0x63, 0x9e, 0x1e, 0xb5, 0x03, 0x96, 0xe6, 0x91, 0x65, 0xad, 0xcc, 0x35, 0xe0, 0x58,
+  0x95, 0x4d, 0x5f, 0xd5, 0x78, 0xc3, 0xb5, 0x45, 0x2d, 0x2f, 0xf8, 0x9c, 0xf2, 0xc0, 0x4f, 0x0b,
+  0x63, 0xa1, 0xc5, 0xc2, 0x0b, 0xcb, 0xcb, 0xcb, 0x51, 0x81, 0xe6, 0xb9, 0x0b, 0x25, 0xab, 0xcc,
+  0x7f, 0xa7, 0xc3, 0x4c, 0x8b, 0x92, 0x5c, 0x22, 0x2f, 0x6b, 0x98, 0xa9, 0x45, 0x72, 0x35, 0xea,
+  0xee, 0xb8, 0x74, 0xd3, 0x55, 0x5b, 0x5e, 0x49, 0xf4, 0x66, 0x82, 0xbe, 0x72, 0x3a, 0xd5, 0x0b,
+  0x6b, 0x47, 0x7b, 0xe1, 0x08, 0x73, 0x6c, 0xa1, 0xac, 0x3a, 0x27, 0xca, 0x9f, 0xcc, 0x78, 0x32,
+  0xa3, 0xe5, 0x13, 0x6b, 0x66, 0xe5, 0x88, 0xc0, 0x33, 0x8b, 0x46, 0xd5, 0xc8, 0xdc, 0xaa, 0x39,
+  0x21, 0x7d, 0x2b, 0xcf, 0x91, 0xbe, 0x88, 0x67, 0x6e, 0x7a, 0x64, 0xf8, 0x92, 0x19, 0x29, 0x29,
+  0xb3, 0xfb, 0x99, 0x9a, 0xae, 0xe6, 0x6b, 0x4d, 0x57, 0xd3, 0x1d, 0x53, 0x81, 0xb3, 0xbe, 0x74,
+  0xfc, 0x68, 0x86, 0xb3, 0x4c, 0xcd, 0xb4, 0x7a, 0xf0, 0x94, 0x78, 0x0d, 0x9b, 0xfa, 0x3e, 0xdc,
+  0x06, 0x49, 0x27, 0xb4, 0xf5, 0xed, 0x80, 0x77, 0x03, 0xa8, 0x9d, 0x9a, 0x2e, 0x08, 0x38, 0xcb,
+  0xbb, 0xd4, 0x21, 0x96, 0x59, 0xd7, 0x60, 0xaa, 0x78, 0x30, 0xd5, 0xb4, 0x59, 0x49, 0xe1, 0x9a,
+  0xb6, 0x5e, 0x04, 0x58, 0xc0, 0xfa, 0x0c, 0xfd, 0xa4, 0x73, 0x79, 0xaa, 0x5a, 0x97, 0x78, 0xe0,
+  0x29, 0x0c, 0xc8, 0x38, 0x68, 0xeb, 0x11, 0xbd, 0xe1, 0xa9, 0x43, 0xa5, 0x2a, 0x31, 0x92, 0x35,
+  0x38, 0xa1, 0x69, 0xba, 0x46, 0xda, 0x1e, 0x6b, 0xd6, 0x35, 0x5d, 0x59, 0x3c, 0x2b, 0x70, 0xd5,
+  0x57, 0x35, 0xe2, 0x3a, 0x86, 0x0d, 0x51, 0xa9, 0x6b, 0x56, 0x93, 0xe4, 0xf8, 0x5e, 0x97, 0xb9,
+  0x4d, 0xe2, 0x33, 0xc7, 0xbc, 0x2c, 0x19, 0x49, 0xbd, 0x5e, 0x27, 0xd9, 0x66, 0xe0, 0x18, 0x38,
+  0xc4, 0xb2, 0x50, 0xda, 0xc9, 0xd3, 0xdc, 0xea, 0x62, 0x15, 0xfa, 0x9a, 0x07, 0x9e, 0x43, 0x9a,
+  0xd4, 0xf6, 0xb1, 0xa5, 0xb5, 0xf5, 0x55, 0x02, 0x6e, 0xd0, 0xe7, 0x06, 0x71, 0xe6, 0x65, 0x41,
+  0x9c, 0x99, 0x07, 0xe2, 0xcc, 0x8b, 0x81, 0x28, 0x95, 0x5f, 0x16, 0x45, 0xa9, 0x3c, 0x0f, 0x46,
+  0xa9, 0xfc, 0x62, 0x38, 0xca, 0xc5, 0x97, 0xc5, 0x51, 0x2e, 0xce, 0xc1, 0x21, 0x4a, 0x48, 0x1a,
+  0x2e, 0x17, 0x2f, 0x6b, 0xeb, 0xe5, 0x62, 0x04, 0x2b, 0x51, 0x66, 0xcf, 0x55, 0x49, 0xd8, 0xfb,
+  0x2c, 0x06, 0x0f, 0xb3, 0xde, 0x67, 0x5c, 0x61, 0xcf, 0xc3, 0x3d, 0x75, 0x3c, 0xfa, 0x6d, 0xc1,
+  0x7a, 0x0c, 0x78, 0x79, 0x98, 0x43, 0x0d, 0xf3, 0xa2, 0x88, 0x74, 0xd1, 0x1c, 0x32, 0x90, 0xe8,
+  0x8c, 0x9c, 0x45, 0xf9, 0x06, 0x77, 0xb4, 0x19, 0x80, 0x6a, 0x4a, 0xc9, 0x9b, 0x28, 0x46, 0x2a,
+  0xa9, 0x67, 0xb1, 0x8d, 0x58, 0x1d, 0xc3, 0x1f, 0xe3, 0x94, 0x27, 0xdb, 0x0e, 0x60, 0xc8, 0xcd,
+  0x1a, 0x87, 0x9e, 0x3f, 0x7f, 0x7e, 0x6e, 0xfe, 0x4e, 0x88, 0xc3, 0x4b, 0x87, 0xe1, 0x98, 0x28,
+  0xbc, 0x96, 0x8c, 0x82, 0xca, 0x9b, 0x6f, 0x78, 0x56, 0x97, 0xaf, 0x67, 0x22, 0x55, 0xa0, 0x86,
+  0x5f, 0x12, 0xa3, 0x22, 0x87, 0x0b, 0x08, 0x5e, 0x45, 0x3d, 0xea, 0x11, 0x39, 0x3d, 0x36, 0x6d,
+  0x52, 0x27, 0xa6, 0x6b, 0x04, 0x1d, 0x18, 0x55, 0x85, 0x16, 0xe3, 0x9b, 0x36, 0xc3, 0xd7, 0x73,
+  0x7b, 0x5b, 0x66, 0x2e, 0x2b, 0x79, 0xb2, 0x8b, 0xd5, 0x0c, 0x42, 0x8e, 0x24, 0x50, 0x43, 0xf4,
+  0x5e, 0xb0, 0x1c, 0x87, 0x79, 0x3b, 0xa0, 0x17, 0xf4, 0xa0, 0xfa, 0x6a, 0x06, 0x47, 0xee, 0xd4,
+  0x64, 0x16, 0xd6, 0x44, 0x73, 0x0f, 0x55, 0xa0, 0xd1, 0xc0, 0xda, 0xf2, 0xb7, 0x1d, 0x60, 0x95,
+  0x2e, 0x4c, 0x31, 0xd2, 0x6e, 0xd7, 0xde, 0x13, 0x01, 0x47, 0x39, 0x96, 0xb3, 0x80, 0x0d, 0xed,
+  0xc4, 0x02, 0x48, 0x90, 0x3a, 0x64, 0x72, 0xce, 0x71, 0xe7, 0x04, 0xe4, 0xc9, 0x5a, 0x50, 0xe8,
+  0x4f, 0xc5, 0x72, 0xa8, 0x57, 0x46, 0x12, 0xc1, 0xe2, 0x99, 0xb4, 0x82, 0xf4, 0x98, 0x29, 0xe5,
+  0x98, 0xb6, 0x7d, 0x41, 0xab, 0x26, 0xce, 0xc4, 0x7d, 0x52, 0x98, 0xee, 0x33, 0x1b, 0xb8, 0x16,
+  0x20, 0x5f, 0xcb, 0x63, 0xcc, 0x01, 0xd6, 0x7d, 0xc2, 0xc0, 0xbf, 0x13, 0xf4, 0x9d, 0x3f, 0xff,
+  0x7c, 0x0a, 0x61, 0x43, 0xd2, 0x64, 0x48, 0xe3, 0x50, 0x41, 0x79, 0x79, 0xcc, 0x6f, 0xab, 0xea,
+  0x04, 0x1b, 0xbb, 0x6d, 0xef, 0x4d, 0x28, 0x91, 0xac, 0x2e, 0x2a, 0x39, 0xbb, 0x44, 0x62, 0x56,
+  0x95, 0xb2, 0x25, 0x62, 0x52, 0x4e, 0x91, 0x75, 0x9a, 0x46, 0x51, 0x6e, 0x58, 0x55, 0x40, 0x9d,
+  0x0d, 0xfe, 0x25, 0xee, 0xc1, 0xfe, 0x90, 0x13, 0x42, 0x05, 0x78, 0xef, 0x80, 0x19, 0x51, 0x9d,
+  0x58, 0x97, 0x02, 0x8d, 0x78, 0xce, 0x22, 0xda, 0x90, 0x17, 0x5e, 0x1a, 0x93, 0xba, 0x05, 0xbf,
+  0x05, 0x2a, 0xcc, 0xb5, 0x92, 0x3e, 0xb1, 0x4a, 0xe3, 0x8b, 0x56, 0x25, 0x3a, 0x96, 0x41, 0x25,
+  0xf1, 0x97, 0x54, 0xfc, 0xd1, 0xb0, 0x8c, 0xea, 0x8c, 0x27, 0x0a, 0x76, 0xe0, 0xc1, 0xbf, 0x5c,
+  0x46, 0x23, 0x42, 0x01, 0x54, 0x10, 0x72, 0x58, 0x9f, 0xfc, 0xf0, 0xfb, 0x6f, 0xbf, 0xc5, 0x79,
+  0xf7, 0x22, 0xfb, 0x69, 0xc0, 0x7c, 0xf0, 0xb4, 0x8a, 0x8e, 0xc2, 0x86, 0x2b, 0x8a, 0x5c, 0x84,
+  0xdf, 0x68, 0x53, 0x07, 0x07, 0x72, 0xc2, 0xdd, 0xc8, 0x45, 0x64, 0x15, 0x8c, 0x22, 0xca, 0xc2,
+  0xd5, 0x15, 0x81, 0xb1, 0x21, 0x8e, 0xa2, 0xa8, 0x48, 0x36, 0xbf, 0xeb, 0x3a, 0x3e, 0x43, 0xbc,
+  0x32, 0xe2, 0xca, 0x52, 0x97, 0x39, 0xb9, 0xec, 0x9b, 0x9b, 0x3b, 0x10, 0x4f, 0x01, 0x92, 0x7b,
+  0x01, 0x53, 0x28, 0x70, 0x5a, 0xe4, 0x9c, 0xc0, 0xb6, 0x85, 0x80, 0xae, 0x93, 0xc9, 0x6f, 0x3e,
+  0x78, 0xf2, 0xf8, 0x0e, 0xec, 0xcf, 0xe3, 0x83, 0xaf, 0xc6, 0xff, 0xb9, 0x1f, 0x0e, 0x0f, 0xc3,
+  0xe1, 0xbf, 0xc2, 0xe1, 0xc3, 0x70, 0xf0, 0x20, 0x1c, 0x7e, 0x11, 0x8e, 0x3e, 0x0b, 0x47, 0x8f,
+  0xc2, 0xc1, 0x5f, 0x26, 0x37, 0x6e, 0x8f, 0xdf, 0xff, 0x2c, 0x1c, 0xdc, 0x0e, 0x87, 0xb7, 0xc2,
+  0x9f, 0x0f, 0xc6, 0x87, 0x77, 0x9e, 0x7e, 0xf1, 0x5b, 0x90, 0x0a, 0x87, 0x7f, 0x0f, 0x47, 0x7f,
+  0x08, 0x47, 0xf0, 0xbc, 0xbe, 0xf5, 0x06, 0x2a, 0x0c, 0x47, 0xd7, 0xc2, 0xd1, 0x5f, 0xc3, 0xd1,
+  0xfd, 0x70, 0x74, 0x10, 0x8e, 0xfe, 0x0c, 0x7a, 0x34, 0x43, 0xfb, 0xe6, 0xd1, 0xc1, 0xf8, 0xc1,
+  0xdd, 0xaf, 0xef, 0xdf, 0x9a, 0xfc, 0xf3, 0x20, 0x1c, 0x1c, 0xa6, 0xa5, 0xbe, 0x79, 0x74, 0x3d,
+  0x1c, 0xdc, 0xfa, 0xfa, 0xf0, 0x71, 0x38, 0x78, 0x2f, 0x1c, 0xfc, 0x49, 0x3c, 0xef, 0x86, 0xc3,
+  0xeb, 0xe3, 0x07, 0xb7, 0x9e, 0xfc, 0xfb, 0x9a, 0x08, 0x2e, 0x78, 0x84, 0xdb, 0xea, 0x96, 0x09,
+  0x31, 0x2b, 0x56, 0x93, 0xa4, 0xb7, 0xc5, 0x5e, 0x04, 0x65, 0x97, 0xad, 0x26, 0x87, 0x19, 0x76,
+  0x47, 0xa7, 0x43, 0xc1, 0x59, 0x11, 0x01, 0xb1, 0x1c, 0x2d, 0x11, 0xda, 0x84, 0xff, 0xdc, 0xc4,
+  0x64, 0x9a, 0x8e, 0x1e, 0xe4, 0x25, 0x59, 0xf2, 0x9a, 0xe4, 0x91, 0x61, 0x8a, 0xd3, 0xfb, 0xa2,
+  0xe5, 0x28, 0xa9, 0x90, 0xbf, 0x0e, 0x7e, 0x4b, 0xa2, 0xee, 0x52, 0xcf, 0x67, 0x5b, 0x50, 0xf8,
+  0xa8, 0x60, 0x09, 0x16, 0xcf, 0x45, 0xf2, 0xee, 0xbb, 0xe8, 0xcb, 0x8c, 0x1f, 0x02, 0x45, 0x35,
+  0x09, 0x10, 0xaa, 0x28, 0x60, 0x66, 0x65, 0x8a, 0x11, 0x3e, 0xb3, 0x64, 0x01, 0xbf, 0xc6, 0x06,
+  0x16, 0x13, 0xd3, 0x24, 0x21, 0xba, 0xfd, 0xbd, 0x4a, 0xca, 0x35, 0xe1, 0x7f, 0x4e, 0xd6, 0xca,
+  0x1c, 0xf6, 0xcd, 0x8b, 0x17, 0x67, 0xcd, 0xe8, 0xe4, 0xad, 0x9d, 0x9d, 0x77, 0x04, 0x51, 0x7a,
+  0x3b, 0xaf, 0xb5, 0x93, 0x6b, 0x84, 0x5a, 0x4b, 0x64, 0x90, 0xa7, 0x59, 0xc8, 0xce, 0xec, 0x2b,
+  0xa8, 0x50, 0x51, 0x96, 0x48, 0x56, 0xbd, 0x91, 0x14, 0x35, 0x3d, 0x30, 0x8e, 0x5a, 0x54, 0x97,
+  0x9e, 0xbc, 0x42, 0x8f, 0xda, 0x4b, 0x5d, 0xad, 0xa8, 0x58, 0x12, 0xc0, 0x9a, 0x7c, 0x21, 0x49,
+  0xda, 0x1c, 0x5b, 0x50, 0xca, 0xdb, 0x17, 0x74, 0x98, 0xc1, 0xe1, 0xf0, 0xa3, 0xf1, 0xc1, 0x2f,
+  0xc2, 0xe1, 0x8d, 0xc9, 0xa7, 0x87, 0xe1, 0xe0, 0x20, 0x1c, 0xde, 0xfc, 0xef, 0xc7, 0x7f, 0x9c,
+  0xdc, 0xfe, 0xdb, 0x14, 0x4d, 0x6a, 0x13, 0x50, 0xe3, 0xc0, 0x81, 0xa6, 0x54, 0x2d, 0x1c, 0x5d,
+  0x68, 0x67, 0x85, 0xe9, 0x2c, 0xa9, 0x88, 0x19, 0x59, 0x9d, 0xc1, 0x9b, 0x5a, 0x34, 0x10, 0x5b,
+  0xac, 0x01, 0x20, 0xab, 0xdd, 0x64, 0x86, 0x9c, 0x9e, 0x1e, 0xe9, 0x91, 0x5f, 0xcd, 0xcc, 0x0e,
+  0xdc, 0xaa, 0x4a, 0xdb, 0xdc, 0x1e, 0x1d, 0x7f, 0xf8, 0xc1, 0xe4, 0x77, 0xf7, 0xa0, 0x4d, 0x75,
+  0xd6, 0x03, 0x6e, 0x9f, 0x84, 0x83, 0x9b, 0xd8, 0x82, 0x1f, 0x7e, 0xf2, 0xe4, 0xf0, 0x7e, 0x38,
+  0xf8, 0x04, 0x3a, 0xb2, 0x14, 0x8e, 0x6e, 0x0b, 0xa9, 0x47, 0xe1, 0xe8, 0xde, 0xf8, 0xe0, 0x1a,
+  0xb4, 0xed, 0xcc, 0xd5, 0xbc, 0xc3, 0x70, 0xe2, 0x72, 0x6f, 0x2f, 0xc7, 0xff, 0xcf, 0xb3, 0x99,
+  0x17, 0x7a, 0xe8, 0xca, 0xec, 0x9d, 0xc4, 0x0b, 0xae, 0xe8, 0xc6, 0x12, 0xd6, 0x3a, 0x9e, 0x6d,
+  0xe0, 0xea, 0x75, 0x0e, 0xe8, 0x8d, 0x98, 0x8e, 0x16, 0xa6, 0x8d, 0xf9, 0xca, 0x2b, 0xb0, 0x65,
+  0x15, 0x0c, 0xb2, 0x5e, 0x4f, 0x34, 0xd3, 0xe2, 0xfc, 0x2e, 0x4a, 0x76, 0xea, 0x62, 0x35, 0x33,
+  0x33, 0x93, 0x52, 0xd7, 0x6f, 0xd2, 0x78, 0xe0, 0x33, 0xf9, 0x16, 0xc5, 0x24, 0xde, 0xa7, 0x4f,
+  0x8a, 0xc9, 0x74, 0xe9, 0x8e, 0x56, 0x93, 0x98, 0x92, 0x5e, 0x4d, 0x62, 0x72, 0xc1, 0xb4, 0x7c,
+  0xda, 0xb0, 0x19, 0xe2, 0x39, 0x15, 0x1b, 0xad, 0x26, 0x18, 0x8e, 0x5b, 0x20, 0x62, 0x66, 0x28,
+  0x51, 0x4d, 0xfd, 0x2a, 0xa3, 0x41, 0x99, 0x6a, 0xf8, 0x6b, 0x18, 0xfc, 0x69, 0xaa, 0x6c, 0x36,
+  0xb1, 0x34, 0x2e, 0xb9, 0x81, 0x67, 0x30, 0x18, 0xd8, 0x4f, 0x1e, 0x8b, 0x76, 0x18, 0x40, 0xf9,
+  0xbc, 0x37, 0xbe, 0xf7, 0xe5, 0xf8, 0x57, 0xf0, 0xfe, 0xb0, 0xfc, 0xf4, 0xf3, 0x8f, 0x26, 0x0f,
+  0x7f, 0x09, 0x37, 0x86, 0x4e, 0xbb, 0x96, 0x2e, 0x67, 0x46, 0x38, 0xf8, 0x7c, 0xf2, 0xe9, 0x97,
+  0x93, 0x8f, 0x13, 0x2d, 0xd3, 0x75, 0x6d, 0xfb, 0x75, 0xdb, 0x4e, 0xaf, 0x01, 0x53, 0x89, 0x6f,
+  0xb9, 0x09, 0xf8, 0x58, 0x1b, 0xdf, 0xbd, 0xb4, 0x7d, 0xa1, 0x20, 0xc6, 0xad, 0x5c, 0x4e, 0x54,
+  0x29, 0x4c, 0x8b, 0xf3, 0x2a, 0xe9, 0x55, 0x80, 0xb5, 0xd0, 0x6b, 0xa0, 0x56, 0x57, 0xbc, 0xbb,
+  0xe2, 0x5f, 0x74, 0xf0, 0xbf, 0x04, 0x7e, 0x17, 0x97, 0x48, 0x43, 0x50, 0xc5, 0xe6, 0xfe, 0xe3,
+  0x46, 0x44, 0x26, 0xfb, 0x89, 0xe9, 0x27, 0xed, 0xe1, 0xa8, 0xc7, 0x6b, 0x1f, 0x6e, 0x54, 0x99,
+  0xa6, 0xbe, 0xe5, 0x98, 0x6e, 0xbf, 0x90, 0x08, 0x95, 0xdc, 0x84, 0x23, 0x46, 0xd8, 0x0f, 0x12,
+  0x67, 0xe0, 0xb4, 0xec, 0x37, 0x5c, 0x99, 0x24, 0x13, 0x2c, 0x0a, 0x1d, 0xe6, 0xfb, 0x74, 0x66,
+  0x3f, 0x10, 0x6a, 0x00, 0x7d, 0xb4, 0x89, 0x4d, 0xdd, 0x49, 0xf8, 0xcb, 0x0a, 0xc2, 0x63, 0x71,
+  0x1b, 0x18, 0x94, 0x1b, 0x6d, 0x90, 0xf3, 0xc4, 0x85, 0x27, 0x96, 0x83, 0xe4, 0xcc, 0xdf, 0xc2,
+  0x1f, 0x31, 0x61, 0x38, 0xe6, 0x54, 0x26, 0x96, 0x30, 0x8e, 0x45, 0xe1, 0xd9, 0xb3, 0x07, 0x49,
+  0x4d, 0x8f, 0xfe, 0x7f, 0xa8, 0xe9, 0xea, 0x67, 0x12, 0x5d, 0xfe, 0x34, 0xfe, 0x3f, 0x38, 0xda,
+  0xe2, 0x2e, 0x32, 0x17, 0x00, 0x00,
+};
+
+#endif // WEBUIPAGE_H
@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_Bench.h>
+
+// Set these pins for your board and wiring.
+static const uint8_t DP_H = 5;
+static const uint8_t DP_L = 6;
+static const uint8_t DM_H = 7;
+static const uint8_t DM_L = 39;
+static const uint8_t VBUS_DET = 8;
+static const uint8_t OUT_EN = 38;
+
+// 1: one JSON object per line, 0: CSV with a header line.
+#define BENCH_JSON 0
+
+static const uint16_t SAMPLES = 256;
+static const uint16_t VAR_SAMPLES = 16;  // var_inc()/var_dec() include a 100 ms wait
+
+ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+
+static QC3BenchStats<SAMPLES> stats;
+static uint32_t ticksPerUs;
+static char line[192];
+
+static uint32_t cycles() {
+  return ESP.getCycleCount();
+}
+
+template <uint16_t N>
+static void report(QC3BenchStats<N> &stats, const char *name) {
+#if BENCH_JSON
+  stats.formatJson(line, sizeof(line), name, ticksPerUs);
+#else
+  stats.formatCsv(line, sizeof(line), name, ticksPerUs);
+#endif
+  Serial.println(line);
+}
+
+template <typename Fn>
+static void bench(const char *name, Fn fn) {
+  stats.reset();
+  stats.calibrate(cycles);
+  stats.run(cycles, fn);
+  report(stats, name);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  qc3.begin();
+  qc3.setVbusDividerRatio(7.67f);
+  ticksPerUs = getCpuFrequencyMhz();
+
+#if !BENCH_JSON
+  QC3BenchStats<1>::formatCsvHeader(line, sizeof(line));
+  Serial.println(line);
+#endif
+
+  // Measurement paths (no charger needed)
+  volatile uint32_t sink = 0;
+  bench("readVoltage_raw", [&]() { sink = (uint32_t)(qc3.readVoltage((uint16_t)2048) * 1000.0f); });
+  bench("readMillivolts_raw", [&]() { sink = qc3.readMillivolts(VBUS_DET, (uint16_t)2048); });
+  bench("readVoltage_pin", [&]() { sink = (uint32_t)(qc3.readVoltage(VBUS_DET) * 1000.0f); });
+  bench("readMillivolts_pin", [&]() { sink = qc3.readMillivolts(VBUS_DET); });
+  bench("readVbusMillivolts", [&]() { sink = qc3.readVbusMillivolts(); });
+  bench("convertCurrentMilliamps", [&]() { sink = (uint32_t)qc3.convertCurrentMilliamps(2500U); });
+  bench("sampleAdcPins", [&]() { qc3.sampleAdcPins(); });
+
+  // D+/D- drive, both backends
+  static const uint8_t states[] = { ESP32_QC3_CTL::QC_600mV, ESP32_QC3_CTL::QC_3300mV };
+  uint8_t s = 0;
+  bench("set_DP_gpio", [&]() { qc3.set_DP(states[s++ & 1U]); });
+  bench("set_DM_gpio", [&]() { qc3.set_DM(states[s++ & 1U]); });
+  if (qc3.setPinBackend(ESP32_QC3_CTL::PIN_BACKEND_BUNDLE)) {
+    bench("set_DP_bundle", [&]() { qc3.set_DP(states[s++ & 1U]); });
+    bench("set_DM_bundle", [&]() { qc3.set_DM(states[s++ & 1U]); });
+    qc3.setPinBackend(ESP32_QC3_CTL::PIN_BACKEND_GPIO);
+  }
+  qc3.set_DP(ESP32_QC3_CTL::QC_HIZ);
+  qc3.set_DM(ESP32_QC3_CTL::QC_HIZ);
+
+  // Protocol paths need a QC3 charger on the port
+  if (qc3.detect_Charger() == ESP32_QC3_CTL::QC3) {
+    static const uint8_t modes[] = { ESP32_QC3_CTL::QC_5V, ESP32_QC3_CTL::QC_9V };
+    uint8_t m = 0;
+    bench("set_VBUS", [&]() { qc3.set_VBUS(modes[m++ & 1U]); });
+
+    qc3.set_VBUS(ESP32_QC3_CTL::QC_VAR);
+    delay(100);
+    QC3BenchStats<VAR_SAMPLES> var;
+    var.calibrate(cycles);
+    uint8_t v = 0;
+    var.run(cycles, [&]() {
+      if ((v++ & 1U) == 0U) {
+        qc3.var_inc();
+      } else {
+        qc3.var_dec();
+      }
+    }, 0);
+    report(var, "var_step");
+    qc3.set_VBUS(ESP32_QC3_CTL::QC_5V);
+  } else {
+    Serial.println("# no QC3 charger: set_VBUS/var_step skipped");
+  }
+  (void)sink;
+}
+
+void loop() {
+  delay(1000);
+}
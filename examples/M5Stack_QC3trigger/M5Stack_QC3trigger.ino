@@ -31,12 +31,21 @@
 /**********
  * Calibration parameter
  * Changed to match actual measurements with your equipment
+ * (values saved with qc3.saveCalibration() take precedence)
  **********/
-float vScale = 7.66;    // actual VBUS / VBUS_I
-float vi_0A  = 2.44;   // VI_I(V) @ 0A output
-float vi_2A  = 2.85;   // VI_I(V) @ 2A output
-float vi_0cal = 0.0;
-float vbus_i_temp[20]; // for moving average
+const float    V_SCALE   = 7.66f;  // actual VBUS / VBUS_I
+const uint16_t VI_0A_MV  = 2440;   // VI_I(mV) @ 0A output
+const uint16_t VI_2A_MV  = 2850;   // VI_I(mV) @ 2A output
+QC3BoxcarFilter<int32_t, 20> currentAvg; // moving average (mA)
+
+// Output protection: OUT_EN is cut when VBUS > 21 V or Iout > 3.5 A for
+// 2 consecutive samples (sampled every 500 us by a high-priority timer)
+const ESP32_QC3_CTL::ProtectionLimits PROTECTION = { 21000U, 0U, 3500, 2U };
+
+// Energy drawn since output was last turned on, integrated every 1 ms
+QC3EnergyMeter energy;
+const uint32_t ENERGY_PERIOD_US = 1000;
+uint32_t energyTime = 0;
 
 ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_I, VBUSEN_O);
 
@@ -54,6 +63,7 @@ uint32_t updateTime = 0;
 const uint8_t UPDATE_INTERVAL = 100;
 
 // Long-press repeat for VAR mode (A/C buttons)
+// Steps are queued with setVarVoltage() and pulsed in the background
 const uint32_t HOLD_START_MS  = 1000;
 const uint32_t HOLD_REPEAT_MS = 120;
 uint32_t holdStartA  = 0;
@@ -185,34 +195,6 @@ static void updateBtnLabels() {
   drawBtnMenu("DOWN", OE ? "OFF" : "ON", canGoUp ? "UP" : "");
 }
 
-static float averageVI() {
-  float sum = 0.0;
-  for (int i = 0; i < 20; i++) {
-    sum += vbus_i_temp[i];
-  }
-  return sum / 20.0;
-}
-
-static float readVoltageRaw(uint16_t vread) {
-  float vdc;
-  if (vread < 5) {
-    vdc = 0.0;
-  } else if (vread <= 1084) {
-    vdc = 0.11 + (0.89 / 1084.0) * vread;
-  } else if (vread <= 2303) {
-    vdc = 1.0 + (1.0 / (2303.0 - 1084.0)) * (vread - 1084);
-  } else if (vread <= 3179) {
-    vdc = 2.0 + (0.7 / (3179.0 - 2303.0)) * (vread - 2303);
-  } else if (vread <= 3659) {
-    vdc = 2.7 + (0.3 / (3659.0 - 3179.0)) * (vread - 3179);
-  } else if (vread <= 4071) {
-    vdc = 3.0 + (0.2 / (4071.0 - 3659.0)) * (vread - 3659);
-  } else {
-    vdc = 3.2;
-  }
-  return vdc;
-}
-
 static void applyQCMode() {
   if (VAR_CONTROL) {
     return;
@@ -267,26 +249,31 @@ static void drawQCCapabilities() {
   M5.Display.drawString(typeStr, panelX + 12, lineY, 2);
   lineY += lineH;
 
-  if (ht == ESP32_QC3_CTL::QC3) {
-    M5.Display.drawString("Class : " + String(classB ? "B (max 20V)" : "A (max 12V)"),
-      panelX + 12, lineY, 2);
+  ESP32_QC3_CTL::Capability cap;
+  if ((ht == ESP32_QC3_CTL::QC3) && qc3.getCapability(&cap)) {
+    // Probe result (cached: probe skipped for a known charger)
+    const char *probe = cap.cached ? "cached" :
+      (cap.probe == ESP32_QC3_CTL::CAP_PROBE_VAR) ? "VAR step" :
+      (cap.probe == ESP32_QC3_CTL::CAP_PROBE_SAVED) ? "resumed" : "20V";
+    M5.Display.drawString("Class : " + String(classB ? "B" : "A") + " (max " +
+      String(cap.max_mV / 1000U) + "V, " + probe + ")", panelX + 12, lineY, 2);
     lineY += lineH;
 
     M5.Display.setTextColor(TFT_CYAN, TFT_BLACK);
-    M5.Display.drawString("Supported voltages:", panelX + 12, lineY, 2);
+    M5.Display.drawString("Measured: 5V " + String(cap.v5_mV / 1000.0f, 2) + "V / peak " +
+      String(cap.vmax_mV / 1000.0f, 2) + "V", panelX + 12, lineY, 2);
+    lineY += lineH;
+    M5.Display.drawString("Step    : " + ((cap.step_us != 0U) ?
+      String(cap.step_us / 1000.0f, 1) + " ms (+200mV)" : String("-")), panelX + 12, lineY, 2);
     lineY += lineH;
     M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
 
-    M5.Display.drawString(" Fixed : 5V / 9V / 12V", panelX + 12, lineY, 2);
+    M5.Display.drawString(" Fixed : 5V / 9V / 12V" + String(classB ? " / 20V" : ""),
+      panelX + 12, lineY, 2);
     lineY += lineH;
 
-    if (classB) {
-      M5.Display.drawString(" Fixed : 20V", panelX + 12, lineY, 2);
-      lineY += lineH;
-    }
-
-    M5.Display.drawString(" VAR   : 3.6V - " + String(classB ? "20.0" : "12.0") + "V (200mV step)",
-      panelX + 12, lineY, 2);
+    M5.Display.drawString(" VAR   : " + String(cap.var_min_mV / 1000.0f, 1) + "V - " +
+      String(cap.var_max_mV / 1000.0f, 1) + "V (200mV step)", panelX + 12, lineY, 2);
   } else {
     M5.Display.setTextColor(TFT_YELLOW, TFT_BLACK);
     M5.Display.drawString("QC3.0 not available.", panelX + 12, lineY, 2);
@@ -313,20 +300,62 @@ void setup() {
   M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
   M5.Display.drawCentreString("Detecting...", 160, 100, 4);
 
-  // QC3 charger detection (blocks ~1.5s)
+  // Measurement calibration (zero-current offset is captured on output ON)
+  qc3.setCurrentSensePin(VI_I);
   qc3.begin();
-  uint8_t ht = qc3.detect_Charger();
+  qc3.setVbusDividerRatio(V_SCALE);
+  qc3.setCurrentCalibration(VI_0A_MV, VI_2A_MV, 2000U);
+  (void)qc3.loadCalibration();
+  (void)qc3.captureCurrentZero();
+  qc3.setAutoZero(true);
+  (void)qc3.startProtection(PROTECTION);
 
-  // Initial voltage: 5V
-  QC_IDX = 0U;
-  VAR_CONTROL = false;
-  (void)qc3.set_VBUS(QC_MODES[QC_IDX]);
-  varVoltage = qc3.getVoltage();
+  // Moving average init
+  currentAvg.fill(qc3.readCurrentMilliamps());
 
   // Output disable
-  digitalWrite(VBUSEN_O, LOW);
+  qc3.setOutput(false);
   OE = false;
 
+  Serial.begin(115200);
+
+  // QC3 charger detection (non-blocking, finished in loop())
+  // The detected type and the last voltage profile are saved to NVS; if the
+  // last charger was QC3, the Class B probe is skipped and that profile is
+  // restored (output stays OFF).
+  // A new charger is classified by one VAR step from 12 V instead of the
+  // 20 V probe. The per-charger result cache stays off, since it cannot
+  // tell apart chargers with the same 5 V level.
+  qc3.setAutoSave(true);
+  qc3.setCapabilityProbe(ESP32_QC3_CTL::CAP_PROBE_VAR);
+  (void)qc3.startResume();
+}
+
+static void onDetectComplete() {
+  uint8_t ht = qc3.getHostType();
+
+  QC_IDX = 0U;
+  VAR_CONTROL = false;
+  if (qc3.isResumed()) {
+    // Restored the last voltage profile
+    const uint8_t mode = qc3.getMode();
+    if (mode == ESP32_QC3_CTL::QC_VAR) {
+      VAR_CONTROL = true;
+      varVoltage = qc3.getVarTarget();
+    } else {
+      for (uint8_t i = 0; i < QC_MODE_COUNT; i++) {
+        if (QC_MODES[i] == mode) {
+          QC_IDX = i;
+        }
+      }
+      varVoltage = qc3.getVoltage();
+    }
+  } else {
+    // Initial voltage: 5V
+    (void)qc3.set_VBUS(QC_MODES[QC_IDX]);
+    varVoltage = qc3.getVoltage();
+  }
+
   // Redraw UI
   M5.Display.fillScreen(TFT_BLACK);
   drawTitle("M5 QC3 Trigger");
@@ -335,16 +364,8 @@ void setup() {
   updateBtnLabels();
   M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
 
-  // Moving average init
-  for (int i = 0; i < 20; i++) {
-    vbus_i_temp[i] = readVoltageRaw((uint16_t)analogRead(VI_I));
-    delay(20);
-  }
-  vi_0cal = averageVI();
-
   updateTime = millis();
 
-  Serial.begin(115200);
   Serial.print("Charger type: ");
   switch (ht) {
     case ESP32_QC3_CTL::QC3:    Serial.println("QC3.0"); break;
@@ -356,6 +377,34 @@ void setup() {
 void loop() {
   M5.update();
 
+  // Charger detection in progress: keep UI alive, skip control
+  if (qc3.isDetecting()) {
+    if (qc3.pollDetect() == ESP32_QC3_CTL::DETECT_DONE) {
+      onDetectComplete();
+    }
+    return;
+  }
+
+  // Save the voltage profile to NVS a while after the last change
+  (void)qc3.pollSave();
+
+  // Protection cut the output: stay OFF until the next ON press
+  if ((qc3.pollProtection() != ESP32_QC3_CTL::FAULT_NONE) && OE) {
+    ESP32_QC3_CTL::FaultInfo fault;
+    (void)qc3.getFaultInfo(&fault);
+    static const char *FAULT_NAMES[] = { "-", "OVP", "UVP", "OCP" };
+    Serial.printf("Protection: %s at %u mV, %ld mA\n", FAULT_NAMES[fault.code],
+                  fault.vbus_mV, (long)fault.current_mA);
+    OE = false;
+    updateBtnLabels();
+    setMainTextColor();
+  }
+
+  if (micros() - energyTime >= ENERGY_PERIOD_US) {
+    energyTime = micros();
+    energy.addSample(qc3.readVbusMillivolts(), qc3.readCurrentMilliamps(), energyTime);
+  }
+
   if (updateTime <= millis()) {
     updateTime = millis() + UPDATE_INTERVAL;
 
@@ -366,13 +415,9 @@ void loop() {
       return;
     }
 
-    float vbusV = readVoltageRaw((uint16_t)analogRead(VBUS_I)) * vScale;
+    float vbusV = (float)qc3.readVbusMillivolts() / 1000.0f;
 
-    for (int i = 19; i > 0; i--) {
-      vbus_i_temp[i] = vbus_i_temp[i - 1];
-    }
-    vbus_i_temp[0] = readVoltageRaw((uint16_t)analogRead(VI_I));
-    float vbusI = (averageVI() - vi_0cal) / ((vi_2A - vi_0A) / 2.0);
+    float vbusI = (float)currentAvg.push(qc3.readCurrentMilliamps()) / 1000.0f;
 
     char buf1[6];
     char buf2[6];
@@ -384,6 +429,14 @@ void loop() {
     drawText("Iout = " + String(buf2) + " A    ", 1, 1);
     Serial.printf("Iout = %s A\n", buf2);
 
+    QC3EnergyMeter::Totals totals;
+    energy.getTotals(&totals);
+    char buf3[24];
+    snprintf(buf3, sizeof(buf3), "%.3fWh %.3fAh", (double)totals.energy_uWh / 1e6,
+             (double)totals.charge_uAh / 1e6);
+    drawText("E = " + String(buf3) + "  ", 1, 2);
+    Serial.printf("E = %s\n", buf3);
+
     // Subtitle: current mode
     if (VAR_CONTROL) {
       char varBuf[8];
@@ -393,13 +446,11 @@ void loop() {
       drawSubTitle("QC " + String(QC_LABELS[QC_IDX]) + "          ");
     }
 
-    if (OE) {
-      digitalWrite(VBUSEN_O, HIGH);
-      Serial.println("Output Enabled");
-    } else {
-      digitalWrite(VBUSEN_O, LOW);
-      Serial.println("Output Disabled");
-      vi_0cal = averageVI();
+    // Only switch on a change, so the auto-save quiet period can elapse
+    if (OE != qc3.getOutput()) {
+      if (qc3.setOutput(OE)) {
+        Serial.println(OE ? "Output Enabled" : "Output Disabled");
+      }
     }
   }
 
@@ -411,8 +462,8 @@ void loop() {
       // Decrease 200mV
       uint16_t varMin = qc3.getUseClassB() ? 3600U : 5000U;
       if (varVoltage > varMin + 200U) {
-        qc3.var_dec();
-        varVoltage = qc3.getVoltage();
+        (void)qc3.setVarVoltage(varVoltage - 200U);
+        varVoltage = qc3.getVarTarget();
       }
     } else if (QC_IDX == 0U) {
       // Enter QC Capabilities decode mode
@@ -446,6 +497,10 @@ void loop() {
       if (holdStartB != 0U && !btnBLongFired) {
         // short press released
         OE = !OE;
+        if (OE) {
+          qc3.clearFault();
+          energy.reset();
+        }
         updateBtnLabels();
         setMainTextColor();
       }
@@ -470,8 +525,8 @@ void loop() {
       // Increase 200mV
       uint16_t varMax = qc3.getUseClassB() ? 20000U : 12000U;
       if (varVoltage < varMax) {
-        qc3.var_inc();
-        varVoltage = qc3.getVoltage();
+        (void)qc3.setVarVoltage(varVoltage + 200U);
+        varVoltage = qc3.getVarTarget();
       }
     } else if (QC_IDX < (QC_MODE_COUNT - 1U)) {
       uint8_t next = QC_IDX + 1U;
@@ -503,8 +558,8 @@ void loop() {
       } else if ((now - holdStartA) >= HOLD_START_MS
                && (now - lastRepeatA) >= HOLD_REPEAT_MS) {
         if (varVoltage > varMin + 200U) {
-          qc3.var_dec();
-          varVoltage = qc3.getVoltage();
+          (void)qc3.setVarVoltage(varVoltage - 200U);
+          varVoltage = qc3.getVarTarget();
         }
         lastRepeatA = now;
       }
@@ -520,8 +575,8 @@ void loop() {
       } else if ((now - holdStartC) >= HOLD_START_MS
                && (now - lastRepeatC) >= HOLD_REPEAT_MS) {
         if (varVoltage < varMax) {
-          qc3.var_inc();
-          varVoltage = qc3.getVoltage();
+          (void)qc3.setVarVoltage(varVoltage + 200U);
+          varVoltage = qc3.getVarTarget();
         }
         lastRepeatC = now;
       }
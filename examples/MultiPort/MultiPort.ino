@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_MultiPort.h>
+
+// Set these pins for your board and wiring (one row per USB port).
+//                        DP_H DP_L DM_H DM_L VBUS_DET OUT_EN
+ESP32_QC3_CTL port0(        5,   6,   7,  39,       8,    38);
+ESP32_QC3_CTL port1(        1,   2,   3,  40,       9,    41);
+
+QC3MultiPort ports;
+
+static const float V_SCALE = 7.67f;  // VBUS / VBUS_DET divider ratio
+
+void onPortDetect(uint8_t port, uint8_t hostType, void *arg) {
+  (void)arg;
+  Serial.printf("port %u: host type %u\n", port, hostType);
+  if (hostType == ESP32_QC3_CTL::QC3) {
+    // Start each QC3 port ramping to 9 V; ramps run concurrently.
+    ports.getPort(port)->setVarVoltage(9000U);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  ports.addPort(&port0);
+  ports.addPort(&port1);
+  ports.setDetectCallback(onPortDetect);
+  ports.begin();
+  for (uint8_t i = 0; i < ports.getPortCount(); i++) {
+    ports.getPort(i)->setVbusDividerRatio(V_SCALE);
+  }
+
+  // All ports are detected at the same time (about 1.6 s in total).
+  ports.startDetect();
+}
+
+void loop() {
+  ports.update();
+
+  static uint32_t last = 0;
+  if (millis() - last >= 1000U) {
+    last = millis();
+    for (uint8_t i = 0; i < ports.getPortCount(); i++) {
+      QC3MultiPort::PortState st;
+      ports.getPortState(i, &st);
+      Serial.printf("port %u: type=%u set=%umV vbus=%umV%s\n", i, st.host_type,
+                    st.voltage, st.vbus_mV, st.var_busy ? " (ramping)" : "");
+    }
+  }
+  delay(1);
+}
@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_Log.h>
+
+// Set these pins for your board and wiring.
+static const uint8_t DP_H = 5;
+static const uint8_t DP_L = 6;
+static const uint8_t DM_H = 7;
+static const uint8_t DM_L = 39;
+static const uint8_t VBUS_DET = 8;
+static const uint8_t OUT_EN = 38;
+
+static const float V_SCALE = 7.67f;  // VBUS / VBUS_DET divider ratio
+
+static const char *LOG_PATH = "/qc3log.bin";
+static const uint16_t LOG_BLOCKS = 128;         // 128 x 4 KB = 512 KB ring
+static const uint32_t SAMPLE_PERIOD_US = 1000;  // 1 kHz
+static const uint32_t FLUSH_PERIOD_MS = 60000;  // write the partial block once a minute
+
+// Event codes for logEvent(); any values 0-254 can be used.
+static const uint8_t EV_MARK = 1;
+
+ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+QC3Logger logger;
+
+// Serial commands:
+//   m  add a marker event
+//   9  switch to 9 V, 5 to 5 V (logged as mode changes)
+//   d  stop logging and dump the log as hex (xxd -r -p dump.txt qc3log.bin)
+//   r  delete the log and start over
+static void dumpLog() {
+  logger.end();
+  File f = LittleFS.open(LOG_PATH, "r");
+  uint8_t buf[32];
+  size_t n;
+  while (f && (n = f.read(buf, sizeof(buf))) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      Serial.printf("%02x", buf[i]);
+    }
+    Serial.println();
+  }
+  f.close();
+  Serial.println("# end of log");
+}
+
+static void setMode(uint8_t mode) {
+  if (qc3.set_VBUS(mode)) {
+    logger.logMode(mode);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  qc3.begin();
+  qc3.setVbusDividerRatio(V_SCALE);
+  (void)qc3.detect_Charger();
+
+  if (!LittleFS.begin(true)) {
+    Serial.println("LittleFS mount failed");
+    return;
+  }
+  if (!logger.begin(LittleFS, LOG_PATH, LOG_BLOCKS)) {
+    Serial.println("log open failed");
+    return;
+  }
+  logger.logMode(qc3.getMode());
+  qc3.setOutput(true);
+}
+
+void loop() {
+  static uint32_t lastSample = micros();
+  static uint32_t lastFlush = millis();
+
+  if (logger.isActive() && (micros() - lastSample >= SAMPLE_PERIOD_US)) {
+    lastSample += SAMPLE_PERIOD_US;
+    logger.logSample(qc3.readVbusMillivolts(), qc3.readCurrentMilliamps());
+  }
+
+  // Full blocks are written here, outside the sampling path.
+  logger.poll();
+  if (millis() - lastFlush >= FLUSH_PERIOD_MS) {
+    lastFlush = millis();
+    logger.flush();
+  }
+
+  if (Serial.available()) {
+    switch (Serial.read()) {
+      case 'm': logger.logEvent(EV_MARK); break;
+      case '9': setMode(ESP32_QC3_CTL::QC_9V); break;
+      case '5': setMode(ESP32_QC3_CTL::QC_5V); break;
+      case 'd': dumpLog(); break;
+      case 'r':
+        logger.end();
+        LittleFS.remove(LOG_PATH);
+        logger.begin(LittleFS, LOG_PATH, LOG_BLOCKS);
+        break;
+      default: break;
+    }
+  }
+}
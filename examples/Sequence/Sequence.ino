@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_Sequence.h>
+
+// Set these pins for your board and wiring.
+static const uint8_t DP_H = 5;
+static const uint8_t DP_L = 6;
+static const uint8_t DM_H = 7;
+static const uint8_t DM_L = 39;
+static const uint8_t VBUS_DET = 8;
+static const uint8_t OUT_EN = 38;
+
+static const float V_SCALE = 7.67f;  // VBUS / VBUS_DET divider ratio
+
+ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+QC3Sequence seq(&qc3);
+
+// The M5Stack_QC3_test loop() written as a profile: fixed modes for 3 s each,
+// then a VAR sweep 9 V -> 10 V -> 8 V -> 9 V in 200 mV steps, 1 s per step.
+static const QC3Sequence::Step profile[] = {
+  QC3Sequence::output(true),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_5V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_9V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_12V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_9V, 3000),
+  QC3Sequence::var(9000, 1000),
+  QC3Sequence::ramp(9200, 10000, 200, 1000),
+  QC3Sequence::ramp(9800, 8000, 200, 1000),
+  QC3Sequence::ramp(8200, 9000, 200, 1000),
+};
+
+// Only used on Class B chargers: same profile with a 20 V step.
+static const QC3Sequence::Step profileClassB[] = {
+  QC3Sequence::output(true),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_5V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_9V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_12V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_20V, 3000),
+  QC3Sequence::fixed(ESP32_QC3_CTL::QC_9V, 3000),
+  QC3Sequence::var(9000, 1000),
+  QC3Sequence::ramp(9200, 10000, 200, 1000),
+  QC3Sequence::ramp(9800, 8000, 200, 1000),
+  QC3Sequence::ramp(8200, 9000, 200, 1000),
+};
+
+// Called at the end of every dwell, including each ramp step.
+void onSample(const QC3Sequence::Sample &s, void *arg) {
+  (void)arg;
+  Serial.printf("%lu,%u,%u,%u,%u,%ld\n", (unsigned long)s.t_ms, s.cycle, s.step,
+                s.set_mV, s.vbus_mV, (long)s.current_mA);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  qc3.begin();
+  qc3.setVbusDividerRatio(V_SCALE);
+
+  if (qc3.detect_Charger() != ESP32_QC3_CTL::QC3) {
+    Serial.println("QC3 charger not found");
+    return;
+  }
+
+  seq.setSampleCallback(onSample);
+  Serial.println("t_ms,cycle,step,set_mV,vbus_mV,current_mA");
+  // Repeat until reset (0 = forever).
+  if (qc3.getUseClassB()) {
+    seq.start(profileClassB, sizeof(profileClassB) / sizeof(profileClassB[0]), 0);
+  } else {
+    seq.start(profile, sizeof(profile) / sizeof(profile[0]), 0);
+  }
+}
+
+void loop() {
+  // Non-blocking: other work can run here between polls.
+  static uint8_t lastState = QC3Sequence::SEQ_IDLE;
+  const uint8_t state = seq.poll();
+  if ((state == QC3Sequence::SEQ_ERROR) && (lastState != state)) {
+    Serial.println("sequence aborted");
+  }
+  lastState = state;
+  delay(1);
+}
@@ -0,0 +1,125 @@
+// Host-side benchmark of the pure-computation paths of ESP32_QC3_CTL.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++11 -O2 -Isrc extras/bench/qc3_bench.cpp src/*.cpp -o qc3_bench
+//   ./qc3_bench          # CSV
+//   ./qc3_bench --json   # one JSON object per line
+//
+// Pin-level calls run against QC3SimCharger, so their numbers include the
+// cost of the model and are only useful for tracking library overhead.
+// Use examples/Benchmark on the device for real GPIO/ADC timing.
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_SimCharger.h>
+#include <ESP32_QC3_Bench.h>
+#include <ESP32_QC3_Log.h>
+
+static const uint8_t DP_H = 5;
+static const uint8_t DP_L = 6;
+static const uint8_t DM_H = 7;
+static const uint8_t DM_L = 39;
+static const uint8_t VBUS_DET = 8;
+static const uint8_t OUT_EN = 38;
+
+static const uint16_t SAMPLES = 2048;
+static const uint32_t TICKS_PER_US = 1000;  // ticks are nanoseconds
+
+static QC3BenchStats<SAMPLES> stats;
+static bool json = false;
+static char line[192];
+
+static bool nullSink(uint16_t index, const uint8_t *block, void *arg) {
+  (void)index;
+  (void)block;
+  (void)arg;
+  return true;
+}
+
+static uint32_t nanos() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Fn>
+static void bench(const char *name, Fn fn) {
+  stats.reset();
+  stats.calibrate(nanos);
+  stats.run(nanos, fn, 64);
+  if (json) {
+    stats.formatJson(line, sizeof(line), name, TICKS_PER_US);
+  } else {
+    stats.formatCsv(line, sizeof(line), name, TICKS_PER_US);
+  }
+  puts(line);
+}
+
+int main(int argc, char **argv) {
+  json = (argc > 1) && (strcmp(argv[1], "--json") == 0);
+
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  qc3.setHal(&sim);
+  qc3.addAdcPin(VBUS_DET);
+  qc3.begin();
+  qc3.setVbusDividerRatio(7.67f);
+  qc3.setCurrentCalibration(2440U, 2850U, 2000U);
+
+  if (!json) {
+    QC3BenchStats<1>::formatCsvHeader(line, sizeof(line));
+    puts(line);
+  }
+
+  volatile uint32_t sink = 0;
+  uint16_t raw = 0;
+  bench("readVoltage_raw", [&]() { sink = (uint32_t)(qc3.readVoltage((uint16_t)(raw++ & 0x0FFFU)) * 1000.0f); });
+  bench("readMillivolts_raw", [&]() { sink = qc3.readMillivolts(VBUS_DET, (uint16_t)(raw++ & 0x0FFFU)); });
+  bench("convertCurrentMilliamps", [&]() { sink = (uint32_t)qc3.convertCurrentMilliamps((uint16_t)(raw++ & 0x0FFFU)); });
+  bench("readVbusMillivolts_sim", [&]() { sink = qc3.readVbusMillivolts(); });
+
+  QC3BoxcarFilter<uint16_t, 16, uint32_t> boxcar;
+  QC3MedianFilter<uint16_t, 5> median;
+  QC3EmaFilter<int32_t, 3> ema;
+  bench("boxcar16_push", [&]() { sink = boxcar.push(raw++); });
+  bench("median5_push", [&]() { sink = median.push(raw++); });
+  bench("ema_push", [&]() { sink = (uint32_t)ema.push(raw++); });
+
+  QC3MpscQueue<ESP32_QC3_CTL::Command, 16> queue;
+  ESP32_QC3_CTL::Command cmd = { ESP32_QC3_CTL::CMD_OUTPUT, 1, 0 };
+  bench("queue_push_pop", [&]() { (void)queue.push(cmd); (void)queue.pop(cmd); });
+
+  // Binary log record versus the text line the trigger sketch prints.
+  QC3Logger logger;
+  logger.setBlockSink(nullSink);
+  (void)logger.begin(8);
+  uint32_t t_us = 0;
+  char text[32];
+  bench("log_sample", [&]() {
+    const uint16_t mv = (uint16_t)(9000U + (raw++ & 0x3FU));
+    t_us += 1000U;
+    (void)logger.logSample(mv, 500 + (raw & 0x1F), t_us);
+    (void)logger.poll();
+  });
+  bench("text_sample", [&]() {
+    const uint16_t mv = (uint16_t)(9000U + (raw++ & 0x3FU));
+    const int32_t ma = 500 + (raw & 0x1F);
+    sink = (uint32_t)snprintf(text, sizeof(text), "%u.%03u,%ld.%03ld\n", mv / 1000U, mv % 1000U,
+                              (long)(ma / 1000), (long)(ma % 1000));
+  });
+
+  static const uint8_t states[] = { ESP32_QC3_CTL::QC_600mV, ESP32_QC3_CTL::QC_3300mV };
+  uint8_t s = 0;
+  bench("set_DP_sim", [&]() { qc3.set_DP(states[s++ & 1U]); });
+  bench("set_DM_sim", [&]() { qc3.set_DM(states[s++ & 1U]); });
+
+  if (qc3.detect_Charger() == ESP32_QC3_CTL::QC3) {
+    static const uint8_t modes[] = { ESP32_QC3_CTL::QC_5V, ESP32_QC3_CTL::QC_9V };
+    uint8_t m = 0;
+    bench("set_VBUS_sim", [&]() { qc3.set_VBUS(modes[m++ & 1U]); });
+    bench("update_sim", [&]() { qc3.update(); });
+  }
+  (void)sink;
+  return 0;
+}
@@ -0,0 +1,826 @@
+// Host-side run of ESP32_QC3_CTL against the simulated charger.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++11 -O2 -Isrc extras/sim/qc3_sim.cpp src/*.cpp -o qc3_sim
+//
+// Runs detection against every simulated charger type and, for QC3
+// chargers, measures fixed-mode settle time and VAR ramp time in
+// simulated time, then brings up all four charger types at once through
+// QC3MultiPort (including an unplug seen by its update()), and compares
+// time-to-target after a reset for a full detection versus startResume() with the saved state (and checks that the
+// state is not applied to a different charger), and runs a stepped
+// and ramped QC3Sequence profile checking the sample taken at each step,
+// round-trips a QC3Logger ring log that has wrapped several times,
+// checks QC3EnergyMeter totals for steady and bursty loads, unplugs and
+// replugs a charger under the hot-plug monitor, trips output protection,
+// replugs with undervoltage protection armed (tripped by the unplug and well
+// before it), and classifies chargers with the VAR-step capability probe.
+// Each scenario is its own run*() function with its own simulator and
+// controller; a failing scenario is reported by name and the run exits
+// non-zero.
+
+#include <stdio.h>
+#include <ESP32_QC3_CTL.h>
+#include <ESP32_QC3_SimCharger.h>
+#include <ESP32_QC3_MultiPort.h>
+#include <ESP32_QC3_Sequence.h>
+#include <ESP32_QC3_Log.h>
+#include <ESP32_QC3_Energy.h>
+#include <string.h>
+#include <vector>
+
+static const uint8_t DP_H = 5;
+static const uint8_t DP_L = 6;
+static const uint8_t DM_H = 7;
+static const uint8_t DM_L = 39;
+static const uint8_t VBUS_DET = 8;
+static const uint8_t OUT_EN = 38;
+
+static const char *typeName(uint8_t type) {
+  switch (type) {
+    case QC3SimCharger::SIM_NONE: return "NONE";
+    case QC3SimCharger::SIM_DCP: return "DCP";
+    case QC3SimCharger::SIM_QC3A: return "QC3A";
+    case QC3SimCharger::SIM_QC3B: return "QC3B";
+    default: return "?";
+  }
+}
+
+static const uint8_t CHARGER_TYPES[] = {
+  QC3SimCharger::SIM_NONE, QC3SimCharger::SIM_DCP,
+  QC3SimCharger::SIM_QC3A, QC3SimCharger::SIM_QC3B
+};
+static const uint8_t CHARGER_HOST[] = {
+  ESP32_QC3_CTL::BC_NA, ESP32_QC3_CTL::BC_DCP,
+  ESP32_QC3_CTL::QC3, ESP32_QC3_CTL::QC3
+};
+
+// Attaches the controller to the simulated charger and initializes it with
+// the divider the simulation models.
+static void makeController(QC3SimCharger &sim, ESP32_QC3_CTL &qc3) {
+  qc3.setHal(&sim);
+  qc3.begin();
+  qc3.setVbusDividerRatio(7.67f);
+}
+
+// makeController() followed by a blocking detection. Returns the host type.
+static uint8_t makeDetected(QC3SimCharger &sim, ESP32_QC3_CTL &qc3) {
+  makeController(sim, qc3);
+  return qc3.detect_Charger();
+}
+
+// Polls the controller every 1 ms of simulated time until VBUS is within
+// 100 mV of target_mV and the VAR scheduler is idle. Returns elapsed us.
+static uint32_t settle(ESP32_QC3_CTL &qc3, QC3SimCharger &sim, uint16_t target_mV) {
+  const uint32_t t0 = sim.micros();
+  for (uint32_t i = 0; i < 10000U; i++) {
+    qc3.pollVar();
+    const uint16_t v = qc3.readVbusMillivolts();
+    const uint16_t diff = (v > target_mV) ? (v - target_mV) : (target_mV - v);
+    if (!qc3.isVarBusy() && (diff <= 100U)) {
+      return sim.micros() - t0;
+    }
+    sim.delay(1);
+  }
+  return 0xFFFFFFFFUL;
+}
+
+// Records hot-plug events in order.
+struct HotplugLog {
+  uint8_t events[8];
+  uint8_t count;
+  uint8_t host_type;
+};
+
+static void onHotplug(uint8_t event, uint8_t host_type, void *arg) {
+  HotplugLog *log = static_cast<HotplugLog *>(arg);
+  if (log->count < sizeof(log->events)) {
+    log->events[log->count++] = event;
+  }
+  log->host_type = host_type;
+}
+
+// Counts protection faults reported through the callback.
+static void onFault(const ESP32_QC3_CTL::FaultInfo &fault, void *arg) {
+  (void)fault;
+  (*static_cast<uint8_t *>(arg))++;
+}
+
+// Counts QC3Sequence samples and those more than 100 mV off the set voltage.
+struct SeqResult {
+  const QC3Sequence::Step *profile;
+  uint16_t samples;
+  uint16_t bad;
+};
+
+static void onSeqSample(const QC3Sequence::Sample &s, void *arg) {
+  SeqResult *res = static_cast<SeqResult *>(arg);
+  const uint16_t diff = (s.vbus_mV > s.set_mV) ? (s.vbus_mV - s.set_mV) : (s.set_mV - s.vbus_mV);
+  if ((res->profile[s.step].type != QC3Sequence::SEQ_WAIT) && (diff > 100U)) {
+    res->bad++;
+  }
+  res->samples++;
+}
+
+// In-memory ring for QC3Logger blocks.
+static const uint16_t LOG_BLOCKS = 8;
+static uint8_t logRing[LOG_BLOCKS][QC3Logger::BLOCK_SIZE];
+
+static bool logSink(uint16_t index, const uint8_t *block, void *arg) {
+  (void)arg;
+  memcpy(logRing[index], block, QC3Logger::BLOCK_SIZE);
+  return true;
+}
+
+static void collectRecord(const QC3Logger::Record &rec, void *arg) {
+  static_cast<std::vector<QC3Logger::Record> *>(arg)->push_back(rec);
+}
+
+// Detection, fixed-mode settle and VAR ramp time for every charger type.
+static int runDetection() {
+  int failures = 0;
+  printf("charger,host_type,class_b,detect_ms,9V_ms,var12V_ms,var5V_ms,pulses\n");
+  for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+    QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, CHARGER_TYPES[i]);
+    ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    makeController(sim, qc3);
+
+    uint32_t t0 = sim.micros();
+    const uint8_t host = qc3.detect_Charger();
+    const uint32_t detect_us = sim.micros() - t0;
+
+    uint32_t fixed_us = 0;
+    uint32_t up_us = 0;
+    uint32_t down_us = 0;
+    if (host == ESP32_QC3_CTL::QC3) {
+      qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+      fixed_us = settle(qc3, sim, 9000U);
+      qc3.setVarVoltage(12000U);
+      up_us = settle(qc3, sim, 12000U);
+      qc3.setVarVoltage(5000U);
+      down_us = settle(qc3, sim, 5000U);
+    }
+
+    const bool class_b = qc3.getUseClassB();
+    printf("%s,%u,%d,%lu,%lu,%lu,%lu,%lu\n", typeName(CHARGER_TYPES[i]), host, class_b ? 1 : 0,
+           (unsigned long)(detect_us / 1000U), (unsigned long)(fixed_us / 1000U),
+           (unsigned long)(up_us / 1000U), (unsigned long)(down_us / 1000U),
+           (unsigned long)sim.getPulseCount());
+
+    if ((host != CHARGER_HOST[i]) || (class_b != (CHARGER_TYPES[i] == QC3SimCharger::SIM_QC3B)) ||
+        (fixed_us == 0xFFFFFFFFUL) || (up_us == 0xFFFFFFFFUL) || (down_us == 0xFFFFFFFFUL)) {
+      printf("  unexpected result for %s\n", typeName(CHARGER_TYPES[i]));
+      failures++;
+    }
+  }
+  return failures;
+}
+
+// A fixed-mode request that lands while a VAR up-pulse is in flight must
+// cancel the pulse: D+ must not be dropped back to 600 mV afterwards (that
+// would leave D+ 0.6 V / D- 0.6 V, the 12 V request) and the output must
+// settle at 9 V.
+static int runVarCancel() {
+  int failures = 0;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  (void)makeDetected(sim, qc3);
+  sim.delay(100);
+  qc3.setVarVoltage(6000U);
+  bool in_pulse = false;
+  for (uint32_t i = 0; (i < 10000U) && !in_pulse; i++) {
+    in_pulse = (qc3.pollVar() == ESP32_QC3_CTL::VAR_PULSE);
+    if (!in_pulse) {
+      sim.delayMicroseconds(50);
+    }
+  }
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  for (uint32_t i = 0; i < 10U; i++) {
+    (void)qc3.pollVar();
+    sim.delayMicroseconds(100);
+  }
+  const uint16_t dp = sim.getDpMillivolts();
+  const uint16_t dm = sim.getDmMillivolts();
+  const uint32_t settle_us = settle(qc3, sim, 9000U);
+  printf("varcancel,D+ %u mV,D- %u mV,set %u mV,VBUS %u mV\n", dp, dm, qc3.getVoltage(),
+         sim.getVbusMillivolts());
+  if (!in_pulse || (dp != 3300U) || (dm != 600U) || (qc3.getVoltage() != 9000U) ||
+      qc3.isVarBusy() || (settle_us == 0xFFFFFFFFUL)) {
+    printf("  unexpected VAR cancel result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// All ports detect concurrently: total time should match a single port.
+static int runMultiPort() {
+  int failures = 0;
+  QC3SimCharger *sims[sizeof(CHARGER_TYPES)];
+  ESP32_QC3_CTL *ports[sizeof(CHARGER_TYPES)];
+  QC3MultiPort multi;
+  for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+    sims[i] = new QC3SimCharger(DP_H, DP_L, DM_H, DM_L, VBUS_DET, CHARGER_TYPES[i]);
+    ports[i] = new ESP32_QC3_CTL(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    ports[i]->setHal(sims[i]);
+    multi.addPort(ports[i]);
+  }
+  multi.begin();
+  for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+    ports[i]->setVbusDividerRatio(7.67f);
+  }
+  const uint32_t t0 = sims[0]->micros();
+  const uint8_t qc3_ports = multi.detectAll();
+  const uint32_t multi_us = sims[0]->micros() - t0;
+  printf("multiport,%u ports,%u qc3,%lu ms\n", (unsigned)multi.getPortCount(), qc3_ports,
+         (unsigned long)(multi_us / 1000U));
+  for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+    QC3MultiPort::PortState st;
+    multi.getPortState(i, &st);
+    if ((st.host_type != CHARGER_HOST[i]) || (st.class_b != (CHARGER_TYPES[i] == QC3SimCharger::SIM_QC3B))) {
+      printf("  unexpected multiport result for %s\n", typeName(CHARGER_TYPES[i]));
+      failures++;
+    }
+  }
+  if ((qc3_ports != 2U) || (multi_us > 2000000UL)) {
+    printf("  unexpected multiport timing\n");
+    failures++;
+  }
+
+  // The manager's update() must also run the per-port hot-plug monitor
+  const uint8_t last = sizeof(CHARGER_TYPES) - 1U;
+  ports[last]->setHotplugMonitor(true);
+  sims[last]->unplug();
+  for (uint32_t t = 0; t < 50U; t++) {
+    multi.update();
+    for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+      sims[i]->delay(1);
+    }
+  }
+  const uint8_t hp_state = ports[last]->getHotplugState();
+  printf("multiport,hotplug state %u after unplug\n", hp_state);
+  if (hp_state != ESP32_QC3_CTL::HOTPLUG_DETACHED) {
+    printf("  unexpected multiport hotplug result\n");
+    failures++;
+  }
+  for (uint8_t i = 0; i < sizeof(CHARGER_TYPES); i++) {
+    delete ports[i];
+    delete sims[i];
+  }
+  return failures;
+}
+
+// Restart after a reset with a 13 V VAR profile on a Class B charger:
+// full detection + ramp from 5 V versus resume from the saved state.
+static int runResume() {
+  int failures = 0;
+  ESP32_QC3_CTL::SavedState saved;
+  uint32_t full_us = 0;
+  {
+    QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+    ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    makeController(sim, qc3);
+    const uint32_t t0 = sim.micros();
+    (void)qc3.detect_Charger();
+    sim.delay(100);  // let the 20 V -> 5 V change from the Class B probe settle
+    qc3.setVarVoltage(13000U);
+    (void)settle(qc3, sim, 13000U);
+    full_us = sim.micros() - t0;
+    qc3.getState(&saved);
+  }
+  uint32_t resume_us = 0;
+  bool resumed = false;
+  {
+    QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+    ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    makeController(sim, qc3);
+    const uint32_t t0 = sim.micros();
+    (void)qc3.startResume(saved);
+    while (qc3.pollDetect() != ESP32_QC3_CTL::DETECT_DONE) {
+      sim.delay(1);
+    }
+    const uint32_t ramp_us = settle(qc3, sim, 13000U);
+    resume_us = (ramp_us == 0xFFFFFFFFUL) ? ramp_us : (sim.micros() - t0);
+    resumed = qc3.isResumed() && qc3.getUseClassB();
+  }
+  printf("resume,13V,full %lu ms,resume %lu ms\n", (unsigned long)(full_us / 1000U),
+         (unsigned long)(resume_us / 1000U));
+  if (!resumed || (saved.qc_mode != ESP32_QC3_CTL::QC_VAR) || (saved.voltage != 13000U) ||
+      (resume_us >= full_us)) {
+    printf("  unexpected resume result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// The 13 V Class B state with the output on, resumed onto a different charger
+// whose 5 V level reads ~330 mV higher: the saved profile must not be applied,
+// so detection runs the full probe and ends at 5 V with the output off.
+static int runResumeSwap() {
+  int failures = 0;
+  ESP32_QC3_CTL::SavedState saved;
+  {
+    QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+    ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    (void)makeDetected(sim, qc3);
+    sim.delay(100);
+    qc3.setVarVoltage(13000U);
+    (void)settle(qc3, sim, 13000U);
+    qc3.setOutput(true);
+    qc3.getState(&saved);
+  }
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  sim.setVbusDivider(720U);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  makeController(sim, qc3);
+  (void)qc3.startResume(saved, true);
+  uint16_t peak_mV = 0;
+  while (qc3.pollDetect() != ESP32_QC3_CTL::DETECT_DONE) {
+    if (sim.getVbusMillivolts() > peak_mV) {
+      peak_mV = sim.getVbusMillivolts();
+    }
+    sim.delay(1);
+  }
+  sim.delay(100);
+  ESP32_QC3_CTL::Capability cap;
+  const bool have_cap = qc3.getCapability(&cap);
+  printf("resume_swap,saved v5 %u mV,now %u mV,resumed %u,probe %u,output %u,vbus %u mV\n",
+         saved.v5_mV, have_cap ? cap.v5_mV : 0U, qc3.isResumed() ? 1U : 0U,
+         have_cap ? cap.probe : 0xFFU, qc3.getOutput() ? 1U : 0U, sim.getVbusMillivolts());
+  if ((saved.v5_mV == 0U) || qc3.isResumed() || !have_cap ||
+      (cap.probe != ESP32_QC3_CTL::CAP_PROBE_20V) || qc3.getOutput() ||
+      (qc3.getHostType() != ESP32_QC3_CTL::QC3) || (sim.getVbusMillivolts() > 5100U) ||
+      (peak_mV < 19000U)) {
+    printf("  unexpected resume_swap result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Fixed steps, then a VAR ramp up in 200 mV and down in 400 mV steps, twice.
+static int runSequence() {
+  int failures = 0;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3A);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  (void)makeDetected(sim, qc3);
+
+  static const QC3Sequence::Step profile[] = {
+    QC3Sequence::fixed(ESP32_QC3_CTL::QC_9V, 200),
+    QC3Sequence::fixed(ESP32_QC3_CTL::QC_5V, 200),
+    QC3Sequence::ramp(5000, 6000, 200, 50),
+    QC3Sequence::ramp(5800, 5000, 400, 50),
+    QC3Sequence::wait(100),
+  };
+  QC3Sequence seq(&qc3);
+  SeqResult res = { profile, 0U, 0U };
+  seq.setSampleCallback(onSeqSample, &res);
+  const uint32_t t0 = sim.micros();
+  const bool ok = seq.start(profile, sizeof(profile) / sizeof(profile[0]), 2);
+  while (ok && seq.isRunning() && ((sim.micros() - t0) < 60000000UL)) {
+    (void)seq.poll();
+    sim.delay(1);
+  }
+  printf("sequence,%u samples,%u off target,%lu ms\n", res.samples, res.bad,
+         (unsigned long)((sim.micros() - t0) / 1000U));
+  // 2 fixed + 6 up + 3 down + 1 wait per cycle
+  if (!ok || (seq.getState() != QC3Sequence::SEQ_DONE) || (res.samples != 24U) || (res.bad != 0U)) {
+    printf("  unexpected sequence result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// 1 kHz samples for 60 s (random walk), mode changes and markers, into a
+// ring far smaller than the log so it wraps. The blocks left in the ring
+// must decode to exactly the newest records.
+static int runLog() {
+  int failures = 0;
+  QC3Logger logger;
+  logger.setBlockSink(logSink);
+  (void)logger.begin(LOG_BLOCKS);
+  std::vector<QC3Logger::Record> expect;
+  uint32_t now_us = 0xFFF00000UL;  // micros() wraps during the run
+  uint16_t mv = 5000;
+  int32_t ma = 0;
+  uint8_t mode = ESP32_QC3_CTL::QC_5V;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < 60000UL; i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    mv = (uint16_t)(mv + (int16_t)((seed >> 16) % 41U) - 20);
+    ma += (int32_t)((seed >> 8) % 21U) - 10;
+    QC3Logger::Record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.t_us = (uint64_t)i * 1000U;
+    if ((i % 5000U) == 4999U) {
+      mode = (mode == ESP32_QC3_CTL::QC_5V) ? ESP32_QC3_CTL::QC_9V : ESP32_QC3_CTL::QC_5V;
+      (void)logger.logMode(mode, now_us);
+      rec.type = QC3Logger::LOG_MODE;
+    } else if ((i % 7000U) == 6999U) {
+      (void)logger.logEvent(1, (int32_t)i, now_us);
+      rec.type = QC3Logger::LOG_EVENT;
+      rec.code = 1;
+      rec.value = (int32_t)i;
+    } else {
+      (void)logger.logSample(mv, ma, now_us);
+      rec.type = QC3Logger::LOG_SAMPLE;
+    }
+    rec.vbus_mV = mv;
+    rec.current_mA = ma;
+    rec.mode = mode;
+    expect.push_back(rec);
+    now_us += 1000U;
+    (void)logger.poll();
+  }
+  (void)logger.flush();
+
+  uint32_t seqs[LOG_BLOCKS];
+  uint16_t order[LOG_BLOCKS];
+  uint16_t valid = 0;
+  for (uint16_t b = 0; b < LOG_BLOCKS; b++) {
+    QC3Logger::BlockInfo info;
+    if (QC3Logger::readBlockInfo(logRing[b], &info)) {
+      uint16_t k = valid++;
+      while ((k > 0) && (seqs[k - 1] > info.seq)) {
+        seqs[k] = seqs[k - 1];
+        order[k] = order[k - 1];
+        k--;
+      }
+      seqs[k] = info.seq;
+      order[k] = b;
+    }
+  }
+  std::vector<QC3Logger::Record> got;
+  for (uint16_t k = 0; k < valid; k++) {
+    (void)QC3Logger::decodeBlock(logRing[order[k]], collectRecord, &got);
+  }
+  bool match = !got.empty() && (got.size() <= expect.size());
+  const size_t base = expect.size() - got.size();
+  for (size_t k = 0; match && (k < got.size()); k++) {
+    const QC3Logger::Record &a = got[k];
+    const QC3Logger::Record &b = expect[base + k];
+    match = (a.type == b.type) && (a.t_us == b.t_us) && (a.mode == b.mode) &&
+            ((a.type != QC3Logger::LOG_SAMPLE) || ((a.vbus_mV == b.vbus_mV) && (a.current_mA == b.current_mA))) &&
+            ((a.type != QC3Logger::LOG_EVENT) || ((a.code == b.code) && (a.value == b.value)));
+  }
+  const float bytes_per = (float)logger.getBytesLogged() / (float)expect.size();
+  printf("log,%lu records,%lu decoded,%.2f bytes/record,%lu blocks,%lu dropped\n",
+         (unsigned long)expect.size(), (unsigned long)got.size(), bytes_per,
+         (unsigned long)logger.getBlocksWritten(), (unsigned long)logger.getDropped());
+  if (!match || (valid != LOG_BLOCKS) || (logger.getDropped() != 0U) || (bytes_per > 4.0f)) {
+    printf("  unexpected log result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// 9 V / 1 A for one hour in two steps must total exactly 9 Wh / 1 Ah.
+// A 3 A burst for 10 ms every 100 ms (0.5 A baseline, 0.75 A mean) sampled
+// every 1 ms integrates exactly; sampled every 100 ms it misses the bursts.
+static int runEnergy() {
+  int failures = 0;
+  QC3EnergyMeter steady;
+  uint32_t now_us = 0xFFFFF000UL;  // micros() wraps during the run
+  for (uint32_t ms = 0; ms <= 3600000UL; ms++) {
+    steady.setStep((ms <= 1800000UL) ? 0U : 1U);
+    steady.addSample(9000U, 1000, now_us);
+    now_us += 1000U;
+  }
+  QC3EnergyMeter::Totals total;
+  QC3EnergyMeter::Totals step0;
+  QC3EnergyMeter::Totals step1;
+  steady.getTotals(&total);
+  (void)steady.getStepTotals(0, &step0);
+  (void)steady.getStepTotals(1, &step1);
+
+  QC3EnergyMeter fast;
+  QC3EnergyMeter slow;
+  for (uint32_t ms = 0; ms <= 60000UL; ms++) {
+    const uint32_t phase = ms % 100U;
+    const int32_t ma = ((phase >= 50U) && (phase < 60U)) ? 3000 : 500;
+    fast.addSample(9000U, ma, ms * 1000U);
+    if (phase == 0U) {
+      slow.addSample(9000U, ma, ms * 1000U);
+    }
+  }
+  QC3EnergyMeter::Totals fast_t;
+  QC3EnergyMeter::Totals slow_t;
+  fast.getTotals(&fast_t);
+  slow.getTotals(&slow_t);
+  printf("energy,1h %ld uWh %ld uAh,steps %ld+%ld uWh,burst 1ms %ld uAh,100ms %ld uAh\n",
+         (long)total.energy_uWh, (long)total.charge_uAh, (long)step0.energy_uWh,
+         (long)step1.energy_uWh, (long)fast_t.charge_uAh, (long)slow_t.charge_uAh);
+  // 60 s at 0.75 A mean = 12500 uAh; trapezoid edges cost at most 1 ms per edge
+  const long burst_err = (long)fast_t.charge_uAh - 12500L;
+  if ((total.energy_uWh != 9000000) || (total.charge_uAh != 1000000) ||
+      (step0.energy_uWh + step1.energy_uWh > total.energy_uWh) ||
+      (step0.energy_uWh + step1.energy_uWh < total.energy_uWh - 1) ||
+      (burst_err < -100L) || (burst_err > 100L) || (total.peak_mW != 9000U)) {
+    printf("  unexpected energy result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Unplug a Class B charger at 7.4 V VAR with the output on, replug it after
+// 200 ms and let the control loop (update() every 1 ms) bring it back.
+static int runHotplug() {
+  int failures = 0;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  (void)makeDetected(sim, qc3);
+  sim.delay(100);
+  qc3.setVarVoltage(7400U);
+  (void)settle(qc3, sim, 7400U);
+  qc3.setOutput(true);
+
+  HotplugLog log = {{0}, 0, 0xFF};
+  qc3.setHotplugCallback(onHotplug, &log);
+  qc3.setHotplugMonitor(true, true);
+
+  sim.unplug();
+  uint32_t t0 = sim.micros();
+  uint32_t detach_us = 0xFFFFFFFFUL;
+  for (uint32_t i = 0; i < 100U; i++) {
+    qc3.update();
+    if (qc3.getHotplugState() == ESP32_QC3_CTL::HOTPLUG_DETACHED) {
+      detach_us = sim.micros() - t0;
+      break;
+    }
+    sim.delay(1);
+  }
+  const bool refused = !qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  const bool off = !qc3.getOutput() && (qc3.getHostType() == ESP32_QC3_CTL::BC_NA);
+  for (uint32_t i = 0; i < 200U; i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+
+  sim.plug(QC3SimCharger::SIM_QC3B);
+  t0 = sim.micros();
+  uint32_t ready_us = 0xFFFFFFFFUL;
+  uint16_t peak_mV = 0;
+  for (uint32_t i = 0; i < 5000U; i++) {
+    qc3.update();
+    if (sim.getVbusMillivolts() > peak_mV) {
+      peak_mV = sim.getVbusMillivolts();
+    }
+    const uint16_t v = sim.getVbusMillivolts();
+    if ((qc3.getHotplugState() == ESP32_QC3_CTL::HOTPLUG_ATTACHED) && !qc3.isVarBusy() &&
+        (v >= 7300U) && (v <= 7500U)) {
+      ready_us = sim.micros() - t0;
+      break;
+    }
+    sim.delay(1);
+  }
+  printf("hotplug,detach %lu ms,back to 7.4V %lu ms,peak %u mV,events %u\n",
+         (unsigned long)(detach_us / 1000U), (unsigned long)(ready_us / 1000U),
+         peak_mV, log.count);
+  // VBUS decays from 7.4 V at 500 mV/ms, so ~8 ms to the 3.5 V threshold + 2 ms debounce.
+  // No Class B probe (20 V) on the way back, output restored.
+  if ((detach_us > 15000UL) || !refused || !off || (ready_us == 0xFFFFFFFFUL) ||
+      (peak_mV > 8000U) || !qc3.getOutput() || !qc3.isResumed() || (log.count != 3U) ||
+      (log.events[0] != ESP32_QC3_CTL::HOTPLUG_EV_DETACH) ||
+      (log.events[1] != ESP32_QC3_CTL::HOTPLUG_EV_ATTACH) ||
+      (log.events[2] != ESP32_QC3_CTL::HOTPLUG_EV_READY) ||
+      (log.host_type != ESP32_QC3_CTL::QC3)) {
+    printf("  unexpected hotplug result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Protection at 10 V OVP / 2 A OCP with a 9 V output: stepping the charger to
+// 12 V must cut the output as VBUS crosses 10 V, and so must a 3 A load after
+// the fault is cleared. The control loop runs every 1 ms.
+static int runProtection() {
+  int failures = 0;
+  static const uint8_t CUR_SENSE = 20;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3A);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  qc3.setCurrentSensePin(CUR_SENSE);
+  makeController(sim, qc3);
+  qc3.setCurrentCalibration(500U, 1500U, 2000U);  // 2 mA/mV, 0 A at 500 mV
+  sim.setAnalogMillivolts(CUR_SENSE, 1000U);       // 1 A
+  (void)qc3.detect_Charger();
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  (void)settle(qc3, sim, 9000U);
+
+  uint8_t faults = 0;
+  qc3.setFaultCallback(onFault, &faults);
+  ESP32_QC3_CTL::ProtectionLimits limits = {10000U, 0U, 2000, 2U};
+  const bool started = qc3.startProtection(limits);
+  qc3.setOutput(true);
+
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_12V);
+  uint32_t cross_us = 0;
+  for (uint32_t i = 0; (i < 500U) && (qc3.getFault() == ESP32_QC3_CTL::FAULT_NONE); i++) {
+    if ((cross_us == 0U) && (sim.getVbusMillivolts() >= 10000U)) {
+      cross_us = sim.micros();
+    }
+    qc3.update();
+    sim.delay(1);
+  }
+  ESP32_QC3_CTL::FaultInfo ovp;
+  const bool ovp_latched = qc3.getFaultInfo(&ovp);
+  const uint32_t ovp_us = ovp.timestamp_us - cross_us;
+  const bool refused = !qc3.setOutput(true);
+
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  (void)settle(qc3, sim, 9000U);
+  qc3.clearFault();
+  const bool reenabled = qc3.setOutput(true);
+  sim.setAnalogMillivolts(CUR_SENSE, 2000U);       // 3 A
+  const uint32_t load_us = sim.micros();
+  for (uint32_t i = 0; (i < 100U) && (qc3.getFault() == ESP32_QC3_CTL::FAULT_NONE); i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+  ESP32_QC3_CTL::FaultInfo ocp;
+  (void)qc3.getFaultInfo(&ocp);
+  const uint32_t ocp_us = ocp.timestamp_us - load_us;
+  printf("protection,ovp at %u mV after %lu us,ocp at %ld mA after %lu us,%u faults\n",
+         ovp.vbus_mV, (unsigned long)ovp_us, (long)ocp.current_mA, (unsigned long)ocp_us, faults);
+  // two 1 ms samples over the limit; VBUS rises 500 mV/ms so the trip is below 11.5 V
+  if (!started || !ovp_latched || (ovp.code != ESP32_QC3_CTL::FAULT_OVP) ||
+      (ovp_us > 3000UL) || (ovp.vbus_mV > 11500U) || !refused || !reenabled ||
+      (ocp.code != ESP32_QC3_CTL::FAULT_OCP) || (ocp_us > 3000UL) || qc3.getOutput() ||
+      (faults != 2U)) {
+    printf("  unexpected protection result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Hot-plug with 4 V UVP armed and the output on at 9 V: the unplug latches UVP
+// on the way down before the port is seen as detached, and the replug must
+// still come back at 9 V with the output restored.
+static int runHotplugUvp() {
+  int failures = 0;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  (void)makeDetected(sim, qc3);
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  (void)settle(qc3, sim, 9000U);
+
+  uint8_t faults = 0;
+  qc3.setFaultCallback(onFault, &faults);
+  ESP32_QC3_CTL::ProtectionLimits limits = {0U, 4000U, 0, 2U};
+  const bool started = qc3.startProtection(limits);
+  qc3.setOutput(true);
+  qc3.setHotplugMonitor(true, true);
+
+  sim.unplug();
+  for (uint32_t i = 0; (i < 100U) && (qc3.getHotplugState() != ESP32_QC3_CTL::HOTPLUG_DETACHED); i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+  const uint8_t unplug_faults = faults;
+  const uint8_t detached_fault = qc3.getFault();
+  for (uint32_t i = 0; i < 200U; i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+
+  sim.plug(QC3SimCharger::SIM_QC3B);
+  bool ready = false;
+  for (uint32_t i = 0; (i < 5000U) && !ready; i++) {
+    qc3.update();
+    const uint16_t v = sim.getVbusMillivolts();
+    ready = (qc3.getHotplugState() == ESP32_QC3_CTL::HOTPLUG_ATTACHED) && !qc3.isVarBusy() &&
+            (v >= 8900U) && (v <= 9100U);
+    sim.delay(1);
+  }
+  printf("hotplug_uvp,%u faults on unplug,fault %u when detached,ready %u,output %u,fault %u\n",
+         unplug_faults, detached_fault, ready ? 1U : 0U, qc3.getOutput() ? 1U : 0U, qc3.getFault());
+  if (!started || !ready || !qc3.getOutput() || (qc3.getFault() != ESP32_QC3_CTL::FAULT_NONE) ||
+      (detached_fault != ESP32_QC3_CTL::FAULT_NONE) || (faults != unplug_faults)) {
+    printf("  unexpected hotplug/UVP result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Hot-plug after a UVP latched 50 ms before the unplug (VBUS reads 3.8 V as if
+// the charger sagged under overload): the latch must survive the detach and the
+// replug must not switch the output back on.
+static int runHotplugUvpEarly() {
+  int failures = 0;
+  QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, QC3SimCharger::SIM_QC3B);
+  ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+  (void)makeDetected(sim, qc3);
+  qc3.set_VBUS(ESP32_QC3_CTL::QC_9V);
+  (void)settle(qc3, sim, 9000U);
+
+  ESP32_QC3_CTL::ProtectionLimits limits = {0U, 4000U, 0, 2U};
+  const bool started = qc3.startProtection(limits);
+  qc3.setOutput(true);
+  qc3.setHotplugMonitor(true, true);
+
+  sim.setVbusDivider(1817U);  // 9 V reads as 3.8 V
+  for (uint32_t i = 0; i < 50U; i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+  const uint8_t tripped = qc3.getFault();
+  sim.setVbusDivider(767U);
+  sim.unplug();
+  for (uint32_t i = 0; i < 200U; i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+  const uint8_t detached = qc3.getHotplugState();
+  const uint8_t detached_fault = qc3.getFault();
+
+  sim.plug(QC3SimCharger::SIM_QC3B);
+  for (uint32_t i = 0; (i < 5000U) && (qc3.getHotplugState() != ESP32_QC3_CTL::HOTPLUG_ATTACHED); i++) {
+    qc3.update();
+    sim.delay(1);
+  }
+  printf("hotplug_uvp_early,fault %u before unplug,state %u fault %u when detached,output %u,fault %u\n",
+         tripped, detached, detached_fault, qc3.getOutput() ? 1U : 0U, qc3.getFault());
+  if (!started || (tripped != ESP32_QC3_CTL::FAULT_UVP) ||
+      (detached != ESP32_QC3_CTL::HOTPLUG_DETACHED) || (detached_fault != ESP32_QC3_CTL::FAULT_UVP) ||
+      qc3.getOutput() || (qc3.getFault() != ESP32_QC3_CTL::FAULT_UVP)) {
+    printf("  unexpected hotplug/early UVP result\n");
+    failures++;
+  }
+  return failures;
+}
+
+// Class A/B via a single VAR step from 12 V instead of the 20 V probe, then a
+// replug of the same charger, which should hit the capability cache.
+static int runCapability() {
+  int failures = 0;
+  for (uint8_t i = 2; i < sizeof(CHARGER_TYPES); i++) {
+    QC3SimCharger sim(DP_H, DP_L, DM_H, DM_L, VBUS_DET, CHARGER_TYPES[i]);
+    ESP32_QC3_CTL qc3(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN);
+    makeController(sim, qc3);
+    qc3.setCapabilityProbe(ESP32_QC3_CTL::CAP_PROBE_VAR, true);
+
+    uint32_t detect_us[2];
+    uint16_t peak_mV[2];
+    ESP32_QC3_CTL::Capability cap[2];
+    bool ok = true;
+    for (uint8_t pass = 0; pass < 2U; pass++) {
+      sim.plug(CHARGER_TYPES[i]);
+      const uint32_t t0 = sim.micros();
+      peak_mV[pass] = 0;
+      qc3.startDetect();
+      while (qc3.pollDetect() != ESP32_QC3_CTL::DETECT_DONE) {
+        sim.delay(1);
+        if (sim.getVbusMillivolts() > peak_mV[pass]) {
+          peak_mV[pass] = sim.getVbusMillivolts();
+        }
+      }
+      detect_us[pass] = sim.micros() - t0;
+      ok = qc3.getCapability(&cap[pass]) && ok;
+    }
+    const bool class_b = (CHARGER_TYPES[i] == QC3SimCharger::SIM_QC3B);
+    printf("capability,%s,class_b %d,probe %lu ms peak %u mV step %lu us,cached %lu ms peak %u mV\n",
+           typeName(CHARGER_TYPES[i]), cap[0].class_b ? 1 : 0, (unsigned long)(detect_us[0] / 1000U),
+           peak_mV[0], (unsigned long)cap[0].step_us, (unsigned long)(detect_us[1] / 1000U),
+           peak_mV[1]);
+    if (!ok || (cap[0].class_b != class_b) || (cap[0].probe != ESP32_QC3_CTL::CAP_PROBE_VAR) ||
+        cap[0].cached || (peak_mV[0] >= 13000U) || (class_b != (cap[0].step_us != 0U)) ||
+        (cap[0].var_max_mV != (class_b ? 20000U : 12000U)) || !cap[1].cached ||
+        (cap[1].class_b != class_b) || (qc3.getUseClassB() != class_b) ||
+        (detect_us[1] >= detect_us[0]) || (peak_mV[1] > 5500U)) {
+      printf("  unexpected capability result for %s\n", typeName(CHARGER_TYPES[i]));
+      failures++;
+    }
+  }
+  return failures;
+}
+
+// One entry per scenario; each builds its own simulator and controller.
+struct Scenario {
+  const char *name;
+  int (*run)();
+};
+
+static const Scenario SCENARIOS[] = {
+  { "detection", runDetection },
+  { "varcancel", runVarCancel },
+  { "multiport", runMultiPort },
+  { "resume", runResume },
+  { "resume_swap", runResumeSwap },
+  { "sequence", runSequence },
+  { "log", runLog },
+  { "energy", runEnergy },
+  { "hotplug", runHotplug },
+  { "protection", runProtection },
+  { "hotplug_uvp", runHotplugUvp },
+  { "hotplug_uvp_early", runHotplugUvpEarly },
+  { "capability", runCapability },
+};
+
+int main() {
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); i++) {
+    const int n = SCENARIOS[i].run();
+    if (n != 0) {
+      printf("FAILED %s (%d)\n", SCENARIOS[i].name, n);
+      failures += n;
+    }
+  }
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Convert an HTML file into a gzip-compressed PROGMEM header.
+
+Usage (from the repository root):
+  python3 extras/tools/html2gz.py examples/AtomS3_QC3_WebUI/data/index.html \
+      examples/AtomS3_QC3_WebUI/WebUIPage.h htmlPageGz
+
+Leading indentation is stripped line by line (line breaks are kept so
+inline scripts behave the same), then the page is compressed with gzip -9
+and a fixed mtime so the output and its ETag only change with the input.
+The header defines <name>[] (PROGMEM), <name>Len and <NAME>_ETAG.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.stderr.write(__doc__)
+        return 1
+    src, dst, name = sys.argv[1:4]
+
+    with open(src, encoding="utf-8") as f:
+        lines = [line.strip() for line in f.read().splitlines()]
+    text = "\n".join(line for line in lines if line) + "\n"
+    data = gzip.compress(text.encode("utf-8"), compresslevel=9, mtime=0)
+    etag = hashlib.sha1(data).hexdigest()[:16]
+
+    macro = re.sub(r"(?<!^)(?=[A-Z])", "_", name).upper()
+    guard = re.sub(r"[^A-Za-z0-9]", "_", os.path.basename(dst)).upper()
+    rel = os.path.basename(src)
+
+    out = []
+    out.append("// Generated by extras/tools/html2gz.py from data/%s. Do not edit." % rel)
+    out.append("// %d bytes -> %d bytes (gzip)" % (len(text.encode("utf-8")), len(data)))
+    out.append("#ifndef %s" % guard)
+    out.append("#define %s" % guard)
+    out.append("")
+    out.append("#include <Arduino.h>")
+    out.append("")
+    out.append('#define %s_ETAG "\\"%s\\""' % (macro, etag))
+    out.append("")
+    out.append("const size_t %sLen = %d;" % (name, len(data)))
+    out.append("const uint8_t %s[] PROGMEM = {" % name)
+    for i in range(0, len(data), 16):
+        out.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    out.append("};")
+    out.append("")
+    out.append("#endif // %s" % guard)
+
+    with open(dst, "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(out) + "\n")
+    print("%s: %d bytes -> %d bytes, ETag %s" % (dst, len(text.encode("utf-8")), len(data), etag))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
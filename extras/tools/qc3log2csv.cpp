@@ -0,0 +1,116 @@
+// Converts a QC3Logger ring log (copied from LittleFS/SPIFFS) to CSV.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++11 -O2 -Isrc extras/tools/qc3log2csv.cpp src/ESP32_QC3_Log.cpp -o qc3log2csv
+// Add -DQC3_LOG_BLOCK_SIZE=<n> if the firmware was built with a different
+// block size.
+//
+// Usage:
+//   qc3log2csv <log.bin> [out.csv]
+//
+// Blocks that are unused or fail the checksum are skipped; the rest are
+// decoded oldest first by sequence number. Times are in seconds from the
+// first record in the file. Summary goes to stderr.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <ESP32_QC3_Log.h>
+
+struct Block {
+  uint32_t seq;
+  size_t offset;
+};
+
+struct Output {
+  FILE *out;
+  bool has_origin;
+  uint64_t origin_us;
+  unsigned long records;
+};
+
+static const char *typeName(uint8_t type) {
+  switch (type) {
+    case QC3Logger::LOG_SAMPLE: return "sample";
+    case QC3Logger::LOG_MODE: return "mode";
+    case QC3Logger::LOG_EVENT: return "event";
+    default: return "?";
+  }
+}
+
+static void writeRecord(const QC3Logger::Record &rec, void *arg) {
+  Output *o = static_cast<Output *>(arg);
+  if (!o->has_origin) {
+    o->origin_us = rec.t_us;
+    o->has_origin = true;
+  }
+  const uint64_t t = (rec.t_us >= o->origin_us) ? (rec.t_us - o->origin_us) : 0U;
+  fprintf(o->out, "%lu.%06lu,%s,%u,%ld,%u,", (unsigned long)(t / 1000000U),
+          (unsigned long)(t % 1000000U), typeName(rec.type), rec.vbus_mV, (long)rec.current_mA,
+          rec.mode);
+  if (rec.type == QC3Logger::LOG_EVENT) {
+    fprintf(o->out, "%u,%ld\n", rec.code, (long)rec.value);
+  } else {
+    fprintf(o->out, ",\n");
+  }
+  o->records++;
+}
+
+int main(int argc, char **argv) {
+  if ((argc < 2) || (argc > 3)) {
+    fprintf(stderr, "usage: %s <log.bin> [out.csv]\n", argv[0]);
+    return 2;
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (in == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(in);
+
+  std::vector<Block> blocks;
+  size_t skipped = 0;
+  for (size_t off = 0; off + QC3Logger::BLOCK_SIZE <= data.size(); off += QC3Logger::BLOCK_SIZE) {
+    QC3Logger::BlockInfo info;
+    if (QC3Logger::readBlockInfo(&data[off], &info)) {
+      Block b = { info.seq, off };
+      blocks.push_back(b);
+    } else {
+      skipped++;
+    }
+  }
+  std::sort(blocks.begin(), blocks.end(),
+            [](const Block &a, const Block &b) { return a.seq < b.seq; });
+
+  Output o = { stdout, false, 0U, 0UL };
+  if (argc == 3) {
+    o.out = fopen(argv[2], "w");
+    if (o.out == NULL) {
+      perror(argv[2]);
+      return 1;
+    }
+  }
+  fprintf(o.out, "t_s,type,vbus_mV,current_mA,mode,code,value\n");
+  for (size_t i = 0; i < blocks.size(); i++) {
+    (void)QC3Logger::decodeBlock(&data[blocks[i].offset], writeRecord, &o);
+  }
+  if (o.out != stdout) {
+    fclose(o.out);
+  }
+
+  fprintf(stderr, "%lu blocks, %lu skipped, %lu records\n", (unsigned long)blocks.size(),
+          (unsigned long)skipped, o.records);
+  if (!blocks.empty() && (blocks.back().seq - blocks.front().seq + 1U != blocks.size())) {
+    fprintf(stderr, "warning: sequence gap (blocks %lu..%lu)\n", (unsigned long)blocks.front().seq,
+            (unsigned long)blocks.back().seq);
+  }
+  return 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file ESP32_QC3_AdcStream.cpp
+ * @brief ESP32_QC3_CTLの連続ADCサンプリング（DMA）実装
+ * 
+ * addAdcPin()で登録したADC1ピンをadc_continuousドライバでサンプリングし、
+ * ピン毎にdecimation個ずつ平均・最小・最大を求めて公開します。
+ * ESP-IDF 5.x（Arduino-ESP32 3.x）以降で利用できます。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(__has_include)
+ #if __has_include(<esp_adc/adc_continuous.h>)
+  #include <esp_adc/adc_continuous.h>
+  #define QC3_HAS_ADC_CONTINUOUS 1
+ #endif
+#endif
+
+#if defined(QC3_HAS_ADC_CONTINUOUS)
+ #if defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S2)
+  #define QC3_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+  #define QC3_ADC_GET_CHANNEL(p) ((p)->type1.channel)
+  #define QC3_ADC_GET_DATA(p)    ((p)->type1.data)
+ #else
+  #define QC3_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+  #define QC3_ADC_GET_CHANNEL(p) ((p)->type2.channel)
+  #define QC3_ADC_GET_DATA(p)    ((p)->type2.data)
+ #endif
+
+static const uint32_t QC3_ADC_FRAME_SIZE = 256U;  ///< 1回の読み出しサイズ（byte）
+static const uint32_t QC3_ADC_POOL_SIZE = 1024U;  ///< DMAリングバッファサイズ（byte）
+#endif
+
+/**
+ * @brief 連続ADCサンプリング開始
+ * @param sample_rate_hz 全チャンネル合計のサンプリング周波数（Hz）
+ * @param decimation 平均化するサンプル数（ピン毎）
+ * @return 開始結果（true: 成功, false: 非対応または失敗）
+ */
+bool ESP32_QC3_CTL::startAdcStream(uint32_t sample_rate_hz, uint16_t decimation) {
+#if defined(QC3_HAS_ADC_CONTINUOUS)
+    if (_adc_stream != NULL) {
+        stopAdcStream();
+    }
+
+    adc_digi_pattern_config_t pattern[MAX_ADC_PINS];
+    uint8_t patternNum = 0U;
+    for (uint8_t i = 0U; i < _adcPinCount; i++) {
+        adc_unit_t unit;
+        adc_channel_t channel;
+        _adcStreamChan[i] = 0xFFU;
+        if (adc_continuous_io_to_channel((int)_adcPins[i], &unit, &channel) != ESP_OK) {
+            continue;
+        }
+        // ADC2はWi-Fiと競合し、連続モード非対応のターゲットもあるため対象外
+        if (unit != ADC_UNIT_1) {
+            continue;
+        }
+        pattern[patternNum].atten = _adcPinAtten[i];
+        pattern[patternNum].channel = (uint8_t)channel;
+        pattern[patternNum].unit = (uint8_t)unit;
+        pattern[patternNum].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        patternNum++;
+        _adcStreamChan[i] = (uint8_t)channel;
+        _adcStreamSum[i] = 0U;
+        _adcStreamCnt[i] = 0U;
+        _adcStreamMin[i] = 0xFFFFU;
+        _adcStreamMax[i] = 0U;
+        _adcStreamData[i].seq = 0U;
+    }
+    if (patternNum == 0U) {
+        return false;
+    }
+
+    adc_continuous_handle_t handle = NULL;
+    adc_continuous_handle_cfg_t handleCfg = {};
+    handleCfg.max_store_buf_size = QC3_ADC_POOL_SIZE;
+    handleCfg.conv_frame_size = QC3_ADC_FRAME_SIZE;
+    if (adc_continuous_new_handle(&handleCfg, &handle) != ESP_OK) {
+        return false;
+    }
+
+    adc_continuous_config_t digCfg = {};
+    digCfg.pattern_num = patternNum;
+    digCfg.adc_pattern = pattern;
+    digCfg.sample_freq_hz = sample_rate_hz;
+    digCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digCfg.format = QC3_ADC_OUTPUT_FORMAT;
+    if ((adc_continuous_config(handle, &digCfg) != ESP_OK) ||
+        (adc_continuous_start(handle) != ESP_OK)) {
+        (void)adc_continuous_deinit(handle);
+        return false;
+    }
+
+    _adcStreamDecim = (decimation > 0U) ? decimation : 1U;
+    _adc_stream = handle;
+    return true;
+#else
+    (void)sample_rate_hz;
+    (void)decimation;
+    return false;
+#endif
+}
+
+/**
+ * @brief 連続ADCサンプリング停止
+ */
+void ESP32_QC3_CTL::stopAdcStream() {
+#if defined(QC3_HAS_ADC_CONTINUOUS)
+    if (_adc_stream == NULL) {
+        return;
+    }
+    adc_continuous_handle_t handle = (adc_continuous_handle_t)_adc_stream;
+    _adc_stream = NULL;
+    (void)adc_continuous_stop(handle);
+    (void)adc_continuous_deinit(handle);
+#endif
+    for (uint8_t i = 0U; i < MAX_ADC_PINS; i++) {
+        _adcStreamChan[i] = 0xFFU;
+    }
+}
+
+/**
+ * @brief 連続ADCサンプリング中かどうか
+ * @return true: 実行中, false: 停止中
+ */
+bool ESP32_QC3_CTL::isAdcStreaming() {
+    return _adc_stream != NULL;
+}
+
+/**
+ * @brief DMAバッファのサンプルを取り込む
+ * @return 取り込んだサンプル数
+ */
+uint16_t ESP32_QC3_CTL::pollAdcStream() {
+    uint16_t samples = 0U;
+#if defined(QC3_HAS_ADC_CONTINUOUS)
+    if (_adc_stream == NULL) {
+        return 0U;
+    }
+    adc_continuous_handle_t handle = (adc_continuous_handle_t)_adc_stream;
+
+    uint8_t buf[QC3_ADC_FRAME_SIZE];
+    uint32_t len = 0U;
+    while (adc_continuous_read(handle, buf, QC3_ADC_FRAME_SIZE, &len, 0) == ESP_OK) {
+        for (uint32_t i = 0U; (i + SOC_ADC_DIGI_RESULT_BYTES) <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&buf[i];
+            const uint8_t channel = (uint8_t)QC3_ADC_GET_CHANNEL(p);
+            for (uint8_t j = 0U; j < _adcPinCount; j++) {
+                if (_adcStreamChan[j] == channel) {
+                    pushAdcStreamSample(j, (uint16_t)QC3_ADC_GET_DATA(p));
+                    samples++;
+                    break;
+                }
+            }
+        }
+    }
+#endif
+    return samples;
+}
+
+/**
+ * @brief 間引き後データの取得
+ * @param pin ピン番号
+ * @param data 取得先
+ * @return 取得結果（true: 成功, false: 対象外のピンまたは未取得）
+ */
+bool ESP32_QC3_CTL::getAdcStream(uint8_t pin, AdcStreamData *data) {
+    if (_adc_stream == NULL) {
+        return false;
+    }
+    const int8_t idx = findAdcPin(pin);
+    if ((idx < 0) || (_adcStreamChan[idx] == 0xFFU) || (_adcStreamData[idx].seq == 0U)) {
+        return false;
+    }
+
+    // 更新中（奇数）または読み出し中に更新された場合は読み直す
+    uint32_t seq;
+    do {
+        seq = _adcStreamData[idx].seq;
+        data->avg = _adcStreamData[idx].avg;
+        data->min = _adcStreamData[idx].min;
+        data->max = _adcStreamData[idx].max;
+    } while (((seq & 1U) != 0U) || (seq != _adcStreamData[idx].seq));
+    data->seq = seq >> 1;
+    return true;
+}
+
+/**
+ * @brief サンプルの平均化
+ * @param idx 登録済みADCピンのインデックス
+ * @param raw ADC生値
+ */
+void ESP32_QC3_CTL::pushAdcStreamSample(uint8_t idx, uint16_t raw) {
+    _adcStreamSum[idx] += raw;
+    if (raw < _adcStreamMin[idx]) {
+        _adcStreamMin[idx] = raw;
+    }
+    if (raw > _adcStreamMax[idx]) {
+        _adcStreamMax[idx] = raw;
+    }
+    _adcStreamCnt[idx]++;
+
+    if (_adcStreamCnt[idx] >= _adcStreamDecim) {
+        // seqは更新中に奇数となる（getAdcStream()側で読み直しの判定に使用）
+        _adcStreamData[idx].seq = _adcStreamData[idx].seq + 1U;
+        _adcStreamData[idx].avg = (uint16_t)(_adcStreamSum[idx] / _adcStreamCnt[idx]);
+        _adcStreamData[idx].min = _adcStreamMin[idx];
+        _adcStreamData[idx].max = _adcStreamMax[idx];
+        _adcStreamData[idx].seq = _adcStreamData[idx].seq + 1U;
+        _adcStreamSum[idx] = 0U;
+        _adcStreamCnt[idx] = 0U;
+        _adcStreamMin[idx] = 0xFFFFU;
+        _adcStreamMax[idx] = 0U;
+    }
+}
@@ -0,0 +1,234 @@
+/**
+ * @file ESP32_QC3_Bench.h
+ * @brief 処理時間計測用の統計（最小・中央値・p99）と出力整形
+ *
+ * 計測値はCPUサイクルやns等の任意の単位（tick）で記録し、出力時に
+ * ticks_per_usでns換算します。動的メモリ確保なし、Arduino非依存のため
+ * 実機のスケッチとPC上のプログラムの両方から使用できます。
+ */
+
+#ifndef ESP32_QC3_BENCH_H
+#define ESP32_QC3_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief 処理時間の統計
+ * @tparam N 保持するサンプル数
+ */
+template <uint16_t N>
+class QC3BenchStats {
+    static_assert(N > 0U, "sample count must be positive");
+
+public:
+    QC3BenchStats() {
+        _overhead = 0U;
+        reset();
+    }
+
+    /**
+     * @brief サンプルの破棄
+     */
+    void reset() {
+        _count = 0U;
+        _sum = 0U;
+        _sorted = true;
+    }
+
+    /**
+     * @brief 計測ごとに差し引く固定の計測オーバーヘッド設定
+     * @param ticks オーバーヘッド（tick）
+     */
+    void setOverhead(uint32_t ticks) {
+        _overhead = ticks;
+    }
+
+    /**
+     * @brief サンプルの追加
+     * @param ticks 処理時間（tick）
+     * @return 追加結果（true: 成功, false: 満杯）
+     */
+    bool add(uint32_t ticks) {
+        if (_count >= N) {
+            return false;
+        }
+        ticks = (ticks > _overhead) ? (ticks - _overhead) : 0U;
+        _buf[_count++] = ticks;
+        _sum += ticks;
+        _sorted = false;
+        return true;
+    }
+
+    /**
+     * @brief 関数の処理時間を繰り返し計測
+     * @param now 時刻取得関数（tickを返す）
+     * @param fn 計測対象
+     * @param warmup 記録しない事前実行回数
+     * @note サンプルが満杯になるまで計測する
+     */
+    template <typename Clock, typename Fn>
+    void run(Clock now, Fn fn, uint16_t warmup = 8U) {
+        for (uint16_t i = 0U; i < warmup; i++) {
+            fn();
+        }
+        while (_count < N) {
+            const uint32_t t0 = now();
+            fn();
+            (void)add(now() - t0);
+        }
+    }
+
+    /**
+     * @brief 空の処理を計測してオーバーヘッドに設定
+     * @param now 時刻取得関数（tickを返す）
+     */
+    template <typename Clock>
+    void calibrate(Clock now) {
+        uint32_t best = 0xFFFFFFFFUL;
+        for (uint16_t i = 0U; i < 64U; i++) {
+            const uint32_t t0 = now();
+            const uint32_t dt = now() - t0;
+            if (dt < best) {
+                best = dt;
+            }
+        }
+        _overhead = best;
+    }
+
+    uint16_t count() const {
+        return _count;
+    }
+
+    uint32_t min() {
+        return percentile(0U);
+    }
+
+    uint32_t median() {
+        return percentile(50U);
+    }
+
+    uint32_t max() {
+        return percentile(100U);
+    }
+
+    /**
+     * @brief パーセンタイル値
+     * @param p パーセント（0〜100）
+     * @return 処理時間（tick、サンプル無しは0）
+     */
+    uint32_t percentile(uint8_t p) {
+        if (_count == 0U) {
+            return 0U;
+        }
+        sort();
+        if (p > 100U) {
+            p = 100U;
+        }
+        // nearest-rank
+        uint32_t rank = ((uint32_t)p * _count + 99U) / 100U;
+        if (rank > 0U) {
+            rank--;
+        }
+        return _buf[rank];
+    }
+
+    /**
+     * @brief 平均値
+     * @return 処理時間（tick）
+     */
+    uint32_t mean() const {
+        return (_count > 0U) ? (uint32_t)(_sum / _count) : 0U;
+    }
+
+    /**
+     * @brief CSVのヘッダ行
+     * @param buf 出力先
+     * @param len 出力先の長さ
+     * @return 書き込んだ文字数（snprintfの戻り値）
+     */
+    static int formatCsvHeader(char *buf, size_t len) {
+        return snprintf(buf, len, "name,n,min_ns,median_ns,p99_ns,max_ns,ops_per_s");
+    }
+
+    /**
+     * @brief 結果をCSVの1行へ整形
+     * @param buf 出力先
+     * @param len 出力先の長さ
+     * @param name 計測名
+     * @param ticks_per_us 1usあたりのtick数
+     * @return 書き込んだ文字数（snprintfの戻り値）
+     */
+    int formatCsv(char *buf, size_t len, const char *name, uint32_t ticks_per_us) {
+        return snprintf(buf, len, "%s,%u,%lu,%lu,%lu,%lu,%lu",
+            name, (unsigned)_count,
+            (unsigned long)toNs(min(), ticks_per_us),
+            (unsigned long)toNs(median(), ticks_per_us),
+            (unsigned long)toNs(percentile(99U), ticks_per_us),
+            (unsigned long)toNs(max(), ticks_per_us),
+            (unsigned long)opsPerSecond(ticks_per_us));
+    }
+
+    /**
+     * @brief 結果をJSONの1行へ整形
+     * @param buf 出力先
+     * @param len 出力先の長さ
+     * @param name 計測名
+     * @param ticks_per_us 1usあたりのtick数
+     * @return 書き込んだ文字数（snprintfの戻り値）
+     */
+    int formatJson(char *buf, size_t len, const char *name, uint32_t ticks_per_us) {
+        return snprintf(buf, len,
+            "{\"name\":\"%s\",\"n\":%u,\"min_ns\":%lu,\"median_ns\":%lu,"
+            "\"p99_ns\":%lu,\"max_ns\":%lu,\"ops_per_s\":%lu}",
+            name, (unsigned)_count,
+            (unsigned long)toNs(min(), ticks_per_us),
+            (unsigned long)toNs(median(), ticks_per_us),
+            (unsigned long)toNs(percentile(99U), ticks_per_us),
+            (unsigned long)toNs(max(), ticks_per_us),
+            (unsigned long)opsPerSecond(ticks_per_us));
+    }
+
+private:
+    uint32_t _buf[N];
+    uint16_t _count;
+    uint64_t _sum;
+    uint32_t _overhead;
+    bool _sorted;
+
+    /**
+     * @brief サンプルの昇順整列（挿入ソート、結果出力時のみ）
+     */
+    void sort() {
+        if (_sorted) {
+            return;
+        }
+        for (uint16_t i = 1U; i < _count; i++) {
+            const uint32_t v = _buf[i];
+            uint16_t j = i;
+            while ((j > 0U) && (_buf[j - 1U] > v)) {
+                _buf[j] = _buf[j - 1U];
+                j--;
+            }
+            _buf[j] = v;
+        }
+        _sorted = true;
+    }
+
+    static uint32_t toNs(uint32_t ticks, uint32_t ticks_per_us) {
+        if (ticks_per_us == 0U) {
+            return 0U;
+        }
+        return (uint32_t)(((uint64_t)ticks * 1000U) / ticks_per_us);
+    }
+
+    uint32_t opsPerSecond(uint32_t ticks_per_us) const {
+        if ((_count == 0U) || (_sum == 0U)) {
+            return 0U;
+        }
+        return (uint32_t)(((uint64_t)ticks_per_us * 1000000U * _count) / _sum);
+    }
+};
+
+#endif // ESP32_QC3_BENCH_H
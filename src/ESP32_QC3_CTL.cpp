@@ -78,6 +78,14 @@ static bool getAdcUnitFromPin(uint8_t pin, adc_unit_t *unit) {
 }
 #endif
 
+#if defined(ARDUINO_ARCH_ESP32)
+ #define QC3_VAR_LOCK()   portENTER_CRITICAL(&_var_mux)
+ #define QC3_VAR_UNLOCK() portEXIT_CRITICAL(&_var_mux)
+#else
+ #define QC3_VAR_LOCK()
+ #define QC3_VAR_UNLOCK()
+#endif
+
 /**
  * @brief コンストラクタ
  * @param dp_h D+端子のHIGHピン
@@ -88,6 +96,7 @@ static bool getAdcUnitFromPin(uint8_t pin, adc_unit_t *unit) {
  * @param out_en 出力有効ピン（オプション）
  */
 ESP32_QC3_CTL::ESP32_QC3_CTL(uint8_t dp_h, uint8_t dp_l, uint8_t dm_h, uint8_t dm_l, uint8_t vbus_det, uint8_t out_en) {
+    setHal(NULL);
     _dp_h = dp_h;
     _dp_l = dp_l;
     _dm_h = dm_h;
@@ -106,11 +115,129 @@ ESP32_QC3_CTL::ESP32_QC3_CTL(uint8_t dp_h, uint8_t dp_l, uint8_t dm_h, uint8_t d
     _is_on = false;
     _use_class_b = false;
 
+    _pin_backend = PIN_BACKEND_GPIO;
+    _begin_backend = PIN_BACKEND_GPIO;
+    for (uint8_t bank = 0U; bank < 2U; bank++) {
+        _dp_mask.h[bank] = qc3PinMask(dp_h, bank);
+        _dp_mask.l[bank] = qc3PinMask(dp_l, bank);
+        _dm_mask.h[bank] = qc3PinMask(dm_h, bank);
+        _dm_mask.l[bank] = qc3PinMask(dm_l, bank);
+    }
+    _dp_state = QC_HIZ;
+    _dm_state = QC_HIZ;
+
+    _detect_state = DETECT_IDLE;
+    _detect_ts = 0;
+    _detect_cb = NULL;
+    _detect_cb_arg = NULL;
+    memset(&_resume_state, 0, sizeof(_resume_state));
+    _resume_pending = false;
+    _resume_output = false;
+    _resumed = false;
+    _auto_save = false;
+    _save_dirty = false;
+    _save_ts = 0;
+    memset(&_save_last, 0, sizeof(_save_last));
+    _save_delay_ms = 2000;
+    _cap_probe = CAP_PROBE_20V;
+    _cap_use_cache = false;
+    _cap_dirty = false;
+    _cap_count = 0;
+    _cap_base_mV = 0;
+    _cap_pulse_us = 0;
+    _cap_rise = 0;
+    _cap_rise_us = 0;
+    memset(&_cap, 0, sizeof(_cap));
+    memset(_cap_cache, 0, sizeof(_cap_cache));
+    _hp_state = HOTPLUG_OFF;
+    _hp_restore_output = false;
+    _hp_low = false;
+    _hp_was_on = false;
+    _hp_tripped = false;
+    _hp_trip_ts = 0;
+    _hp_detach_mV = 3500;
+    _hp_attach_mV = 4500;
+    _hp_debounce_ms = 2;
+    _hp_settle_ms = 50;
+    _hp_ts = 0;
+    memset(&_hp_saved, 0, sizeof(_hp_saved));
+    _hp_cb = NULL;
+    _hp_cb_arg = NULL;
+    memset(&_prot_limits, 0, sizeof(_prot_limits));
+    _prot_enabled = false;
+    _fault_code = FAULT_NONE;
+    memset(&_fault_info, 0, sizeof(_fault_info));
+    _fault_reported = true;
+    memset(_prot_over, 0, sizeof(_prot_over));
+    memset(_prot_win_lo, 0, sizeof(_prot_win_lo));
+    memset(_prot_win_hi, 0, sizeof(_prot_win_hi));
+    memset(_prot_win_valid, 0, sizeof(_prot_win_valid));
+    _prot_miss = 0;
+    _fault_cb = NULL;
+    _fault_cb_arg = NULL;
+#if defined(ARDUINO_ARCH_ESP32)
+    _prot_timer = NULL;
+    portMUX_INITIALIZE(&_prot_mux);
+#endif
+
+    _detect_start = 0;
+    initTrace();
+
+    _var_state = VAR_IDLE;
+    _var_edge = false;
+    _var_target = 0;
+    _var_up = true;
+    _var_ts = 0;
+    _var_pulse_us = VAR_PULSE_US;
+    _var_gap_us = VAR_GAP_US;
+    _var_cb = NULL;
+    _var_cb_arg = NULL;
+#if defined(ARDUINO_ARCH_ESP32)
+    _var_timer = NULL;
+    portMUX_INITIALIZE(&_var_mux);
+#endif
+
     _adcPinCount = 0U;
     for (uint8_t i = 0U; i < MAX_ADC_PINS; i++) {
         _adcPins[i] = 0U;
         _adcPinAtten[i] = 0U;
+        _adcStreamChan[i] = 0xFFU;
+        _adcStreamSum[i] = 0U;
+        _adcStreamCnt[i] = 0U;
+        _adcStreamMin[i] = 0xFFFFU;
+        _adcStreamMax[i] = 0U;
+        _adcStreamData[i].avg = 0U;
+        _adcStreamData[i].min = 0U;
+        _adcStreamData[i].max = 0U;
+        _adcStreamData[i].seq = 0U;
+        _adcLutReady[i] = false;
     }
+    _adc_stream = NULL;
+    _adcStreamDecim = 1U;
+
+    _cal.vbus.gain_q16 = 65536;
+    _cal.vbus.offset = 0;
+    _cal.current.gain_q16 = 65536;
+    _cal.current.offset = 0;
+    _cur_sense = 0U;
+    _auto_zero = false;
+
+    _cmd_next_id.store(1U);
+    _cmd_done_id = 0U;
+    memset(&_snap, 0, sizeof(_snap));
+    _snap_seq.store(0U);
+    _energy = NULL;
+    _ctl_run = false;
+    _ctl_period_ms = 1U;
+#if defined(ARDUINO_ARCH_ESP32)
+    _ctl_task = NULL;
+#endif
+
+    _reg_state = REG_OFF;
+    _reg_target = 0;
+    _reg_tolerance = 0;
+    _reg_retrim_ms = 0;
+    _reg_ts = 0;
 }
 
 /**
@@ -119,7 +246,7 @@ ESP32_QC3_CTL::ESP32_QC3_CTL(uint8_t dp_h, uint8_t dp_l, uint8_t dm_h, uint8_t d
  */
 bool ESP32_QC3_CTL::begin() {
     // ピンの初期化
-    pinMode(_vbus_det, INPUT);
+    _hal->pinMode(_vbus_det, INPUT);
 
 #if defined(ARDUINO_ARCH_ESP32)
     analogReadResolution(12);
@@ -133,19 +260,46 @@ bool ESP32_QC3_CTL::begin() {
         );
     }
 #endif
+    for (uint8_t i = 0U; i < _adcPinCount; i++) {
+        buildAdcLut(i);
+    }
     
     if (_out_en > 0) {
-        pinMode(_out_en, OUTPUT);
-        digitalWrite(_out_en, LOW);
+        _hal->pinMode(_out_en, OUTPUT);
+        _hal->digitalWrite(_out_en, LOW);
     }
     
     // D+/D-をハイインピーダンス状態に設定
     set_DP(QC_HIZ);
     set_DM(QC_HIZ);
+    if (_begin_backend != PIN_BACKEND_GPIO) {
+        (void)setPinBackend(_begin_backend);
+    }
     
     return true;
 }
 
+/**
+ * @brief ハードウェア抽象化レイヤの設定
+ * @param hal GPIO/ADC/時刻操作の実装（NULLで既定のQC3ArduinoHal）
+ */
+void ESP32_QC3_CTL::setHal(QC3Hal *hal) {
+#if defined(ARDUINO)
+    if (hal == NULL) {
+        hal = &QC3ArduinoHal::instance();
+    }
+#endif
+    _hal = hal;
+}
+
+/**
+ * @brief ハードウェア抽象化レイヤの取得
+ * @return 使用中の実装
+ */
+QC3Hal *ESP32_QC3_CTL::getHal() {
+    return _hal;
+}
+
 /**
  * @brief ADCの検出値を電圧値に変換する
  * @param Vread ADCの読み取り値
@@ -259,7 +413,12 @@ float ESP32_QC3_CTL::readVoltage(uint8_t pin, uint16_t Vread) {
 }
 
 float ESP32_QC3_CTL::readVoltage(uint8_t pin) {
-    return readVoltage(pin, (uint16_t)analogRead(pin));
+    // 連続サンプリング中はワンショット読み出しと競合するため最新の平均値を使用
+    AdcStreamData data;
+    if (getAdcStream(pin, &data)) {
+        return readVoltage(pin, data.avg);
+    }
+    return readVoltage(pin, _hal->analogRead(pin));
 }
 
 bool ESP32_QC3_CTL::addAdcPin(uint8_t pin) {
@@ -270,9 +429,134 @@ bool ESP32_QC3_CTL::addAdcPin(uint8_t pin) {
 #endif
 }
 
+/**
+ * @brief 指定ピンの電圧を整数で取得
+ * @param pin ピン番号
+ * @return 電圧値（mV）
+ */
+uint16_t ESP32_QC3_CTL::readMillivolts(uint8_t pin) {
+    AdcStreamData data;
+    uint16_t mV;
+    if (getAdcStream(pin, &data)) {
+        mV = readMillivolts(pin, data.avg);
+    } else {
+        mV = readMillivolts(pin, _hal->analogRead(pin));
+    }
+    QC3_TRACE(TRACE_ADC, pin, mV);
+    return mV;
+}
+
+/**
+ * @brief ADCの読み取り値を電圧値（mV）に変換する
+ * @param pin ピン番号
+ * @param Vread ADCの読み取り値
+ * @return 電圧値（mV）
+ */
+uint16_t ESP32_QC3_CTL::readMillivolts(uint8_t pin, uint16_t Vread) {
+    const int8_t idx = findAdcPin(pin);
+    if (idx < 0) {
+        return (uint16_t)(readVoltage(pin, Vread) * 1000.0f + 0.5f);
+    }
+    if (!_adcLutReady[idx]) {
+        buildAdcLut((uint8_t)idx);
+    }
+
+    if (Vread > 4095U) {
+        Vread = 4095U;
+    }
+    const uint16_t *lut = _adcLut[idx];
+    const uint8_t k = (uint8_t)(Vread >> ADC_LUT_SHIFT);
+    const int32_t frac = (int32_t)(Vread & ((1U << ADC_LUT_SHIFT) - 1U));
+    const int32_t a = lut[k];
+    const int32_t b = lut[k + 1U];
+    return (uint16_t)(a + (((b - a) * frac) >> ADC_LUT_SHIFT));
+}
+
+/**
+ * @brief 登録済みADCピンを1回ずつ読み取り移動平均へ追加
+ */
+void ESP32_QC3_CTL::sampleAdcPins() {
+    for (uint8_t i = 0U; i < _adcPinCount; i++) {
+        (void)_adcFilter[i].push(readMillivolts(_adcPins[i]));
+    }
+}
+
+/**
+ * @brief 移動平均後の電圧を取得
+ * @param pin ピン番号
+ * @return 電圧値（mV）、未登録または未サンプリングのピンはreadMillivolts(pin)の値
+ */
+uint16_t ESP32_QC3_CTL::readFilteredMillivolts(uint8_t pin) {
+    const int8_t idx = findAdcPin(pin);
+    if ((idx < 0) || (_adcFilter[idx].count() == 0U)) {
+        return readMillivolts(pin);
+    }
+    return _adcFilter[idx].value();
+}
+
+/**
+ * @brief 登録済みADCピンの移動平均の窓長の設定
+ * @param len 窓長（1〜16、範囲外は丸める）
+ */
+void ESP32_QC3_CTL::setAdcFilterLength(uint8_t len) {
+    for (uint8_t i = 0U; i < MAX_ADC_PINS; i++) {
+        _adcFilter[i].setLength(len);
+    }
+}
+
+/**
+ * @brief ADC変換テーブルの作成
+ * @param idx 登録済みADCピンのインデックス
+ * @note 較正特性をピンのatten設定で求め、64コード毎の折れ点電圧を保持する
+ */
+void ESP32_QC3_CTL::buildAdcLut(uint8_t idx) {
+    const uint8_t pin = _adcPins[idx];
+#if defined(ARDUINO_ARCH_ESP32) && defined(ESP_IDF_VERSION_MAJOR) && (ESP_IDF_VERSION_MAJOR < 5)
+    adc_unit_t unit = ADC_UNIT_1;
+    esp_adc_cal_characteristics_t adcChars;
+    const bool hasUnit = getAdcUnitFromPin(pin, &unit);
+    if (hasUnit) {
+        (void)esp_adc_cal_characterize(
+            unit,
+            (adc_atten_t)_adcPinAtten[idx],
+            ADC_WIDTH_BIT_12,
+            0,
+            &adcChars
+        );
+    }
+#endif
+
+    for (uint8_t k = 0U; k < ADC_LUT_SIZE; k++) {
+        uint32_t raw = (uint32_t)k << ADC_LUT_SHIFT;
+        if (raw > 4095U) {
+            raw = 4095U;
+        }
+#if defined(ARDUINO_ARCH_ESP32) && defined(ESP_IDF_VERSION_MAJOR) && (ESP_IDF_VERSION_MAJOR < 5)
+        if (hasUnit) {
+            _adcLut[idx][k] = (uint16_t)esp_adc_cal_raw_to_voltage(raw, &adcChars);
+            continue;
+        }
+#endif
+        _adcLut[idx][k] = (uint16_t)(readVoltage(pin, (uint16_t)raw) * 1000.0f + 0.5f);
+    }
+    _adcLutReady[idx] = true;
+}
+
+int8_t ESP32_QC3_CTL::findAdcPin(uint8_t pin) {
+    for (uint8_t i = 0U; i < _adcPinCount; i++) {
+        if (_adcPins[i] == pin) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
 bool ESP32_QC3_CTL::addAdcPin(uint8_t pin, uint8_t attenuation) {
     for (uint8_t i = 0U; i < _adcPinCount; i++) {
         if (_adcPins[i] == pin) {
+            if (_adcPinAtten[i] != attenuation) {
+                _adcLutReady[i] = false;
+            }
             _adcPinAtten[i] = attenuation;
             return true;
         }
@@ -284,6 +568,7 @@ bool ESP32_QC3_CTL::addAdcPin(uint8_t pin, uint8_t attenuation) {
 
     _adcPins[_adcPinCount] = pin;
     _adcPinAtten[_adcPinCount] = attenuation;
+    _adcLutReady[_adcPinCount] = false;
     _adcPinCount++;
     return true;
 }
@@ -293,25 +578,32 @@ bool ESP32_QC3_CTL::addAdcPin(uint8_t pin, uint8_t attenuation) {
  * @param state 設定状態（QC_HIZ, QC_0V, QC_600mV, QC_3300mV）
  */
 void ESP32_QC3_CTL::set_DP(uint8_t state) {
+    QC3_TRACE(TRACE_DP, state, 0);
+    _dp_state = state;
+    if(_pin_backend == PIN_BACKEND_BUNDLE) {
+        writePairBundle(_dp_mask, state);
+        return;
+    }
+    
     if(state == QC_HIZ) {
-        pinMode(_dp_h, INPUT);
-        pinMode(_dp_l, INPUT);
+        _hal->pinMode(_dp_h, INPUT);
+        _hal->pinMode(_dp_l, INPUT);
     } else {
-        pinMode(_dp_h, OUTPUT);
-        pinMode(_dp_l, OUTPUT);
+        _hal->pinMode(_dp_h, OUTPUT);
+        _hal->pinMode(_dp_l, OUTPUT);
         
         if(state == QC_0V) {
-            digitalWrite(_dp_h, LOW);
-            digitalWrite(_dp_l, LOW);
+            _hal->digitalWrite(_dp_h, LOW);
+            _hal->digitalWrite(_dp_l, LOW);
         } else if(state == QC_600mV) {
-            digitalWrite(_dp_h, HIGH);
-            digitalWrite(_dp_l, LOW);
+            _hal->digitalWrite(_dp_h, HIGH);
+            _hal->digitalWrite(_dp_l, LOW);
         } else if(state == QC_3300mV) {
-            digitalWrite(_dp_h, HIGH);
-            digitalWrite(_dp_l, HIGH);
+            _hal->digitalWrite(_dp_h, HIGH);
+            _hal->digitalWrite(_dp_l, HIGH);
         } else {
-            digitalWrite(_dp_h, LOW);
-            digitalWrite(_dp_l, LOW);
+            _hal->digitalWrite(_dp_h, LOW);
+            _hal->digitalWrite(_dp_l, LOW);
         }
     }
 }
@@ -321,29 +613,127 @@ void ESP32_QC3_CTL::set_DP(uint8_t state) {
  * @param state 設定状態（QC_HIZ, QC_0V, QC_600mV, QC_3300mV）
  */
 void ESP32_QC3_CTL::set_DM(uint8_t state) {
+    QC3_TRACE(TRACE_DM, state, 0);
+    _dm_state = state;
+    if(_pin_backend == PIN_BACKEND_BUNDLE) {
+        writePairBundle(_dm_mask, state);
+        return;
+    }
+    
     if(state == QC_HIZ) {
-        pinMode(_dm_h, INPUT);
-        pinMode(_dm_l, INPUT);
+        _hal->pinMode(_dm_h, INPUT);
+        _hal->pinMode(_dm_l, INPUT);
     } else {
-        pinMode(_dm_h, OUTPUT);
-        pinMode(_dm_l, OUTPUT);
+        _hal->pinMode(_dm_h, OUTPUT);
+        _hal->pinMode(_dm_l, OUTPUT);
         
         if(state == QC_0V) {
-            digitalWrite(_dm_h, LOW);
-            digitalWrite(_dm_l, LOW);
+            _hal->digitalWrite(_dm_h, LOW);
+            _hal->digitalWrite(_dm_l, LOW);
         } else if(state == QC_600mV) {
-            digitalWrite(_dm_h, HIGH);
-            digitalWrite(_dm_l, LOW);
+            _hal->digitalWrite(_dm_h, HIGH);
+            _hal->digitalWrite(_dm_l, LOW);
         } else if(state == QC_3300mV) {
-            digitalWrite(_dm_h, HIGH);
-            digitalWrite(_dm_l, HIGH);
+            _hal->digitalWrite(_dm_h, HIGH);
+            _hal->digitalWrite(_dm_l, HIGH);
         } else {
-            digitalWrite(_dm_h, LOW);
-            digitalWrite(_dm_l, LOW);
+            _hal->digitalWrite(_dm_h, LOW);
+            _hal->digitalWrite(_dm_l, LOW);
         }
     }
 }
 
+/**
+ * @brief D+/D-端子の駆動方式設定
+ * @param backend 駆動方式（PIN_BACKEND_GPIO, PIN_BACKEND_BUNDLE）
+ * @return 設定結果（true: 成功, false: 非対応）
+ */
+bool ESP32_QC3_CTL::setPinBackend(uint8_t backend) {
+    if(backend == PIN_BACKEND_GPIO) {
+        _pin_backend = PIN_BACKEND_GPIO;
+    } else if(backend == PIN_BACKEND_BUNDLE) {
+#if defined(ARDUINO_ARCH_ESP32)
+        // IO MUX/GPIOマトリクスの設定はpinMode()で一度だけ行い、以降はレジスタのみ操作
+        const uint8_t pins[4] = { _dp_h, _dp_l, _dm_h, _dm_l };
+        for(uint8_t i = 0U; i < 4U; i++) {
+            _hal->pinMode(pins[i], OUTPUT);
+            _hal->digitalWrite(pins[i], LOW);
+        }
+        _pin_backend = PIN_BACKEND_BUNDLE;
+#else
+        return false;
+#endif
+    } else {
+        return false;
+    }
+    
+    // 現在の状態を新しい駆動方式で再設定
+    set_DP(_dp_state);
+    set_DM(_dm_state);
+    return true;
+}
+
+/**
+ * @brief D+/D-端子の駆動方式を取得
+ * @return 駆動方式（PIN_BACKEND_GPIO, PIN_BACKEND_BUNDLE）
+ */
+uint8_t ESP32_QC3_CTL::getPinBackend() {
+    return _pin_backend;
+}
+
+/**
+ * @brief H/Lピン対の一括設定
+ * @param mask H/Lピンのビットマスク
+ * @param state 設定状態（QC_HIZ, QC_0V, QC_600mV, QC_3300mV）
+ * @note H/Lの組み合わせは00/10/11のみで、状態間の遷移は一方向のビット変化になる。
+ *       同じバンクのピンであれば1回のW1TS/W1TC書き込みで同時に切り替わる。
+ */
+void ESP32_QC3_CTL::writePairBundle(const PairMask &mask, uint8_t state) {
+#if defined(ARDUINO_ARCH_ESP32)
+    const uint32_t both0 = mask.h[0] | mask.l[0];
+    const uint32_t both1 = mask.h[1] | mask.l[1];
+    
+    if(state == QC_HIZ) {
+        qc3GpioWriteEnable(both0, both1, false);
+        return;
+    }
+    
+    if(state == QC_600mV) {
+        qc3GpioWriteOut(mask.h[0], mask.h[1], true);
+        qc3GpioWriteOut(mask.l[0], mask.l[1], false);
+    } else if(state == QC_3300mV) {
+        qc3GpioWriteOut(both0, both1, true);
+    } else {
+        qc3GpioWriteOut(both0, both1, false);
+    }
+    qc3GpioWriteEnable(both0, both1, true);
+#else
+    (void)mask;
+    (void)state;
+#endif
+}
+
+/**
+ * @brief 可変モードの1ステップ分のパルス出力
+ * @param up true: D+パルス（増加）, false: D-パルス（減少）
+ * @note 割り込み禁止はレジスタ書き込みの間だけにし、パルス幅の待機は割り込みを許可して行う。
+ *       待機中に割り込まれてもパルスが長くなるだけで、充電器の判定（最小幅）には影響しない
+ */
+void ESP32_QC3_CTL::pulseBundle(bool up) {
+#if defined(ARDUINO_ARCH_ESP32)
+    const PairMask &mask = up ? _dp_mask : _dm_mask;
+    QC3_VAR_LOCK();
+    writePairBundle(mask, up ? QC_3300mV : QC_600mV);
+    QC3_VAR_UNLOCK();
+    _hal->delayMicroseconds(_var_pulse_us);
+    QC3_VAR_LOCK();
+    writePairBundle(mask, up ? QC_600mV : QC_3300mV);
+    QC3_VAR_UNLOCK();
+#else
+    (void)up;
+#endif
+}
+
 /**
  * @brief VBUS出力電圧設定
  * @param mode 電圧モード（QC_5V, QC_9V, QC_12V, QC_20V, QC_VAR）
@@ -354,7 +744,26 @@ bool ESP32_QC3_CTL::set_VBUS(uint8_t mode) {
         return false;
     }
     
+    // 可変モード中の再設定: 端子はパルススケジューラが操作中のため変更しない
+    QC3_VAR_LOCK();
+    const bool keep = (mode == QC_VAR) && (_qc_mode == QC_VAR) && (_var_state != VAR_IDLE);
     _qc_mode = mode;
+    // 固定電圧への切り替えで可変モードのパルス出力を中止
+    if(mode != QC_VAR) {
+        _var_state = VAR_IDLE;
+    }
+    QC3_VAR_UNLOCK();
+    if(keep) {
+        return true;
+    }
+    if(mode != QC_VAR) {
+        _reg_state = REG_OFF;
+        // 他のタスクが書き込み中のパルス端は、完了を待ってから上書きする
+        // （同じコアの低優先度タスクが書き込み中でも止まらないよう、待ち時間には上限を設ける）
+        const uint32_t t0 = _hal->micros();
+        while(_var_edge && ((uint32_t)(_hal->micros() - t0) < ((uint32_t)_var_pulse_us + VAR_EDGE_WAIT_US))) {
+        }
+    }
     
     switch(mode) {
         case QC_5V:
@@ -387,6 +796,8 @@ bool ESP32_QC3_CTL::set_VBUS(uint8_t mode) {
             _vbus_val = 5000;
             break;
     }
+    QC3_TRACE(TRACE_VBUS_MODE, mode, _vbus_val);
+    markStateDirty();
     
     return true;
 }
@@ -412,9 +823,10 @@ void ESP32_QC3_CTL::var_inc() {
         _vbus_val = QC3_VAR_MAX;
     } else {
         set_DP(QC_3300mV);
-        delayMicroseconds(200);
+        _hal->delayMicroseconds(200);
         set_DP(QC_600mV);
-        delay(100);
+        QC3_TRACE(TRACE_VAR_PULSE, 1, _vbus_val);
+        _hal->delay(100);
     }
 }
 
@@ -432,57 +844,457 @@ void ESP32_QC3_CTL::var_dec() {
         _vbus_val = QC3_VAR_MIN;
     } else {
         set_DM(QC_600mV);
-        delayMicroseconds(200);
+        _hal->delayMicroseconds(200);
         set_DM(QC_3300mV);
-        delay(100);
+        QC3_TRACE(TRACE_VAR_PULSE, 0, _vbus_val);
+        _hal->delay(100);
+    }
+}
+
+/**
+ * @brief 可変モードの目標電圧設定（ノンブロッキング）
+ * @param target_mV 目標電圧（mV、200mV単位に丸め）
+ * @return 設定結果（true: 受付, false: QC3以外）
+ */
+bool ESP32_QC3_CTL::setVarVoltage(uint16_t target_mV) {
+    if(_host_type != QC3) {
+        return false;
+    }
+    
+    const uint16_t vmax = varMax();
+    if(target_mV < QC3_VAR_MIN) {
+        target_mV = QC3_VAR_MIN;
+    } else if(target_mV > vmax) {
+        target_mV = vmax;
+    }
+    target_mV = (uint16_t)(((target_mV + 100U) / 200U) * 200U);
+    
+    const uint32_t now_us = _hal->micros();
+    bool enter = false;
+    if(_qc_mode != QC_VAR) {
+        // 可変モードへ移行し、最初のパルスはパルス間隔分待ってから出力
+        set_VBUS(QC_VAR);
+        enter = true;
+    }
+    
+    bool start = false;
+    markStateDirty();
+    QC3_VAR_LOCK();
+    _var_target = target_mV;
+    if(_var_state == VAR_IDLE) {
+        _var_state = VAR_GAP;
+        _var_ts = enter ? now_us : (now_us - _var_gap_us);
+        start = true;
     }
+    QC3_VAR_UNLOCK();
+    
+    if(start) {
+        armVarTimer();
+    }
+    return true;
+}
+
+/**
+ * @brief 可変モードの目標電圧を取得
+ * @return 目標電圧（mV）、待機中は現在の設定電圧
+ */
+uint16_t ESP32_QC3_CTL::getVarTarget() {
+    if(_var_state == VAR_IDLE) {
+        return _vbus_val;
+    }
+    return _var_target;
+}
+
+/**
+ * @brief パルス出力中かどうか
+ * @return true: 目標電圧へ移行中, false: 到達済み
+ */
+bool ESP32_QC3_CTL::isVarBusy() {
+    return _var_state != VAR_IDLE;
+}
+
+/**
+ * @brief パルススケジューラを進める
+ * @return スケジューラの状態（VAR_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollVar() {
+    return pollVar(_hal->micros());
+}
+
+/**
+ * @brief パルススケジューラを進める（時刻指定）
+ * @param now_us 現在時刻（us）
+ * @return スケジューラの状態（VAR_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollVar(uint32_t now_us) {
+#if defined(ARDUINO_ARCH_ESP32)
+    // esp_timerで駆動中は二重に進めない
+    if(_var_timer != NULL) {
+        return _var_state;
+    }
+#endif
+    return serviceVar(now_us);
+}
+
+/**
+ * @brief 可変モードのパルス幅・パルス間隔設定
+ * @param pulse_us パルス幅（us）
+ * @param gap_us パルス間隔（us）
+ */
+void ESP32_QC3_CTL::setVarPulseTiming(uint16_t pulse_us, uint32_t gap_us) {
+    _var_pulse_us = pulse_us;
+    _var_gap_us = gap_us;
+}
+
+/**
+ * @brief 目標電圧到達コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void ESP32_QC3_CTL::setVarCallback(VarCallback cb, void *arg) {
+    _var_cb = cb;
+    _var_cb_arg = arg;
+}
+
+/**
+ * @brief 可変モードの上限電圧
+ * @return 上限電圧（mV）
+ */
+uint16_t ESP32_QC3_CTL::varMax() {
+    return _use_class_b ? QC3B_VAR_MAX : QC3A_VAR_MAX;
 }
 
+/**
+ * @brief パルススケジューラ本体
+ * @param now_us 現在時刻（us）
+ * @return スケジューラの状態（VAR_STATE）
+ */
+uint8_t ESP32_QC3_CTL::serviceVar(uint32_t now_us) {
+    switch(_var_state) {
+        case VAR_PULSE: {
+            if((uint32_t)(now_us - _var_ts) < _var_pulse_us) {
+                break;
+            }
+            // set_VBUS()で中止された場合は端子に触れない
+            QC3_VAR_LOCK();
+            const bool valid = (_var_state == VAR_PULSE) && (_qc_mode == QC_VAR);
+            _var_edge = valid;
+            QC3_VAR_UNLOCK();
+            if(!valid) {
+                break;
+            }
+            
+            if(_var_up) {
+                set_DP(QC_600mV);
+                _vbus_val = _vbus_val + 200;
+            } else {
+                set_DM(QC_3300mV);
+                _vbus_val = _vbus_val - 200;
+            }
+            QC3_TRACE(TRACE_VAR_PULSE, _var_up ? 1 : 0, _vbus_val);
+            QC3_VAR_LOCK();
+            _var_edge = false;
+            if(_var_state == VAR_PULSE) {
+                _var_state = VAR_GAP;
+                _var_ts = now_us;
+            }
+            QC3_VAR_UNLOCK();
+            break;
+        }
+        case VAR_GAP: {
+            if((uint32_t)(now_us - _var_ts) < _var_gap_us) {
+                break;
+            }
+            bool done = false;
+            QC3_VAR_LOCK();
+            if(_var_state != VAR_GAP) {
+                QC3_VAR_UNLOCK();
+                break;
+            }
+            if((_qc_mode != QC_VAR) || (_vbus_val == _var_target)) {
+                _var_state = VAR_IDLE;
+                done = true;
+            } else {
+                // パルスの開始からset_VBUS()は端子の書き込み完了を待つ
+                _var_up = (_var_target > _vbus_val);
+                _var_state = VAR_PULSE;
+                _var_ts = now_us;
+                _var_edge = true;
+            }
+            QC3_VAR_UNLOCK();
+            
+            if(done) {
+                if((_var_cb != NULL) && (_qc_mode == QC_VAR)) {
+                    _var_cb(_vbus_val, _var_cb_arg);
+                }
+                break;
+            }
+            if(_pin_backend == PIN_BACKEND_BUNDLE) {
+                // パルス全体を一括出力し、そのままパルス間隔の待機へ
+                pulseBundle(_var_up);
+                if(_var_up) {
+                    _vbus_val = _vbus_val + 200;
+                } else {
+                    _vbus_val = _vbus_val - 200;
+                }
+                QC3_TRACE(TRACE_VAR_PULSE, _var_up ? 1 : 0, _vbus_val);
+                QC3_VAR_LOCK();
+                _var_edge = false;
+                if(_var_state == VAR_PULSE) {
+                    _var_state = VAR_GAP;
+                    _var_ts = _hal->micros();
+                }
+                QC3_VAR_UNLOCK();
+                break;
+            }
+            if(_var_up) {
+                set_DP(QC_3300mV);
+            } else {
+                set_DM(QC_600mV);
+            }
+            QC3_VAR_LOCK();
+            _var_edge = false;
+            QC3_VAR_UNLOCK();
+            break;
+        }
+        default:
+            break;
+    }
+    
+    return _var_state;
+}
+
+/**
+ * @brief パルス駆動タイマーの起動
+ * @note 次の状態遷移時刻に合わせてワンショットで再設定する
+ */
+void ESP32_QC3_CTL::armVarTimer() {
+#if defined(ARDUINO_ARCH_ESP32)
+    if(_var_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = &ESP32_QC3_CTL::varTimerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "qc3_var";
+        if(esp_timer_create(&args, &_var_timer) != ESP_OK) {
+            _var_timer = NULL;
+            return;
+        }
+    }
+    
+    uint32_t wait_us = 0;
+    const uint32_t elapsed = _hal->micros() - _var_ts;
+    if(_var_state == VAR_PULSE) {
+        wait_us = (elapsed < _var_pulse_us) ? (_var_pulse_us - elapsed) : 0;
+    } else if(_var_state == VAR_GAP) {
+        wait_us = (elapsed < _var_gap_us) ? (_var_gap_us - elapsed) : 0;
+    } else {
+        return;
+    }
+    (void)esp_timer_stop(_var_timer);
+    (void)esp_timer_start_once(_var_timer, (wait_us > 0) ? wait_us : 1);
+#endif
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * @brief パルス駆動タイマーのコールバック
+ * @param arg ESP32_QC3_CTLインスタンス
+ */
+void ESP32_QC3_CTL::varTimerCallback(void *arg) {
+    ESP32_QC3_CTL *self = (ESP32_QC3_CTL *)arg;
+    (void)self->serviceVar(self->_hal->micros());
+    self->armVarTimer();
+}
+#endif
+
 /**
  * @brief 接続されたポートの検出
  * @return ポートタイプ（BC_NA, BC_DCP, QC3）
+ * @note startDetect()/pollDetect()を完了まで回すブロッキング版
  */
 uint8_t ESP32_QC3_CTL::detect_Charger() {
+    startDetect();
+    while(pollDetect() != DETECT_DONE) {
+        _hal->delay(1);
+    }
+    if(_cap_dirty) {
+        _cap_dirty = false;
+        (void)saveCapabilityCache();
+    }
+    return _host_type;
+}
+
+/**
+ * @brief 接続されたポートの検出を開始（ノンブロッキング）
+ */
+void ESP32_QC3_CTL::startDetect() {
+    startDetect(_hal->millis());
+}
+
+/**
+ * @brief 接続されたポートの検出を開始（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ */
+void ESP32_QC3_CTL::startDetect(uint32_t now_ms) {
     set_DP(QC_HIZ);
     set_DM(QC_HIZ);
     
     // stage 1: check BC1.2 DCP
     set_DM(QC_0V);
     
-    // ADC to Voltage(mV)
-    _dp_val = readVoltage(_dp_h) * 1000;
-    
-    if(_dp_val >= 325) {
-        set_DM(QC_HIZ);
-        _host_type = BC_NA;
-        return BC_NA;
-    } else {
-        // stage 2: set host to QC3
-        set_DM(QC_HIZ);
-        set_DP(QC_600mV);
-        delay(1500);
-        
-        // ADC to Voltage(mV)
-        _dm_val = readVoltage(_dm_h) * 1000;
-        
-        if(_dm_val >= 325) {
-            set_DP(QC_HIZ);
-            _host_type = BC_DCP;
-            return BC_DCP;
-        } else {
-            _host_type = QC3;
-            // QC3.0検出後、20V設定時の電圧をチェックして_use_class_bを設定
-            set_VBUS(QC_20V);
-            delay(100);
-            float detected_voltage = readVoltage(_vbus_det);
-            if (detected_voltage >= 19.0f) {
+    _detect_state = DETECT_BC12;
+    _detect_ts = now_ms;
+    _resume_pending = false;
+    _resumed = false;
+    _detect_start = now_ms;
+}
+
+/**
+ * @brief 検出処理を進める
+ * @return 進行状態（DETECT_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollDetect() {
+    return pollDetect(_hal->millis());
+}
+
+/**
+ * @brief 検出処理を進める（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ * @return 進行状態（DETECT_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollDetect(uint32_t now_ms) {
+    switch(_detect_state) {
+        case DETECT_BC12:
+            // ADC to Voltage(mV)
+            _dp_val = readVoltage(_dp_h) * 1000;
+            QC3_TRACE(TRACE_DETECT, DETECT_BC12, _dp_val);
+            
+            if(_dp_val >= 325) {
+                set_DM(QC_HIZ);
+                finishDetect(BC_NA);
+            } else {
+                // stage 2: set host to QC3
+                set_DM(QC_HIZ);
+                set_DP(QC_600mV);
+                _detect_state = DETECT_HANDSHAKE;
+                _detect_ts = now_ms;
+            }
+            break;
+        case DETECT_HANDSHAKE:
+            if((uint32_t)(now_ms - _detect_ts) < DETECT_HANDSHAKE_MS) {
+                break;
+            }
+            
+            // ADC to Voltage(mV)
+            _dm_val = readVoltage(_dm_h) * 1000;
+            QC3_TRACE(TRACE_DETECT, DETECT_HANDSHAKE, _dm_val);
+            
+            if(_dm_val >= 325) {
+                set_DP(QC_HIZ);
+                finishDetect(BC_DCP);
+            } else {
+                _host_type = QC3;
+                beginCapability();
+                if(_resume_pending && !matchResumeCharger()) {
+                    // 前回と別の充電器: 前回の電圧・出力は使わず、通常の判定を行い5V・出力OFFで終える
+                    _resume_pending = false;
+                    if(_is_on) {
+                        (void)setOutput(false);
+                    }
+                }
+                if(_resume_pending) {
+                    // 前回と同じQC3充電器: Class B判定（20V印加）を省略して前回の電圧へ戻す
+                    _use_class_b = _resume_state.class_b;
+                    finishCapability(CAP_PROBE_SAVED, _cap.v5_mV, 0U);
+                    if(restoreState()) {
+                        finishDetect(QC3);
+                    } else {
+                        _detect_state = DETECT_RESUME;
+                        _detect_ts = now_ms;
+                    }
+                } else if(_cap_use_cache && findCapability()) {
+                    // 記録済みの充電器: Class B判定を省略
+                    finishDetect(QC3);
+                } else if(_cap_probe == CAP_PROBE_VAR) {
+                    // 12Vから可変モードで+200mVを要求し、20Vを印加せずに判定
+                    set_VBUS(QC_12V);
+                    _detect_state = DETECT_PROBE_12V;
+                    _detect_ts = now_ms;
+                } else {
+                    // QC3.0検出後、20V設定時の電圧をチェックして_use_class_bを設定
+                    set_VBUS(QC_20V);
+                    _detect_state = DETECT_CLASS_B;
+                    _detect_ts = now_ms;
+                }
+            }
+            break;
+        case DETECT_CLASS_B:
+            if((uint32_t)(now_ms - _detect_ts) < DETECT_CLASS_B_MS) {
+                break;
+            }
+            
+            _vbus_det_val = readVbusMillivolts();
+            QC3_TRACE(TRACE_DETECT, DETECT_CLASS_B, _vbus_det_val);
+            if(_vbus_det_val >= 19000U) {
                 _use_class_b = true;
             } else {
                 _use_class_b = false;
             }
             set_VBUS(QC_5V); // 初期状態に戻す
-            return QC3;
-        }
+            finishCapability(CAP_PROBE_20V, _vbus_det_val, 0U);
+            finishDetect(QC3);
+            break;
+        case DETECT_PROBE_12V:
+        case DETECT_PROBE_VAR:
+        case DETECT_PROBE_STEP:
+            pollProbe(now_ms);
+            break;
+        case DETECT_RESUME:
+            // 固定電圧の切り替えが完了してから可変モードへ移行する
+            if((uint32_t)(now_ms - _detect_ts) < DETECT_CLASS_B_MS) {
+                break;
+            }
+            (void)setVarVoltage(_resume_state.voltage);
+            finishDetect(QC3);
+            break;
+        default:
+            break;
+    }
+    
+    return _detect_state;
+}
+
+/**
+ * @brief 検出処理中かどうか
+ * @return true: 検出中, false: 未実行または完了
+ */
+bool ESP32_QC3_CTL::isDetecting() {
+    return (_detect_state != DETECT_IDLE) && (_detect_state != DETECT_DONE);
+}
+
+/**
+ * @brief 検出完了コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void ESP32_QC3_CTL::setDetectCallback(DetectCallback cb, void *arg) {
+    _detect_cb = cb;
+    _detect_cb_arg = arg;
+}
+
+/**
+ * @brief 検出完了処理
+ * @param host_type 検出結果（BC_NA, BC_DCP, QC3）
+ */
+void ESP32_QC3_CTL::finishDetect(uint8_t host_type) {
+    _host_type = host_type;
+    _detect_state = DETECT_DONE;
+    _resume_pending = false;
+    markStateDirty();
+    QC3_TRACE(TRACE_DETECT_DONE, host_type, _hal->millis() - _detect_start);
+    if(_detect_cb != NULL) {
+        _detect_cb(host_type, _detect_cb_arg);
     }
 }
 
@@ -503,6 +1315,22 @@ uint8_t ESP32_QC3_CTL::getHostType() {
 }
 
 
+/**
+ * @brief 現在の電圧モードを取得
+ * @return 電圧モード（QC_5V, QC_9V, QC_12V, QC_20V, QC_VAR）
+ */
+uint8_t ESP32_QC3_CTL::getMode() {
+    return _qc_mode;
+}
+
+/**
+ * @brief 検出の進行状態を取得
+ * @return 進行状態（DETECT_STATE）
+ */
+uint8_t ESP32_QC3_CTL::getDetectState() {
+    return _detect_state;
+}
+
 /**
  * @brief _use_class_bの現在の値を取得
  * @return _use_class_bの値
@@ -510,3 +1338,38 @@ uint8_t ESP32_QC3_CTL::getHostType() {
 bool ESP32_QC3_CTL::getUseClassB() {
     return _use_class_b;
 }
+
+/**
+ * @brief 出力ON/OFF設定
+ * @param on true: 出力ON, false: 出力OFF
+ * @return 設定結果（true: 成功, false: 出力有効ピン未設定またはフォルトをラッチ中）
+ */
+bool ESP32_QC3_CTL::setOutput(bool on) {
+    if (_out_en == 0U) {
+        return false;
+    }
+    // 保護機能のフォルトをラッチ中は出力ONにしない
+    if (on && (_fault_code != FAULT_NONE)) {
+        return false;
+    }
+    if (on && !_is_on && _auto_zero) {
+        (void)captureCurrentZero();
+    }
+    const bool was_on = _is_on;
+    if (!writeOutput(on)) {
+        return false;
+    }
+    QC3_TRACE(TRACE_OUTPUT, on ? 1 : 0, 0);
+    if (on != was_on) {
+        markStateDirty();
+    }
+    return true;
+}
+
+/**
+ * @brief 出力ON/OFF状態の取得
+ * @return true: 出力ON, false: 出力OFF
+ */
+bool ESP32_QC3_CTL::getOutput() {
+    return _is_on;
+}
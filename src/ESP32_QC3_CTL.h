@@ -11,12 +11,18 @@
 #ifndef ESP32_QC3_CTL_H
 #define ESP32_QC3_CTL_H
 
-#include <Arduino.h>
+#include "ESP32_QC3_Hal.h"
+#include "ESP32_QC3_Pins.h"
+#include "ESP32_QC3_Filter.h"
+#include "ESP32_QC3_Queue.h"
+#include "ESP32_QC3_Trace.h"
+#include "ESP32_QC3_Energy.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
  #if defined(ESP_IDF_VERSION_MAJOR) && (ESP_IDF_VERSION_MAJOR < 5)
   #include <driver/adc.h>
  #endif
+ #include <esp_timer.h>
 #endif
 
 /**
@@ -54,6 +60,255 @@ public:
         QC_VAR = 0x04     ///< 可変出力
     };
 
+    /**
+     * @brief D+/D-端子の駆動方式
+     */
+    enum PIN_BACKEND {
+        PIN_BACKEND_GPIO = 0x00,   ///< pinMode()/digitalWrite()による駆動
+        PIN_BACKEND_BUNDLE = 0x01  ///< GPIOレジスタへの一括書き込み
+    };
+
+    /**
+     * @brief 非同期検出の進行状態
+     */
+    enum DETECT_STATE {
+        DETECT_IDLE = 0x00,      ///< 未実行
+        DETECT_BC12 = 0x01,      ///< stage 1: BC1.2 DCP判定
+        DETECT_HANDSHAKE = 0x02, ///< stage 2: D+ 600mV印加後の待機中
+        DETECT_CLASS_B = 0x03,   ///< Class B判定（20V印加後の待機中）
+        DETECT_DONE = 0x04,      ///< 検出完了
+        DETECT_RESUME = 0x05,    ///< 高速復帰（固定電圧の安定待ち後に可変モードへ移行）
+        DETECT_PROBE_12V = 0x06, ///< 可変モードによる判定: 12V印加後の待機中
+        DETECT_PROBE_VAR = 0x07, ///< 可変モードによる判定: 可変モードへの移行待ち
+        DETECT_PROBE_STEP = 0x08 ///< 可変モードによる判定: +200mVパルスへの応答待ち
+    };
+
+    /**
+     * @brief Class A/Bの判定方法
+     */
+    enum CAP_PROBE {
+        CAP_PROBE_20V = 0x00,   ///< 20Vを印加してVBUSを確認（既定）
+        CAP_PROBE_VAR = 0x01,   ///< 12Vから可変モードで+200mVを要求し、VBUSの上昇を確認（最大12.2V）
+        CAP_PROBE_SAVED = 0x02  ///< 判定なし（startResume()の前回の状態を使用）
+    };
+
+    /**
+     * @brief 充電器の能力の記録
+     */
+    struct Capability {
+        uint32_t signature;   ///< 充電器の識別値（ホストタイプと5V出力時のVBUS）
+        uint8_t probe;        ///< 判定方法（CAP_PROBE）
+        bool class_b;         ///< Class B（最大20V）
+        bool cached;          ///< 保存済みの記録を使った（判定を省略）
+        uint8_t reserved;     ///< 予約
+        uint16_t v5_mV;       ///< 5V出力時のVBUS実測値（mV）
+        uint16_t vmax_mV;     ///< 判定中に観測したVBUSの最大値（mV）
+        uint16_t max_mV;      ///< 最大電圧（mV）
+        uint16_t var_min_mV;  ///< 可変モードの下限（mV）
+        uint16_t var_max_mV;  ///< 可変モードの上限（mV）
+        uint32_t step_us;     ///< +200mVパルスからVBUSの上昇を検出するまでの時間（us、0: 未計測）
+    };
+
+    static const uint8_t CAP_CACHE_LEN = 4U;  ///< 能力判定の記録を保持する充電器の数
+
+    /**
+     * @brief 検出完了コールバック
+     * @param host_type 検出結果（BC_NA, BC_DCP, QC3）
+     * @param arg setDetectCallback()で渡したユーザー引数
+     */
+    typedef void (*DetectCallback)(uint8_t host_type, void *arg);
+
+    /**
+     * @brief 保護機能のフォルトコード
+     */
+    enum FAULT_CODE {
+        FAULT_NONE = 0x00,  ///< フォルトなし
+        FAULT_OVP = 0x01,   ///< 過電圧（VBUS > ovp_mV）
+        FAULT_UVP = 0x02,   ///< 低電圧（VBUS < uvp_mV）
+        FAULT_OCP = 0x03    ///< 過電流（電流 > ocp_mA）
+    };
+
+    /**
+     * @brief 保護機能のしきい値
+     */
+    struct ProtectionLimits {
+        uint16_t ovp_mV;     ///< 過電圧しきい値（mV、0: 無効）
+        uint16_t uvp_mV;     ///< 低電圧しきい値（mV、0: 無効）
+        int32_t ocp_mA;      ///< 過電流しきい値（mA、0: 無効）
+        uint8_t trip_count;  ///< 連続してしきい値を超えたら遮断するサンプル数（0は1とみなす）
+    };
+
+    /**
+     * @brief 保護機能による遮断の記録
+     */
+    struct FaultInfo {
+        uint8_t code;          ///< フォルトコード（FAULT_CODE）
+        uint16_t vbus_mV;      ///< 遮断時のVBUS（mV）
+        int32_t current_mA;    ///< 遮断時の電流（mA）
+        uint32_t timestamp_us; ///< 遮断時刻（us）
+    };
+
+    /**
+     * @brief 保護機能の遮断通知コールバック
+     * @param fault 遮断の記録
+     * @param arg setFaultCallback()で渡したユーザー引数
+     * @note 遮断後のpollProtection()（update()）から呼び出される
+     */
+    typedef void (*FaultCallback)(const FaultInfo &fault, void *arg);
+
+    /**
+     * @brief 抜き差し監視の状態
+     */
+    enum HOTPLUG_STATE {
+        HOTPLUG_OFF = 0x00,      ///< 監視停止中
+        HOTPLUG_ATTACHED = 0x01, ///< 接続中
+        HOTPLUG_DETACHED = 0x02, ///< 切断中（VBUSなし）
+        HOTPLUG_SETTLE = 0x03,   ///< VBUS復帰後の安定待ち
+        HOTPLUG_REDETECT = 0x04  ///< 再接続後の再検出中
+    };
+
+    /**
+     * @brief 抜き差し監視のイベント
+     */
+    enum HOTPLUG_EVENT {
+        HOTPLUG_EV_DETACH = 0x01, ///< 切断（VBUSがしきい値未満）
+        HOTPLUG_EV_ATTACH = 0x02, ///< 再接続（VBUS復帰、再検出を開始）
+        HOTPLUG_EV_READY = 0x03   ///< 再検出完了
+    };
+
+    /**
+     * @brief 抜き差し監視コールバック
+     * @param event イベント（HOTPLUG_EVENT）
+     * @param host_type ホストタイプ（HOTPLUG_EV_READYは再検出結果、それ以外はBC_NA）
+     * @param arg setHotplugCallback()で渡したユーザー引数
+     */
+    typedef void (*HotplugCallback)(uint8_t event, uint8_t host_type, void *arg);
+
+    /**
+     * @brief 可変モードパルススケジューラの状態
+     */
+    enum VAR_STATE {
+        VAR_IDLE = 0x00,  ///< 目標電圧に到達済み
+        VAR_PULSE = 0x01, ///< パルス出力中
+        VAR_GAP = 0x02    ///< パルス間の待機中
+    };
+
+    /**
+     * @brief 定電圧制御の状態
+     */
+    enum REG_STATE {
+        REG_OFF = 0x00,       ///< 停止中
+        REG_ADJUSTING = 0x01, ///< 目標電圧へ調整中
+        REG_LOCKED = 0x02,    ///< 許容範囲内で安定
+        REG_LIMIT = 0x03      ///< 可変範囲の上限/下限に到達
+    };
+
+    /**
+     * @brief 計測チャンネルの較正値（固定小数点）
+     * @note 出力 = ((入力mV - offset) * gain_q16) >> 16
+     */
+    struct CalChannel {
+        int32_t gain_q16;  ///< 係数（Q16.16）
+        int32_t offset;    ///< オフセット（入力側mV）
+    };
+
+    /**
+     * @brief VBUS/電流計測の較正モデル
+     */
+    struct Calibration {
+        CalChannel vbus;     ///< VBUS: ピン電圧(mV) → VBUS(mV)
+        CalChannel current;  ///< 電流: センサ出力(mV) → 電流(mA)
+    };
+
+    /**
+     * @brief 制御タスクへのコマンド種別
+     */
+    enum CMD_TYPE {
+        CMD_SET_MODE = 0x00,  ///< set_VBUS(value)
+        CMD_VAR_STEP = 0x01,  ///< 可変モードの目標電圧をvalue(mV)だけ増減
+        CMD_SET_VAR = 0x02,   ///< setVarVoltage(value)
+        CMD_REGULATE = 0x03,  ///< startRegulation(value)、0で停止
+        CMD_OUTPUT = 0x04,    ///< setOutput(value != 0)
+        CMD_DETECT = 0x05     ///< startDetect()
+    };
+
+    /**
+     * @brief トレースイベント種別（QC3_TRACE_ENABLE=1の場合のみ記録）
+     */
+    enum TRACE_EVENT {
+        TRACE_DP = 0x01,           ///< D+設定（arg: QC_STATE）
+        TRACE_DM = 0x02,           ///< D-設定（arg: QC_STATE）
+        TRACE_VBUS_MODE = 0x03,    ///< 電圧モード設定（arg: QC_VOLTAGE_MODE, value: 設定電圧mV）
+        TRACE_VAR_PULSE = 0x04,    ///< 可変モードのパルス（arg: 1=増加/0=減少, value: 設定電圧mV）
+        TRACE_ADC = 0x05,          ///< ADC読み取り（arg: ピン, value: mV）
+        TRACE_DETECT = 0x06,       ///< 検出段階の判定（arg: DETECT_STATE, value: 判定電圧mV）
+        TRACE_DETECT_DONE = 0x07,  ///< 検出完了（arg: HOST_PORT_TYPE, value: 所要時間ms）
+        TRACE_REG = 0x08,          ///< 定電圧制御の判定（arg: REG_STATE, value: 誤差mV）
+        TRACE_OUTPUT = 0x09,       ///< 出力ON/OFF（arg: 1=ON/0=OFF）
+        TRACE_CMD = 0x0A,          ///< コマンド実行（arg: CMD_TYPE, value: コマンドID）
+        TRACE_HOTPLUG = 0x0B,      ///< 抜き差しの検出（arg: HOTPLUG_EVENT, value: VBUS mV）
+        TRACE_FAULT = 0x0C         ///< 保護機能による遮断（arg: FAULT_CODE, value: 遮断時刻からの通知遅れus）
+    };
+
+    /**
+     * @brief 制御タスクへのコマンド
+     */
+    struct Command {
+        uint8_t type;   ///< コマンド種別（CMD_TYPE）
+        int32_t value;  ///< 引数
+        uint32_t id;    ///< コマンドID（postCommand()で採番）
+    };
+
+    /**
+     * @brief 制御状態のスナップショット
+     */
+    struct Snapshot {
+        uint8_t host_type;     ///< ホストタイプ（HOST_PORT_TYPE）
+        uint8_t qc_mode;       ///< 電圧モード（QC_VOLTAGE_MODE）
+        uint8_t detect_state;  ///< 検出の進行状態（DETECT_STATE）
+        uint8_t reg_state;     ///< 定電圧制御の状態（REG_STATE）
+        uint8_t fault;         ///< 保護機能のフォルトコード（FAULT_CODE）
+        bool class_b;          ///< Class B使用フラグ
+        bool output;           ///< 出力ON/OFF状態
+        bool var_busy;         ///< 可変モードのパルス出力中
+        uint16_t voltage;      ///< 設定電圧（mV）
+        uint16_t var_target;   ///< 可変モードの目標電圧（mV）
+        uint16_t vbus_mV;      ///< VBUS実測値（mV）
+        int32_t current_mA;    ///< 電流実測値（mA）
+        uint32_t last_cmd_id;  ///< 最後に実行したコマンドID
+        uint32_t timestamp;    ///< 更新時刻（ms）
+    };
+
+    /**
+     * @brief NVSへ保存する制御状態（前回の検出結果と電圧プロファイル）
+     */
+    struct SavedState {
+        uint8_t host_type;  ///< ホストタイプ（HOST_PORT_TYPE）
+        uint8_t qc_mode;    ///< 電圧モード（QC_VOLTAGE_MODE）
+        bool class_b;       ///< Class B使用フラグ
+        bool output;        ///< 出力ON/OFF状態
+        uint16_t voltage;   ///< 設定電圧（mV、可変モードは目標電圧）
+        uint16_t v5_mV;     ///< 5V出力時のVBUS（mV、充電器の照合に使用、0: 未記録）
+    };
+
+    /**
+     * @brief 可変モード目標電圧到達コールバック
+     * @param voltage 到達した設定電圧（mV）
+     * @param arg setVarCallback()で渡したユーザー引数
+     * @note ESP32ではesp_timerタスクのコンテキストから呼び出される
+     */
+    typedef void (*VarCallback)(uint16_t voltage, void *arg);
+
+    /**
+     * @brief 連続ADCサンプリングの間引き後データ
+     */
+    struct AdcStreamData {
+        uint16_t avg;   ///< 平均値（ADC生値）
+        uint16_t min;   ///< 最小値（ADC生値）
+        uint16_t max;   ///< 最大値（ADC生値）
+        uint32_t seq;   ///< 更新カウンタ（平均値が更新されるたびに加算）
+    };
+
     /**
      * @brief コンストラクタ
      * @param dp_h D+端子のHIGHピン
@@ -65,12 +320,30 @@ public:
      */
     ESP32_QC3_CTL(uint8_t dp_h, uint8_t dp_l, uint8_t dm_h, uint8_t dm_l, uint8_t vbus_det, uint8_t out_en = 0);
 
+    /**
+     * @brief デストラクタ（トレース用のバッファを解放）
+     */
+    ~ESP32_QC3_CTL();
+
     /**
      * @brief 初期化
      * @return 初期化結果（true: 成功, false: 失敗）
      */
     bool begin();
 
+    /**
+     * @brief ハードウェア抽象化レイヤの設定
+     * @param hal GPIO/ADC/時刻操作の実装（NULLで既定のQC3ArduinoHal）
+     * @note begin()より前に呼び出す。Arduino以外の環境では必須
+     */
+    void setHal(QC3Hal *hal);
+
+    /**
+     * @brief ハードウェア抽象化レイヤの取得
+     * @return 使用中の実装
+     */
+    QC3Hal *getHal();
+
     /**
      * @brief ADCの検出値を電圧値に変換する
      * @param Vread ADCの読み取り値
@@ -83,10 +356,301 @@ public:
 
     float readVoltage(uint8_t pin);
 
+    /**
+     * @brief 指定ピンの電圧を整数で取得
+     * @param pin ピン番号
+     * @return 電圧値（mV）
+     * @note begin()で作成した変換テーブルを参照するため浮動小数点演算を行わない
+     */
+    uint16_t readMillivolts(uint8_t pin);
+
+    /**
+     * @brief ADCの読み取り値を電圧値（mV）に変換する
+     * @param pin ピン番号
+     * @param Vread ADCの読み取り値
+     * @return 電圧値（mV）
+     * @note addAdcPin()で登録済みのピンはテーブル参照と線形補間のみで変換する
+     */
+    uint16_t readMillivolts(uint8_t pin, uint16_t Vread);
+
     bool addAdcPin(uint8_t pin);
 
     bool addAdcPin(uint8_t pin, uint8_t attenuation);
 
+    /**
+     * @brief 登録済みADCピンを1回ずつ読み取り移動平均へ追加
+     * @note loop()等から一定周期で呼び出す
+     */
+    void sampleAdcPins();
+
+    /**
+     * @brief 移動平均後の電圧を取得
+     * @param pin ピン番号
+     * @return 電圧値（mV）、未登録または未サンプリングのピンはreadMillivolts(pin)の値
+     * @note 窓長はsetAdcFilterLength()で指定する（既定16）
+     */
+    uint16_t readFilteredMillivolts(uint8_t pin);
+
+    /**
+     * @brief 登録済みADCピンの移動平均の窓長の設定
+     * @param len 窓長（1〜16、範囲外は丸める）
+     * @note 全ピンのサンプルは破棄される
+     */
+    void setAdcFilterLength(uint8_t len);
+
+    /**
+     * @brief 連続ADCサンプリング開始
+     * @param sample_rate_hz 全チャンネル合計のサンプリング周波数（Hz）
+     * @param decimation 平均化するサンプル数（ピン毎）
+     * @return 開始結果（true: 成功, false: 非対応または失敗）
+     * @note addAdcPin()で登録済みのADC1ピンをDMAでサンプリングする。
+     *       実行中はreadVoltage(pin)も最新の平均値を返す
+     */
+    bool startAdcStream(uint32_t sample_rate_hz = 20000, uint16_t decimation = 64);
+
+    /**
+     * @brief 連続ADCサンプリング停止
+     */
+    void stopAdcStream();
+
+    /**
+     * @brief 連続ADCサンプリング中かどうか
+     * @return true: 実行中, false: 停止中
+     */
+    bool isAdcStreaming();
+
+    /**
+     * @brief DMAバッファのサンプルを取り込む
+     * @return 取り込んだサンプル数
+     * @note loop()等から定期的に呼び出す
+     */
+    uint16_t pollAdcStream();
+
+    /**
+     * @brief 間引き後データの取得
+     * @param pin ピン番号
+     * @param data 取得先
+     * @return 取得結果（true: 成功, false: 対象外のピンまたは未取得）
+     */
+    bool getAdcStream(uint8_t pin, AdcStreamData *data);
+
+    /**
+     * @brief VBUS検出ピンの分圧比設定
+     * @param ratio 分圧比（VBUS / VBUS検出ピン電圧）
+     * @note setVbusCalibration(ratio, 0)と同じ
+     */
+    void setVbusDividerRatio(float ratio);
+
+    /**
+     * @brief VBUS計測の較正値設定
+     * @param gain 係数（VBUS / VBUS検出ピン電圧）
+     * @param offset_mV VBUS検出ピン側のオフセット（mV）
+     */
+    void setVbusCalibration(float gain, int32_t offset_mV = 0);
+
+    /**
+     * @brief VBUS実測値の取得
+     * @return VBUS電圧（mV）
+     * @note VBUS検出ピンの電圧に較正値を適用した値
+     */
+    uint16_t readVbusMillivolts();
+
+    /**
+     * @brief VBUS検出ピンの電圧からVBUSへの変換
+     * @param det_mV VBUS検出ピンの電圧（mV）
+     * @return VBUS電圧（mV）
+     */
+    uint16_t convertVbusMillivolts(uint16_t det_mV);
+
+    /**
+     * @brief 電流センサ出力ピンの設定
+     * @param pin ピン番号
+     * @return 設定結果（true: 成功, false: ADCピン登録数超過）
+     * @note begin()より前に呼び出す
+     */
+    bool setCurrentSensePin(uint8_t pin);
+
+    /**
+     * @brief 電流計測の較正値設定（2点）
+     * @param zero_mV 0A時のセンサ出力（mV）
+     * @param ref_mV 基準電流時のセンサ出力（mV）
+     * @param ref_mA 基準電流（mA）
+     */
+    void setCurrentCalibration(uint16_t zero_mV, uint16_t ref_mV, uint16_t ref_mA);
+
+    /**
+     * @brief 電流実測値の取得
+     * @return 電流（mA）
+     */
+    int32_t readCurrentMilliamps();
+
+    /**
+     * @brief センサ出力から電流値への変換
+     * @param sense_mV センサ出力（mV）
+     * @return 電流（mA）
+     */
+    int32_t convertCurrentMilliamps(uint16_t sense_mV);
+
+    /**
+     * @brief 0A時のセンサ出力を測定してオフセットに設定
+     * @param samples 平均化するサンプル数
+     * @return 設定したオフセット（mV）
+     * @note 出力OFF（無負荷）の状態で呼び出す
+     */
+    uint16_t captureCurrentZero(uint8_t samples = 16);
+
+    /**
+     * @brief 出力ON時の自動ゼロ点補正の設定
+     * @param enable true: setOutput(true)の直前にcaptureCurrentZero()を実行
+     */
+    void setAutoZero(bool enable);
+
+    /**
+     * @brief 較正モデルの取得
+     * @param cal 取得先
+     */
+    void getCalibration(Calibration *cal);
+
+    /**
+     * @brief 較正モデルの設定
+     * @param cal 設定値
+     */
+    void setCalibration(const Calibration &cal);
+
+    /**
+     * @brief 較正モデルをNVSへ保存
+     * @return 保存結果（true: 成功, false: 失敗）
+     */
+    bool saveCalibration();
+
+    /**
+     * @brief 較正モデルをNVSから読み込み
+     * @return 読み込み結果（true: 成功, false: 未保存または失敗）
+     */
+    bool loadCalibration();
+
+    /**
+     * @brief 現在の制御状態の取得（saveState()で保存される内容）
+     * @param state 取得先
+     */
+    void getState(SavedState *state);
+
+    /**
+     * @brief 制御状態をNVSへ保存
+     * @return 保存結果（true: 成功または変更なし, false: 失敗またはESP32以外）
+     */
+    bool saveState();
+
+    /**
+     * @brief 制御状態をNVSから読み込み
+     * @param state 読み込み先
+     * @return 読み込み結果（true: 成功, false: 未保存または失敗）
+     */
+    bool loadState(SavedState *state);
+
+    /**
+     * @brief NVSに保存した制御状態の削除
+     * @return 削除結果（true: 成功, false: 失敗またはESP32以外）
+     */
+    bool clearState();
+
+    /**
+     * @brief 制御状態の自動保存設定
+     * @param enable true: 検出結果・電圧モード・出力の変更をpollSave()で保存
+     * @param delay_ms 最後の変更から保存までの待ち時間（ms）
+     * @note 連続した変更は1回の書き込みにまとめる
+     */
+    void setAutoSave(bool enable, uint32_t delay_ms = 2000);
+
+    /**
+     * @brief 自動保存の処理（update()からも呼び出される）
+     * @return true: 保存した
+     */
+    bool pollSave();
+
+    /**
+     * @brief 自動保存の処理（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     * @return true: 保存した
+     */
+    bool pollSave(uint32_t now_ms);
+
+    /**
+     * @brief 出力ON/OFF設定
+     * @param on true: 出力ON, false: 出力OFF
+     * @return 設定結果（true: 成功, false: 出力有効ピン未設定またはフォルトをラッチ中）
+     */
+    bool setOutput(bool on);
+
+    /**
+     * @brief 出力ON/OFF状態の取得
+     * @return true: 出力ON, false: 出力OFF
+     */
+    bool getOutput();
+
+    /**
+     * @brief 保護機能（過電圧・低電圧・過電流）の開始
+     * @param limits しきい値
+     * @param period_us サンプリング周期（us）
+     * @return 開始結果（true: 成功, false: 出力有効ピン未設定またはタイマー作成失敗）
+     * @note ESP32ではesp_timerの周期タスクでVBUS/電流を読み、出力ON中にしきい値を超えたら
+     *       出力有効ピンを直接LOWにしてフォルトをラッチする（遅れは最大でperiod_us * trip_count程度）。
+     *       ESP32以外ではpollProtection()（update()）の周期で判定する
+     */
+    bool startProtection(const ProtectionLimits &limits, uint32_t period_us = 500);
+
+    /**
+     * @brief 保護機能の停止（ラッチ中のフォルトは保持）
+     */
+    void stopProtection();
+
+    /**
+     * @brief 遮断の通知処理（update()からも呼び出される）
+     * @return フォルトコード（FAULT_CODE）
+     * @note esp_timerを使わない環境ではここでVBUS/電流を判定する
+     */
+    uint8_t pollProtection();
+
+    /**
+     * @brief 遮断の通知処理（時刻指定）
+     * @param now_us 現在時刻（us）
+     * @return フォルトコード（FAULT_CODE）
+     */
+    uint8_t pollProtection(uint32_t now_us);
+
+    /**
+     * @brief ラッチ中のフォルトコードの取得
+     * @return フォルトコード（FAULT_CODE）
+     */
+    uint8_t getFault();
+
+    /**
+     * @brief 遮断の記録の取得
+     * @param fault 取得先
+     * @return 取得結果（true: フォルトをラッチ中, false: フォルトなし）
+     */
+    bool getFaultInfo(FaultInfo *fault);
+
+    /**
+     * @brief フォルトの解除
+     * @note 出力はOFFのまま。解除後にsetOutput(true)で再投入する
+     */
+    void clearFault();
+
+    /**
+     * @brief 遮断通知コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setFaultCallback(FaultCallback cb, void *arg = NULL);
+
+    /**
+     * @brief 判定時に連続ADCサンプリングの間引き窓を読めなかった回数の取得
+     * @return 回数（startProtection()で0に戻る）
+     * @note 窓の更新中は待たずに前回の窓の最小・最大値で判定する
+     */
+    uint32_t getProtectionMissCount();
+
     /**
      * @brief D+端子への印加電圧設定
      * @param state 設定状態（QC_HIZ, QC_0V, QC_600mV, QC_3300mV）
@@ -99,6 +663,21 @@ public:
      */
     void set_DM(uint8_t state);
 
+    /**
+     * @brief D+/D-端子の駆動方式設定
+     * @param backend 駆動方式（PIN_BACKEND_GPIO, PIN_BACKEND_BUNDLE）
+     * @return 設定結果（true: 成功, false: 非対応）
+     * @note PIN_BACKEND_BUNDLEではH/Lピンを1回のレジスタ書き込みで切り替える。
+     *       パルス幅はソフトウェアで計時するため、割り込みやWi-Fiの処理で長くなることがある
+     */
+    bool setPinBackend(uint8_t backend);
+
+    /**
+     * @brief D+/D-端子の駆動方式を取得
+     * @return 駆動方式（PIN_BACKEND_GPIO, PIN_BACKEND_BUNDLE）
+     */
+    uint8_t getPinBackend();
+
     /**
      * @brief VBUS出力電圧設定
      * @param mode 電圧モード（QC_5V, QC_9V, QC_12V, QC_20V, QC_VAR）
@@ -118,12 +697,319 @@ public:
      */
     void var_dec();
 
+    /**
+     * @brief 可変モードの目標電圧設定（ノンブロッキング）
+     * @param target_mV 目標電圧（mV、200mV単位に丸め）
+     * @return 設定結果（true: 受付, false: QC3以外）
+     * @note 必要に応じてQC_VARモードへ移行し、パルス列をバックグラウンドで出力する。
+     *       出力中に目標が変わった場合は残りのステップを新しい目標に合わせて再計算する。
+     */
+    bool setVarVoltage(uint16_t target_mV);
+
+    /**
+     * @brief 可変モードの目標電圧を取得
+     * @return 目標電圧（mV）、待機中は現在の設定電圧
+     */
+    uint16_t getVarTarget();
+
+    /**
+     * @brief パルス出力中かどうか
+     * @return true: 目標電圧へ移行中, false: 到達済み
+     */
+    bool isVarBusy();
+
+    /**
+     * @brief パルススケジューラを進める
+     * @return スケジューラの状態（VAR_STATE）
+     * @note ESP32ではesp_timerで自動駆動されるため呼び出し不要
+     */
+    uint8_t pollVar();
+
+    /**
+     * @brief パルススケジューラを進める（時刻指定）
+     * @param now_us 現在時刻（us）
+     * @return スケジューラの状態（VAR_STATE）
+     */
+    uint8_t pollVar(uint32_t now_us);
+
+    /**
+     * @brief 可変モードのパルス幅・パルス間隔設定
+     * @param pulse_us パルス幅（us）
+     * @param gap_us パルス間隔（us）
+     */
+    void setVarPulseTiming(uint16_t pulse_us, uint32_t gap_us);
+
+    /**
+     * @brief 目標電圧到達コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setVarCallback(VarCallback cb, void *arg = NULL);
+
+    /**
+     * @brief 定電圧制御の開始
+     * @param target_mV 目標電圧（mV）
+     * @param tolerance_mV 許容誤差（mV）
+     * @param retrim_ms 安定後に再測定する間隔（ms）
+     * @return 開始結果（true: 成功, false: QC3以外）
+     * @note VBUS実測値と目標の差から可変モードのステップを発行し、負荷による電圧降下も補正する
+     */
+    bool startRegulation(uint16_t target_mV, uint16_t tolerance_mV = 100, uint32_t retrim_ms = 1000);
+
+    /**
+     * @brief 定電圧制御の停止
+     * @note 可変モードの設定電圧はそのまま維持する
+     */
+    void stopRegulation();
+
+    /**
+     * @brief 定電圧制御を進める
+     * @return 制御状態（REG_STATE）
+     */
+    uint8_t pollRegulation();
+
+    /**
+     * @brief 定電圧制御を進める（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     * @return 制御状態（REG_STATE）
+     */
+    uint8_t pollRegulation(uint32_t now_ms);
+
+    /**
+     * @brief 定電圧制御の状態を取得
+     * @return 制御状態（REG_STATE）
+     */
+    uint8_t getRegulationState();
+
     /**
      * @brief 接続されたポートの検出
      * @return ポートタイプ（BC_NA, BC_DCP, QC3）
      */
     uint8_t detect_Charger();
 
+    /**
+     * @brief 接続されたポートの検出を開始（ノンブロッキング）
+     * @note 以降はpollDetect()をloop()から呼び出して進行させる
+     */
+    void startDetect();
+
+    /**
+     * @brief 接続されたポートの検出を開始（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     */
+    void startDetect(uint32_t now_ms);
+
+    /**
+     * @brief 検出処理を進める
+     * @return 進行状態（DETECT_STATE）
+     */
+    uint8_t pollDetect();
+
+    /**
+     * @brief 検出処理を進める（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     * @return 進行状態（DETECT_STATE）
+     * @note millis()の代わりに任意の時刻源で駆動できる
+     */
+    uint8_t pollDetect(uint32_t now_ms);
+
+    /**
+     * @brief 検出処理中かどうか
+     * @return true: 検出中, false: 未実行または完了
+     */
+    bool isDetecting();
+
+    /**
+     * @brief 検出完了コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setDetectCallback(DetectCallback cb, void *arg = NULL);
+
+    /**
+     * @brief NVSの制御状態を使った検出の開始（ノンブロッキング）
+     * @param restore_output true: 出力ON/OFFも復元
+     * @return true: 前回QC3を検出済み（高速復帰）, false: 通常の検出を開始
+     * @note QC3を再検出した場合はClass B判定（20V印加）を省略して前回の電圧へ戻す。
+     *       5V出力時のVBUS等が前回と異なる充電器では通常の判定を行い、5V・出力OFFで終える
+     */
+    bool startResume(bool restore_output = false);
+
+    /**
+     * @brief 指定した制御状態を使った検出の開始（ノンブロッキング）
+     * @param state 前回の制御状態
+     * @param restore_output true: 出力ON/OFFも復元
+     * @return true: stateがQC3（高速復帰）, false: 通常の検出を開始
+     */
+    bool startResume(const SavedState &state, bool restore_output = false);
+
+    /**
+     * @brief NVSの制御状態を使った検出（ブロッキング）
+     * @param restore_output true: 出力ON/OFFも復元
+     * @return ホストタイプ（BC_NA, BC_DCP, QC3）
+     */
+    uint8_t resume(bool restore_output = false);
+
+    /**
+     * @brief 直前の検出で前回の状態を復元したかどうか
+     * @return true: 復元した（Class B判定は前回の結果）
+     */
+    bool isResumed();
+
+    /**
+     * @brief Class A/Bの判定方法の設定
+     * @param method 判定方法（CAP_PROBE_20V, CAP_PROBE_VAR）
+     * @param use_cache true: 充電器毎の判定結果を記録し、同じ充電器では判定を省略する
+     * @note 記録はESP32ではNVSにも保存される（pollSave()またはdetect_Charger()の終了時）。
+     *       識別値は5V出力時のVBUSのため、5V出力が近い別の充電器の記録を使うことがある
+     */
+    void setCapabilityProbe(uint8_t method, bool use_cache = false);
+
+    /**
+     * @brief 直前の検出で判定した充電器の能力の取得
+     * @param cap 取得先
+     * @return 取得結果（true: 成功, false: QC3以外または検出中）
+     */
+    bool getCapability(Capability *cap);
+
+    /**
+     * @brief 充電器毎の判定結果の記録の削除（NVSを含む）
+     * @return 削除結果（true: 成功, false: NVSの削除に失敗）
+     */
+    bool clearCapabilityCache();
+
+    /**
+     * @brief 抜き差し監視の設定
+     * @param enable true: pollHotplug()でVBUSを監視し、切断・再接続を検出
+     * @param restore_output true: 再検出後に切断前の出力ON/OFFも復元
+     * @note 切断時は出力をOFFにし、再接続時は切断前の状態でstartResume()を開始する
+     */
+    void setHotplugMonitor(bool enable, bool restore_output = false);
+
+    /**
+     * @brief 抜き差し監視のしきい値設定
+     * @param detach_mV 切断と判定するVBUS（mV、可変モードの下限より低くする）
+     * @param attach_mV 再接続と判定するVBUS（mV）
+     * @param debounce_ms 切断と判定するまでのVBUS低下の継続時間（ms）
+     * @param settle_ms 再接続後、再検出を始めるまでのVBUS安定待ち時間（ms）
+     */
+    void setHotplugThresholds(uint16_t detach_mV = 3500, uint16_t attach_mV = 4500,
+                              uint16_t debounce_ms = 2, uint16_t settle_ms = 50);
+
+    /**
+     * @brief 抜き差し監視の処理（update()からも呼び出される）
+     * @return 監視の状態（HOTPLUG_STATE）
+     */
+    uint8_t pollHotplug();
+
+    /**
+     * @brief 抜き差し監視の処理（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     * @return 監視の状態（HOTPLUG_STATE）
+     */
+    uint8_t pollHotplug(uint32_t now_ms);
+
+    /**
+     * @brief 抜き差し監視の状態の取得
+     * @return 監視の状態（HOTPLUG_STATE）
+     */
+    uint8_t getHotplugState();
+
+    /**
+     * @brief 抜き差し監視コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setHotplugCallback(HotplugCallback cb, void *arg = NULL);
+
+    /**
+     * @brief 抜き差し監視・保護機能の通知・検出・パルス出力・定電圧制御・連続ADCサンプリング・自動保存を1回ずつ進める
+     * @note 制御タスクを使わない場合はloop()から呼び出す。投入済みのコマンドも実行する
+     */
+    void update();
+
+    /**
+     * @brief 制御タスクの起動
+     * @param core 実行するコア
+     * @param priority タスク優先度
+     * @param period_ms 制御周期（ms）
+     * @return 起動結果（true: 成功, false: 失敗またはESP32以外）
+     * @note 起動後はD+/D-や出力の操作をpostCommand()経由で行い、状態はgetSnapshot()で取得する
+     */
+    bool startControlTask(uint8_t core = 0, uint8_t priority = 5, uint32_t period_ms = 1);
+
+    /**
+     * @brief 制御タスクの停止
+     */
+    void stopControlTask();
+
+    /**
+     * @brief 制御タスクが動作中かどうか
+     * @return true: 動作中, false: 停止中
+     */
+    bool isControlTaskRunning();
+
+    /**
+     * @brief コマンドの投入
+     * @param type コマンド種別（CMD_TYPE）
+     * @param value 引数
+     * @return コマンドID（0: キューが満杯）
+     * @note 任意のタスクから呼び出せる（ロックフリー）
+     */
+    uint32_t postCommand(uint8_t type, int32_t value = 0);
+
+    /**
+     * @brief 複数コマンドの一括投入
+     * @param cmds コマンド（typeとvalueを設定、idは採番される）
+     * @param count コマンド数（1〜16）
+     * @return 最後のコマンドのID（0: キューの空きが足りない、何も投入しない）
+     * @note 任意のタスクから呼び出せる（ロックフリー）。全コマンドが同じupdate()で順に実行される
+     */
+    uint32_t postCommands(Command *cmds, uint8_t count);
+
+    /**
+     * @brief 制御状態のスナップショットを取得
+     * @param snap 取得先
+     * @return 取得結果（true: 成功, false: 未更新）
+     */
+    bool getSnapshot(Snapshot *snap);
+
+    /**
+     * @brief 電力量の積算先の登録
+     * @param meter 積算先（NULLで解除）
+     * @note update()毎にスナップショットと同じVBUS/電流の実測値を積算する
+     */
+    void setEnergyMeter(QC3EnergyMeter *meter);
+
+    /**
+     * @brief 記録済みトレースイベントを古い順に取得
+     * @param events 取得先
+     * @param max_events 取得先の要素数
+     * @return 取得したイベント数（QC3_TRACE_ENABLE=0では常に0）
+     */
+    uint16_t readTrace(QC3TraceEvent *events, uint16_t max_events);
+
+    /**
+     * @brief トレースイベントの破棄
+     */
+    void clearTrace();
+
+    /**
+     * @brief トレースイベント種別の名前
+     * @param event イベント種別（TRACE_EVENT）
+     * @return 名前
+     */
+    static const char *traceEventName(uint8_t event);
+
+#if defined(ARDUINO)
+    /**
+     * @brief トレースイベントをCSV（ts_us,event,arg,value）で出力
+     * @param out 出力先（Serial等）
+     * @return 出力したイベント数
+     */
+    size_t dumpTrace(Print &out);
+#endif
+
     /**
      * @brief 現在の出力電圧値を取得
      * @return 出力電圧値（mV）
@@ -136,19 +1022,60 @@ public:
      */
     uint8_t getHostType();
 
+    /**
+     * @brief 現在の電圧モードを取得
+     * @return 電圧モード（QC_5V, QC_9V, QC_12V, QC_20V, QC_VAR）
+     */
+    uint8_t getMode();
+
+    /**
+     * @brief 検出の進行状態を取得
+     * @return 進行状態（DETECT_STATE）
+     */
+    uint8_t getDetectState();
+
     /**
      * @brief _use_class_bの現在の値を取得
      * @return _use_class_bの値
      */
     bool getUseClassB();
 
+protected:
+    uint8_t _begin_backend; ///< begin()で設定するD+/D-端子の駆動方式（派生クラスが変更する）
+
 private:
     static const uint8_t MAX_ADC_PINS = 8U;
+    static const uint8_t ADC_FILTER_MAX = 16U; ///< 移動平均の窓長の上限
 
     uint8_t _adcPins[MAX_ADC_PINS];
     uint8_t _adcPinAtten[MAX_ADC_PINS];
     uint8_t _adcPinCount;
 
+    // 連続ADCサンプリング
+    void *_adc_stream;                    ///< adc_continuousハンドル
+    uint8_t _adcStreamChan[MAX_ADC_PINS]; ///< ピン毎のADC1チャンネル（0xFF: 対象外）
+    uint32_t _adcStreamSum[MAX_ADC_PINS]; ///< 平均化中の合計
+    uint16_t _adcStreamCnt[MAX_ADC_PINS]; ///< 平均化中のサンプル数
+    uint16_t _adcStreamMin[MAX_ADC_PINS]; ///< 平均化中の最小値
+    uint16_t _adcStreamMax[MAX_ADC_PINS]; ///< 平均化中の最大値
+    volatile AdcStreamData _adcStreamData[MAX_ADC_PINS]; ///< 間引き後データ
+    uint16_t _adcStreamDecim;             ///< 平均化するサンプル数
+
+    // ADC変換テーブル（64コード毎の折れ点、4095まで）
+    static const uint8_t ADC_LUT_SHIFT = 6U;
+    static const uint8_t ADC_LUT_SIZE = (4096U >> ADC_LUT_SHIFT) + 1U;
+
+    uint16_t _adcLut[MAX_ADC_PINS][ADC_LUT_SIZE]; ///< ピン毎の折れ点電圧（mV）
+    bool _adcLutReady[MAX_ADC_PINS];               ///< テーブル作成済みフラグ
+
+    void buildAdcLut(uint8_t idx);
+
+    QC3BoxcarFilter<uint16_t, ADC_FILTER_MAX, uint32_t> _adcFilter[MAX_ADC_PINS]; ///< ピン毎の移動平均
+
+    int8_t findAdcPin(uint8_t pin);
+    void pushAdcStreamSample(uint8_t idx, uint16_t raw);
+
+    QC3Hal *_hal;         ///< GPIO/ADC/時刻操作の実装
     uint8_t _dp_h;        ///< D+端子のHIGHピン
     uint8_t _dp_l;        ///< D+端子のLOWピン
     uint8_t _dm_h;        ///< D-端子のHIGHピン
@@ -166,6 +1093,181 @@ private:
 
     bool _is_on;          ///< 出力ON/OFF状態
 
+    /**
+     * @brief H/Lピン対のGPIOレジスタビットマスク（[0]: GPIO0-31, [1]: GPIO32-）
+     */
+    struct PairMask {
+        uint32_t h[2];    ///< HIGHピン
+        uint32_t l[2];    ///< LOWピン
+    };
+
+    uint8_t _pin_backend; ///< D+/D-端子の駆動方式
+    uint8_t _dp_state;    ///< D+端子の設定状態
+    uint8_t _dm_state;    ///< D-端子の設定状態
+    PairMask _dp_mask;    ///< D+端子のビットマスク（コンストラクタで計算）
+    PairMask _dm_mask;    ///< D-端子のビットマスク（コンストラクタで計算）
+
+    void writePairBundle(const PairMask &mask, uint8_t state);
+    void pulseBundle(bool up);
+
+    // 非同期検出
+    static const uint16_t DETECT_HANDSHAKE_MS = 1500; ///< BC1.2ハンドシェイク待ち時間（ms）
+    static const uint16_t DETECT_CLASS_B_MS = 100;    ///< Class B判定の待ち時間（ms）
+
+    uint8_t _detect_state;     ///< 検出の進行状態
+    uint32_t _detect_ts;       ///< 現在の段階に入った時刻（ms）
+    DetectCallback _detect_cb; ///< 検出完了コールバック
+    void *_detect_cb_arg;      ///< コールバックのユーザー引数
+
+    void finishDetect(uint8_t host_type);
+
+    // 制御状態の保存と高速復帰
+    SavedState _resume_state; ///< 復帰に使う前回の状態
+    bool _resume_pending;     ///< 検出中に前回の状態を復元する
+    bool _resume_output;      ///< 出力ON/OFFも復元する
+    bool _resumed;            ///< 直前の検出で復元した
+    bool _auto_save;          ///< 自動保存の有効フラグ
+    bool _save_dirty;         ///< 未保存の変更あり
+    uint32_t _save_ts;        ///< 最後の変更時刻（ms）
+    SavedState _save_last;    ///< 最後に変更を記録した時点の状態
+    uint32_t _save_delay_ms;  ///< 変更から保存までの待ち時間（ms）
+
+    bool restoreState();
+    bool matchResumeCharger();
+    void markStateDirty();
+
+    // 充電器の能力判定
+    static const uint16_t DETECT_PROBE_VAR_MS = 60;    ///< 可変モードへの移行待ち時間（ms、T_GLITCH_V_CHANGE以上）
+    static const uint16_t DETECT_PROBE_STEP_MS = 100;  ///< +200mVパルスへの応答待ちの上限（ms）
+
+    uint8_t _cap_probe;         ///< Class A/Bの判定方法
+    bool _cap_use_cache;        ///< 判定結果を記録・使用する
+    bool _cap_dirty;            ///< 記録に未保存の変更あり
+    uint8_t _cap_count;         ///< 記録の数
+    uint16_t _cap_base_mV;      ///< パルス前のVBUS（mV）
+    uint32_t _cap_pulse_us;     ///< パルスを出力した時刻（us）
+    uint8_t _cap_rise;          ///< VBUSの上昇が続いた読み取り回数
+    uint32_t _cap_rise_us;      ///< VBUSの上昇を最初に検出した時刻（us）
+    Capability _cap;            ///< 直前の検出の判定結果
+    Capability _cap_cache[CAP_CACHE_LEN]; ///< 充電器毎の判定結果（先頭が最新）
+
+    uint16_t readVbusAverage(uint8_t samples);
+    void beginCapability();
+    bool findCapability();
+    void finishCapability(uint8_t probe, uint16_t vmax_mV, uint32_t step_us);
+    void pollProbe(uint32_t now_ms);
+    bool loadCapabilityCache();
+    bool saveCapabilityCache();
+
+    // 抜き差し監視
+    uint8_t _hp_state;          ///< 監視の状態
+    bool _hp_restore_output;    ///< 再検出後に出力ON/OFFも復元する
+    bool _hp_low;               ///< VBUS低下を検出中
+    bool _hp_was_on;            ///< フォルトなしで最後に監視した時点の出力ON/OFF
+    bool _hp_tripped;           ///< フォルトのラッチを監視で検出済み
+    uint16_t _hp_detach_mV;     ///< 切断と判定するVBUS（mV）
+    uint16_t _hp_attach_mV;     ///< 再接続と判定するVBUS（mV）
+    uint16_t _hp_debounce_ms;   ///< 切断判定の継続時間（ms）
+    uint16_t _hp_settle_ms;     ///< 再接続後の安定待ち時間（ms）
+    uint32_t _hp_ts;            ///< VBUS低下/復帰を検出した時刻（ms）
+    uint32_t _hp_trip_ts;       ///< フォルトのラッチを検出した時刻（ms）
+    SavedState _hp_saved;       ///< 切断前の制御状態
+    HotplugCallback _hp_cb;     ///< 抜き差し監視コールバック
+    void *_hp_cb_arg;           ///< コールバックのユーザー引数
+
+    void detachHotplug();
+    void notifyHotplug(uint8_t event, uint8_t host_type);
+
+    // 保護機能
+    ProtectionLimits _prot_limits;       ///< しきい値
+    volatile bool _prot_enabled;         ///< 判定の有効フラグ
+    volatile uint8_t _fault_code;        ///< ラッチ中のフォルトコード
+    FaultInfo _fault_info;               ///< 遮断の記録
+    bool _fault_reported;                ///< 遮断を通知済み
+    uint8_t _prot_over[3];               ///< しきい値を連続して超えたサンプル数（OVP/UVP/OCP）
+    uint16_t _prot_win_lo[2];            ///< 前回読めた間引き窓の最小値（VBUS/電流、mV）
+    uint16_t _prot_win_hi[2];            ///< 前回読めた間引き窓の最大値（VBUS/電流、mV）
+    bool _prot_win_valid[2];             ///< 間引き窓を読めた
+    volatile uint32_t _prot_miss;        ///< 間引き窓を読めなかった回数
+    FaultCallback _fault_cb;             ///< 遮断通知コールバック
+    void *_fault_cb_arg;                 ///< コールバックのユーザー引数
+#if defined(ARDUINO_ARCH_ESP32)
+    esp_timer_handle_t _prot_timer;      ///< 判定タイマー
+    portMUX_TYPE _prot_mux;              ///< 出力有効ピンの操作の排他
+
+    static void protTimerCallback(void *arg);
+#endif
+
+    void checkProtection(uint32_t now_us);
+    void readProtectionPin(uint8_t slot, uint8_t pin, uint16_t *lo_mV, uint16_t *hi_mV);
+    bool writeOutput(bool on);
+
+    // 可変モードパルススケジューラ
+    static const uint16_t VAR_PULSE_US = 200;   ///< パルス幅初期値（us）
+    static const uint32_t VAR_GAP_US = 100000;  ///< パルス間隔初期値（us）
+    static const uint32_t VAR_EDGE_WAIT_US = 1000;  ///< set_VBUS()がパルス端の書き込みを待つ上限（パルス幅に加算、us）
+
+    volatile uint8_t _var_state;    ///< スケジューラの状態
+    volatile bool _var_edge;        ///< パルス端の書き込み中（set_VBUS()は完了を待つ）
+    volatile uint16_t _var_target;  ///< 目標電圧（mV）
+    bool _var_up;                   ///< 出力中パルスの方向（true: 増加）
+    uint32_t _var_ts;               ///< 現在の段階に入った時刻（us）
+    uint16_t _var_pulse_us;         ///< パルス幅（us）
+    uint32_t _var_gap_us;           ///< パルス間隔（us）
+    VarCallback _var_cb;            ///< 到達コールバック
+    void *_var_cb_arg;              ///< コールバックのユーザー引数
+#if defined(ARDUINO_ARCH_ESP32)
+    esp_timer_handle_t _var_timer;  ///< パルス駆動タイマー
+    portMUX_TYPE _var_mux;          ///< 状態遷移の排他
+
+    static void varTimerCallback(void *arg);
+#endif
+
+    uint16_t varMax();
+
+    // 較正モデル
+    Calibration _cal;     ///< VBUS/電流の較正値
+    uint8_t _cur_sense;   ///< 電流センサ出力ピン（0: 未使用）
+    bool _auto_zero;      ///< 出力ON時の自動ゼロ点補正
+
+    // 制御タスク
+    static const uint8_t CMD_QUEUE_LEN = 16U;  ///< コマンドキューの長さ
+
+    QC3MpscQueue<Command, CMD_QUEUE_LEN> _cmd_queue; ///< コマンドキュー
+    std::atomic<uint32_t> _cmd_next_id;  ///< 次に採番するコマンドID
+    uint32_t _cmd_done_id;               ///< 最後に実行したコマンドID
+    Snapshot _snap;                      ///< 公開中のスナップショット
+    std::atomic<uint32_t> _snap_seq;     ///< スナップショットの更新カウンタ（更新中は奇数）
+    QC3EnergyMeter *_energy;             ///< 電力量の積算先
+    volatile bool _ctl_run;              ///< 制御タスクの継続フラグ
+    uint32_t _ctl_period_ms;             ///< 制御周期（ms）
+#if defined(ARDUINO_ARCH_ESP32)
+    TaskHandle_t _ctl_task;              ///< 制御タスク
+
+    static void controlTask(void *arg);
+#endif
+
+    void executeCommand(const Command &cmd);
+    void publishSnapshot();
+
+    // トレース（QC3_TRACE_ENABLEによらずクラスの配置を変えないよう、バッファはTrace.cppで確保する）
+    QC3TraceStore *_trace;   ///< トレースイベント（QC3_TRACE_ENABLE=0ではNULL）
+    uint32_t _detect_start;  ///< 検出開始時刻（ms）
+
+    void initTrace();
+    void traceEvent(uint8_t event, uint16_t arg, int32_t value);
+
+    // 定電圧制御
+    static const uint16_t REG_SETTLE_MS = 100;  ///< ステップ後の安定待ち時間（ms）
+
+    uint8_t _reg_state;         ///< 制御状態
+    uint16_t _reg_target;       ///< 目標電圧（mV）
+    uint16_t _reg_tolerance;    ///< 許容誤差（mV）
+    uint32_t _reg_retrim_ms;    ///< 再測定間隔（ms）
+    uint32_t _reg_ts;           ///< 最後にステップを発行/測定した時刻（ms）
+    uint8_t serviceVar(uint32_t now_us);
+    void armVarTimer();
+
     // VBUS可変範囲
     static const uint16_t QC3_VAR_MIN = 5000;  ///< 最小電圧（mV）
     static const uint16_t QC3A_VAR_MAX = 12000; ///< 最大電圧 Class A（mV）
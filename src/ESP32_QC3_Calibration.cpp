@@ -0,0 +1,235 @@
+/**
+ * @file ESP32_QC3_Calibration.cpp
+ * @brief ESP32_QC3_CTLのVBUS/電流計測の較正モデル実装
+ * 
+ * 分圧比や電流センサの係数はQ16.16の固定小数点で保持し、計測時は
+ * readMillivolts()の整数値に対して乗算とシフトのみで換算します。
+ * 較正値はNVS（Preferences）へ保存して起動時に読み込めます。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #include <Preferences.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+static const char *QC3_CAL_NAMESPACE = "qc3cal";  ///< NVSの名前空間
+static const char *QC3_CAL_KEY = "cal";           ///< NVSのキー
+#endif
+static const uint16_t QC3_CAL_MAGIC = 0x51C3U;    ///< 保存データの識別子
+static const uint8_t QC3_CAL_VERSION = 1U;        ///< 保存データの版数
+
+/**
+ * @brief NVSへ保存するデータ形式
+ */
+struct QC3CalRecord {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    ESP32_QC3_CTL::Calibration cal;
+};
+
+/**
+ * @brief 較正値の適用
+ * @param ch 較正値
+ * @param in_mV 入力（mV）
+ * @return 出力
+ */
+static int32_t applyCalChannel(const ESP32_QC3_CTL::CalChannel &ch, int32_t in_mV) {
+    return (int32_t)(((int64_t)(in_mV - ch.offset) * ch.gain_q16) >> 16);
+}
+
+/**
+ * @brief 係数をQ16.16へ変換
+ * @param gain 係数
+ * @return Q16.16の係数
+ */
+static int32_t toQ16(float gain) {
+    return (int32_t)(gain * 65536.0f + ((gain >= 0.0f) ? 0.5f : -0.5f));
+}
+
+/**
+ * @brief VBUS検出ピンの分圧比設定
+ * @param ratio 分圧比（VBUS / VBUS検出ピン電圧）
+ */
+void ESP32_QC3_CTL::setVbusDividerRatio(float ratio) {
+    setVbusCalibration(ratio, 0);
+}
+
+/**
+ * @brief VBUS計測の較正値設定
+ * @param gain 係数（VBUS / VBUS検出ピン電圧）
+ * @param offset_mV VBUS検出ピン側のオフセット（mV）
+ */
+void ESP32_QC3_CTL::setVbusCalibration(float gain, int32_t offset_mV) {
+    if (gain <= 0.0f) {
+        gain = 1.0f;
+    }
+    _cal.vbus.gain_q16 = toQ16(gain);
+    _cal.vbus.offset = offset_mV;
+}
+
+/**
+ * @brief VBUS実測値の取得
+ * @return VBUS電圧（mV）
+ */
+uint16_t ESP32_QC3_CTL::readVbusMillivolts() {
+    return convertVbusMillivolts(readMillivolts(_vbus_det));
+}
+
+/**
+ * @brief VBUS検出ピンの電圧からVBUSへの変換
+ * @param det_mV VBUS検出ピンの電圧（mV）
+ * @return VBUS電圧（mV）
+ */
+uint16_t ESP32_QC3_CTL::convertVbusMillivolts(uint16_t det_mV) {
+    int32_t mv = applyCalChannel(_cal.vbus, (int32_t)det_mV);
+    if (mv < 0) {
+        mv = 0;
+    } else if (mv > 0xFFFF) {
+        mv = 0xFFFF;
+    }
+    return (uint16_t)mv;
+}
+
+/**
+ * @brief 電流センサ出力ピンの設定
+ * @param pin ピン番号
+ * @return 設定結果（true: 成功, false: ADCピン登録数超過）
+ */
+bool ESP32_QC3_CTL::setCurrentSensePin(uint8_t pin) {
+    if (!addAdcPin(pin)) {
+        return false;
+    }
+    _cur_sense = pin;
+    return true;
+}
+
+/**
+ * @brief 電流計測の較正値設定（2点）
+ * @param zero_mV 0A時のセンサ出力（mV）
+ * @param ref_mV 基準電流時のセンサ出力（mV）
+ * @param ref_mA 基準電流（mA）
+ */
+void ESP32_QC3_CTL::setCurrentCalibration(uint16_t zero_mV, uint16_t ref_mV, uint16_t ref_mA) {
+    const int32_t span = (int32_t)ref_mV - (int32_t)zero_mV;
+    _cal.current.offset = zero_mV;
+    if (span == 0) {
+        _cal.current.gain_q16 = 65536;
+        return;
+    }
+    _cal.current.gain_q16 = (int32_t)(((int64_t)ref_mA << 16) / span);
+}
+
+/**
+ * @brief 電流実測値の取得
+ * @return 電流（mA）
+ */
+int32_t ESP32_QC3_CTL::readCurrentMilliamps() {
+    if (_cur_sense == 0U) {
+        return 0;
+    }
+    return convertCurrentMilliamps(readMillivolts(_cur_sense));
+}
+
+/**
+ * @brief センサ出力から電流値への変換
+ * @param sense_mV センサ出力（mV）
+ * @return 電流（mA）
+ */
+int32_t ESP32_QC3_CTL::convertCurrentMilliamps(uint16_t sense_mV) {
+    return applyCalChannel(_cal.current, (int32_t)sense_mV);
+}
+
+/**
+ * @brief 0A時のセンサ出力を測定してオフセットに設定
+ * @param samples 平均化するサンプル数
+ * @return 設定したオフセット（mV）
+ */
+uint16_t ESP32_QC3_CTL::captureCurrentZero(uint8_t samples) {
+    if (_cur_sense == 0U) {
+        return 0U;
+    }
+    if (samples == 0U) {
+        samples = 1U;
+    }
+    uint32_t sum = 0U;
+    for (uint8_t i = 0U; i < samples; i++) {
+        sum += readMillivolts(_cur_sense);
+    }
+    const uint16_t zero = (uint16_t)(sum / samples);
+    _cal.current.offset = zero;
+    return zero;
+}
+
+/**
+ * @brief 出力ON時の自動ゼロ点補正の設定
+ * @param enable true: setOutput(true)の直前にcaptureCurrentZero()を実行
+ */
+void ESP32_QC3_CTL::setAutoZero(bool enable) {
+    _auto_zero = enable;
+}
+
+/**
+ * @brief 較正モデルの取得
+ * @param cal 取得先
+ */
+void ESP32_QC3_CTL::getCalibration(Calibration *cal) {
+    *cal = _cal;
+}
+
+/**
+ * @brief 較正モデルの設定
+ * @param cal 設定値
+ */
+void ESP32_QC3_CTL::setCalibration(const Calibration &cal) {
+    _cal = cal;
+}
+
+/**
+ * @brief 較正モデルをNVSへ保存
+ * @return 保存結果（true: 成功, false: 失敗）
+ */
+bool ESP32_QC3_CTL::saveCalibration() {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3CalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = QC3_CAL_MAGIC;
+    rec.version = QC3_CAL_VERSION;
+    rec.cal = _cal;
+
+    Preferences prefs;
+    if (!prefs.begin(QC3_CAL_NAMESPACE, false)) {
+        return false;
+    }
+    const size_t written = prefs.putBytes(QC3_CAL_KEY, &rec, sizeof(rec));
+    prefs.end();
+    return written == sizeof(rec);
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 較正モデルをNVSから読み込み
+ * @return 読み込み結果（true: 成功, false: 未保存または失敗）
+ */
+bool ESP32_QC3_CTL::loadCalibration() {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3CalRecord rec;
+    Preferences prefs;
+    if (!prefs.begin(QC3_CAL_NAMESPACE, true)) {
+        return false;
+    }
+    const size_t len = prefs.getBytes(QC3_CAL_KEY, &rec, sizeof(rec));
+    prefs.end();
+    if ((len != sizeof(rec)) || (rec.magic != QC3_CAL_MAGIC) || (rec.version != QC3_CAL_VERSION)) {
+        return false;
+    }
+    _cal = rec.cal;
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,295 @@
+/**
+ * @file ESP32_QC3_Capability.cpp
+ * @brief ESP32_QC3_CTLの充電器の能力判定と判定結果の記録
+ *
+ * 既定のClass A/B判定は20Vを要求してVBUSを確認するため、Class Bの充電器では
+ * 接続先に一時的に20Vが出力されます。CAP_PROBE_VARでは12Vから可変モードへ移行して
+ * +200mVを1回要求し、VBUSが上がればClass B（12Vが上限のClass Aは応答しない）と判定するため、
+ * 判定中の最大電圧は12.2Vに収まります。パルス前後のVBUSは複数回の読み取りの平均で比較し、
+ * 上昇が連続して確認できた時点で判定を終えます。
+ * 判定結果の記録を有効にすると（既定は無効）、充電器の識別値（5V出力時のVBUS）毎に記録し、
+ * 同じ充電器では判定そのものを省略します。識別値は充電器を確実に区別するものではありません。
+ * 判定を誤ると可変モードの上限が変わるため、充電器を取り替える環境では記録を使わないでください。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #include <Preferences.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+static const char *QC3_CAP_NAMESPACE = "qc3cap";  ///< NVSの名前空間
+static const char *QC3_CAP_KEY = "cache";         ///< NVSのキー
+#endif
+static const uint16_t QC3_CAP_MAGIC = 0x51CAU;    ///< 保存データの識別子
+static const uint8_t QC3_CAP_VERSION = 1U;        ///< 保存データの版数
+static const uint16_t QC3_CAP_12V_MIN_MV = 11000U; ///< 12V出力とみなすVBUSの下限（mV）
+static const uint16_t QC3_CAP_STEP_MV = 100U;     ///< +200mVパルスへの応答とみなすVBUSの上昇（mV）
+static const uint8_t QC3_CAP_V5_SAMPLES = 8U;     ///< 5V出力時のVBUSの平均化に使う読み取り回数
+static const uint8_t QC3_CAP_BASE_SAMPLES = 8U;   ///< パルス前のVBUSの平均化に使う読み取り回数
+static const uint8_t QC3_CAP_STEP_SAMPLES = 4U;   ///< パルス後のVBUSの平均化に使う読み取り回数
+static const uint8_t QC3_CAP_STEP_COUNT = 3U;     ///< 上昇とみなすまでに連続して超える回数
+
+/**
+ * @brief NVSへ保存するデータ形式
+ */
+struct QC3CapRecord {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    ESP32_QC3_CTL::Capability entries[ESP32_QC3_CTL::CAP_CACHE_LEN];
+};
+
+/**
+ * @brief Class A/Bの判定方法の設定
+ * @param method 判定方法（CAP_PROBE_20V, CAP_PROBE_VAR）
+ * @param use_cache true: 充電器毎の判定結果を記録し、同じ充電器では判定を省略する
+ */
+void ESP32_QC3_CTL::setCapabilityProbe(uint8_t method, bool use_cache) {
+    _cap_probe = (method == CAP_PROBE_VAR) ? CAP_PROBE_VAR : CAP_PROBE_20V;
+    _cap_use_cache = use_cache;
+    if (use_cache && (_cap_count == 0U)) {
+        (void)loadCapabilityCache();
+    }
+}
+
+/**
+ * @brief 直前の検出で判定した充電器の能力の取得
+ * @param cap 取得先
+ * @return 取得結果（true: 成功, false: QC3以外または検出中）
+ */
+bool ESP32_QC3_CTL::getCapability(Capability *cap) {
+    if ((_host_type != QC3) || isDetecting()) {
+        return false;
+    }
+    *cap = _cap;
+    return true;
+}
+
+/**
+ * @brief 充電器毎の判定結果の記録の削除（NVSを含む）
+ * @return 削除結果（true: 成功, false: NVSの削除に失敗）
+ */
+bool ESP32_QC3_CTL::clearCapabilityCache() {
+    memset(_cap_cache, 0, sizeof(_cap_cache));
+    _cap_count = 0U;
+    _cap_dirty = false;
+#if defined(ARDUINO_ARCH_ESP32)
+    Preferences prefs;
+    if (!prefs.begin(QC3_CAP_NAMESPACE, false)) {
+        return false;
+    }
+    const bool ret = prefs.clear();
+    prefs.end();
+    return ret;
+#else
+    return true;
+#endif
+}
+
+/**
+ * @brief VBUSの平均値の読み取り
+ * @param samples 読み取り回数
+ * @return VBUS電圧（mV）
+ */
+uint16_t ESP32_QC3_CTL::readVbusAverage(uint8_t samples) {
+    uint32_t sum = 0U;
+    for (uint8_t i = 0U; i < samples; i++) {
+        sum += readVbusMillivolts();
+    }
+    return (uint16_t)(sum / samples);
+}
+
+/**
+ * @brief 判定の開始（5V出力時のVBUSと識別値の記録）
+ * @note QC3のハンドシェイク完了直後（5V出力中）に呼び出す
+ */
+void ESP32_QC3_CTL::beginCapability() {
+    memset(&_cap, 0, sizeof(_cap));
+    // 充電器の照合にも使うため、複数回の読み取りを平均してADCのばらつきを抑える
+    _cap.v5_mV = readVbusAverage(QC3_CAP_V5_SAMPLES);
+    // 5V出力時のVBUSを100mV単位に丸め、ADCの読み取りばらつきで識別値が変わらないようにする
+    _cap.signature = ((uint32_t)QC3 << 24) | (uint32_t)((_cap.v5_mV + 50U) / 100U);
+}
+
+/**
+ * @brief 記録済みの判定結果の検索
+ * @return true: 識別値が一致する記録あり（_capと_use_class_bへ反映）
+ */
+bool ESP32_QC3_CTL::findCapability() {
+    for (uint8_t i = 0U; i < _cap_count; i++) {
+        if (_cap_cache[i].signature != _cap.signature) {
+            continue;
+        }
+        const Capability found = _cap_cache[i];
+        if (i != 0U) {
+            // 最近使った記録を先頭へ移し、古い記録から置き換える
+            memmove(&_cap_cache[1], &_cap_cache[0], sizeof(Capability) * i);
+            _cap_cache[0] = found;
+            _cap_dirty = true;
+        }
+        const uint16_t v5 = _cap.v5_mV;
+        _cap = found;
+        _cap.v5_mV = v5;
+        _cap.cached = true;
+        _use_class_b = found.class_b;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 判定結果の確定と記録
+ * @param probe 判定方法（CAP_PROBE）
+ * @param vmax_mV 判定中に観測したVBUSの最大値（mV）
+ * @param step_us +200mVパルスへの応答時間（us、0: 未計測）
+ * @note _use_class_bを設定してから呼び出す
+ */
+void ESP32_QC3_CTL::finishCapability(uint8_t probe, uint16_t vmax_mV, uint32_t step_us) {
+    _cap.probe = probe;
+    _cap.class_b = _use_class_b;
+    _cap.cached = false;
+    _cap.vmax_mV = (vmax_mV > _cap.v5_mV) ? vmax_mV : _cap.v5_mV;
+    _cap.max_mV = _use_class_b ? 20000U : 12000U;
+    _cap.var_min_mV = QC3_VAR_MIN;
+    _cap.var_max_mV = varMax();
+    _cap.step_us = step_us;
+    if (!_cap_use_cache || (probe == CAP_PROBE_SAVED)) {
+        return;
+    }
+
+    // 同じ識別値の記録は置き換え、記録が一杯なら最も古いものを捨てる
+    uint8_t n = _cap_count;
+    for (uint8_t i = 0U; i < _cap_count; i++) {
+        if (_cap_cache[i].signature == _cap.signature) {
+            n = i;
+            break;
+        }
+    }
+    if (n >= CAP_CACHE_LEN) {
+        n = CAP_CACHE_LEN - 1U;
+    } else if (n == _cap_count) {
+        _cap_count++;
+    }
+    memmove(&_cap_cache[1], &_cap_cache[0], sizeof(Capability) * n);
+    _cap_cache[0] = _cap;
+    _cap_dirty = true;
+}
+
+/**
+ * @brief 可変モードによるClass A/B判定を進める
+ * @param now_ms 現在時刻（ms）
+ * @note 応答時間の分解能はpollDetect()の呼び出し周期になる
+ */
+void ESP32_QC3_CTL::pollProbe(uint32_t now_ms) {
+    switch (_detect_state) {
+        case DETECT_PROBE_12V:
+            if ((uint32_t)(now_ms - _detect_ts) < DETECT_CLASS_B_MS) {
+                break;
+            }
+            _cap_base_mV = readVbusAverage(QC3_CAP_BASE_SAMPLES);
+            QC3_TRACE(TRACE_DETECT, DETECT_PROBE_12V, _cap_base_mV);
+            if (_cap_base_mV < QC3_CAP_12V_MIN_MV) {
+                // 12Vに届かない: 可変モードの応答は判定に使えないためClass Aとする
+                _use_class_b = false;
+                set_VBUS(QC_5V);
+                finishCapability(CAP_PROBE_VAR, _cap_base_mV, 0U);
+                finishDetect(QC3);
+                break;
+            }
+            set_VBUS(QC_VAR);
+            _detect_state = DETECT_PROBE_VAR;
+            _detect_ts = now_ms;
+            break;
+        case DETECT_PROBE_VAR:
+            if ((uint32_t)(now_ms - _detect_ts) < DETECT_PROBE_VAR_MS) {
+                break;
+            }
+            // +200mV: Class Aは12Vを超える要求に応答しない
+            _cap_base_mV = readVbusAverage(QC3_CAP_BASE_SAMPLES);
+            set_DP(QC_3300mV);
+            _hal->delayMicroseconds(_var_pulse_us);
+            set_DP(QC_600mV);
+            _cap_pulse_us = _hal->micros();
+            _cap_rise = 0U;
+            _detect_state = DETECT_PROBE_STEP;
+            _detect_ts = now_ms;
+            break;
+        case DETECT_PROBE_STEP: {
+            // ノイズによる1回の跳ねで誤判定しないよう、平均値の上昇が連続した場合のみClass Bとする
+            const uint16_t vbus = readVbusAverage(QC3_CAP_STEP_SAMPLES);
+            if (vbus >= _cap_base_mV + QC3_CAP_STEP_MV) {
+                if (_cap_rise == 0U) {
+                    _cap_rise_us = _hal->micros();
+                }
+                _cap_rise++;
+            } else {
+                _cap_rise = 0U;
+            }
+            const bool rose = (_cap_rise >= QC3_CAP_STEP_COUNT);
+            if (!rose && ((uint32_t)(now_ms - _detect_ts) < DETECT_PROBE_STEP_MS)) {
+                break;
+            }
+            QC3_TRACE(TRACE_DETECT, DETECT_PROBE_STEP, vbus);
+            _use_class_b = rose;
+            set_VBUS(QC_5V); // 初期状態に戻す
+            finishCapability(CAP_PROBE_VAR, rose ? vbus : _cap_base_mV,
+                             rose ? (_cap_rise_us - _cap_pulse_us) : 0U);
+            finishDetect(QC3);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief 判定結果の記録をNVSから読み込み
+ * @return 読み込み結果（true: 成功, false: 未保存または失敗、ESP32以外）
+ */
+bool ESP32_QC3_CTL::loadCapabilityCache() {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3CapRecord rec;
+    Preferences prefs;
+    if (!prefs.begin(QC3_CAP_NAMESPACE, true)) {
+        return false;
+    }
+    const size_t len = prefs.getBytes(QC3_CAP_KEY, &rec, sizeof(rec));
+    prefs.end();
+    if ((len != sizeof(rec)) || (rec.magic != QC3_CAP_MAGIC) || (rec.version != QC3_CAP_VERSION) ||
+        (rec.count > CAP_CACHE_LEN)) {
+        return false;
+    }
+    memcpy(_cap_cache, rec.entries, sizeof(_cap_cache));
+    _cap_count = rec.count;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 判定結果の記録をNVSへ保存
+ * @return 保存結果（true: 成功, false: 失敗またはESP32以外）
+ */
+bool ESP32_QC3_CTL::saveCapabilityCache() {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3CapRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = QC3_CAP_MAGIC;
+    rec.version = QC3_CAP_VERSION;
+    rec.count = _cap_count;
+    memcpy(rec.entries, _cap_cache, sizeof(_cap_cache));
+
+    Preferences prefs;
+    if (!prefs.begin(QC3_CAP_NAMESPACE, false)) {
+        return false;
+    }
+    const size_t written = prefs.putBytes(QC3_CAP_KEY, &rec, sizeof(rec));
+    prefs.end();
+    return written == sizeof(rec);
+#else
+    return false;
+#endif
+}
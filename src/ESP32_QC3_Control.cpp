@@ -0,0 +1,264 @@
+/**
+ * @file ESP32_QC3_Control.cpp
+ * @brief ESP32_QC3_CTLの制御タスクとコマンドキュー実装
+ * 
+ * QC3の制御（検出・パルス出力・定電圧制御・計測）を専用のFreeRTOSタスクに
+ * 集約します。他のタスク（HTTPハンドラやボタン処理）はpostCommand()で
+ * コマンドを投入し、状態はgetSnapshot()で取得します。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+/**
+ * @brief 抜き差し監視・保護機能の通知・検出・パルス出力・定電圧制御・連続ADCサンプリング・自動保存を1回ずつ進める
+ */
+void ESP32_QC3_CTL::update() {
+    Command cmd;
+    while (_cmd_queue.pop(cmd)) {
+        executeCommand(cmd);
+    }
+
+    (void)pollProtection();
+    (void)pollHotplug();
+    if (isDetecting()) {
+        (void)pollDetect();
+    }
+    (void)pollVar();
+    (void)pollRegulation();
+    (void)pollAdcStream();
+    (void)pollSave();
+
+    publishSnapshot();
+}
+
+/**
+ * @brief 制御タスクの起動
+ * @param core 実行するコア
+ * @param priority タスク優先度
+ * @param period_ms 制御周期（ms）
+ * @return 起動結果（true: 成功, false: 失敗またはESP32以外）
+ */
+bool ESP32_QC3_CTL::startControlTask(uint8_t core, uint8_t priority, uint32_t period_ms) {
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_ctl_task != NULL) {
+        return true;
+    }
+    _ctl_period_ms = (period_ms > 0U) ? period_ms : 1U;
+    _ctl_run = true;
+    const BaseType_t ret = xTaskCreatePinnedToCore(
+        &ESP32_QC3_CTL::controlTask,
+        "qc3_ctl",
+        4096,
+        this,
+        priority,
+        &_ctl_task,
+        core
+    );
+    if (ret != pdPASS) {
+        _ctl_run = false;
+        _ctl_task = NULL;
+        return false;
+    }
+    return true;
+#else
+    (void)core;
+    (void)priority;
+    (void)period_ms;
+    return false;
+#endif
+}
+
+/**
+ * @brief 制御タスクの停止
+ */
+void ESP32_QC3_CTL::stopControlTask() {
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_ctl_task == NULL) {
+        return;
+    }
+    _ctl_run = false;
+    // タスクは周期の切れ目で自身を削除する
+    while (_ctl_task != NULL) {
+        vTaskDelay(1);
+    }
+#endif
+}
+
+/**
+ * @brief 制御タスクが動作中かどうか
+ * @return true: 動作中, false: 停止中
+ */
+bool ESP32_QC3_CTL::isControlTaskRunning() {
+#if defined(ARDUINO_ARCH_ESP32)
+    return _ctl_task != NULL;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief コマンドの投入
+ * @param type コマンド種別（CMD_TYPE）
+ * @param value 引数
+ * @return コマンドID（0: キューが満杯）
+ */
+uint32_t ESP32_QC3_CTL::postCommand(uint8_t type, int32_t value) {
+    Command cmd;
+    cmd.type = type;
+    cmd.value = value;
+    cmd.id = _cmd_next_id.fetch_add(1U);
+    if (cmd.id == 0U) {
+        // 0は失敗を表すため採番し直す
+        cmd.id = _cmd_next_id.fetch_add(1U);
+    }
+    if (!_cmd_queue.push(cmd)) {
+        return 0U;
+    }
+    return cmd.id;
+}
+
+/**
+ * @brief 複数コマンドの一括投入
+ * @param cmds コマンド（typeとvalueを設定、idは採番される）
+ * @param count コマンド数
+ * @return 最後のコマンドのID（0: キューの空きが足りない）
+ */
+uint32_t ESP32_QC3_CTL::postCommands(Command *cmds, uint8_t count) {
+    if ((count == 0U) || (count > CMD_QUEUE_LEN)) {
+        return 0U;
+    }
+    for (uint8_t i = 0U; i < count; i++) {
+        cmds[i].id = _cmd_next_id.fetch_add(1U);
+        if (cmds[i].id == 0U) {
+            // 0は失敗を表すため採番し直す
+            cmds[i].id = _cmd_next_id.fetch_add(1U);
+        }
+    }
+    if (!_cmd_queue.pushBatch(cmds, count)) {
+        return 0U;
+    }
+    return cmds[count - 1U].id;
+}
+
+/**
+ * @brief 制御状態のスナップショットを取得
+ * @param snap 取得先
+ * @return 取得結果（true: 成功, false: 未更新）
+ */
+bool ESP32_QC3_CTL::getSnapshot(Snapshot *snap) {
+    uint32_t seq;
+    do {
+        seq = _snap_seq.load(std::memory_order_acquire);
+        if (seq == 0U) {
+            return false;
+        }
+        memcpy(snap, &_snap, sizeof(Snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (((seq & 1U) != 0U) || (seq != _snap_seq.load(std::memory_order_relaxed)));
+    return true;
+}
+
+/**
+ * @brief 電力量の積算先の登録
+ * @param meter 積算先（NULLで解除）
+ * @note update()毎にスナップショットと同じVBUS/電流の実測値を積算する
+ */
+void ESP32_QC3_CTL::setEnergyMeter(QC3EnergyMeter *meter) {
+    _energy = meter;
+}
+
+/**
+ * @brief コマンドの実行
+ * @param cmd コマンド
+ */
+void ESP32_QC3_CTL::executeCommand(const Command &cmd) {
+    switch (cmd.type) {
+        case CMD_SET_MODE:
+            (void)set_VBUS((uint8_t)cmd.value);
+            break;
+        case CMD_VAR_STEP: {
+            int32_t target = (int32_t)getVarTarget() + cmd.value;
+            if (target < 0) {
+                target = 0;
+            }
+            (void)setVarVoltage((uint16_t)target);
+            break;
+        }
+        case CMD_SET_VAR:
+            (void)setVarVoltage((uint16_t)cmd.value);
+            break;
+        case CMD_REGULATE:
+            if (cmd.value > 0) {
+                (void)startRegulation((uint16_t)cmd.value);
+            } else {
+                stopRegulation();
+            }
+            break;
+        case CMD_OUTPUT:
+            (void)setOutput(cmd.value != 0);
+            break;
+        case CMD_DETECT:
+            startDetect();
+            break;
+        default:
+            break;
+    }
+    _cmd_done_id = cmd.id;
+    QC3_TRACE(TRACE_CMD, cmd.type, cmd.id);
+}
+
+/**
+ * @brief スナップショットの更新
+ * @note 更新中は_snap_seqが奇数になり、getSnapshot()側で読み直す
+ */
+void ESP32_QC3_CTL::publishSnapshot() {
+    const uint16_t vbus = readVbusMillivolts();
+    const int32_t current = readCurrentMilliamps();
+    if (_energy != NULL) {
+        _energy->addSample(vbus, current, _hal->micros());
+    }
+
+    const uint32_t seq = _snap_seq.load(std::memory_order_relaxed);
+    _snap_seq.store(seq + 1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _snap.host_type = _host_type;
+    _snap.qc_mode = _qc_mode;
+    _snap.detect_state = _detect_state;
+    _snap.reg_state = _reg_state;
+    _snap.fault = _fault_code;
+    _snap.class_b = _use_class_b;
+    _snap.output = _is_on;
+    _snap.var_busy = isVarBusy();
+    _snap.voltage = _vbus_val;
+    _snap.var_target = getVarTarget();
+    _snap.vbus_mV = vbus;
+    _snap.current_mA = current;
+    _snap.last_cmd_id = _cmd_done_id;
+    _snap.timestamp = _hal->millis();
+
+    _snap_seq.store(seq + 2U, std::memory_order_release);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * @brief 制御タスク本体
+ * @param arg ESP32_QC3_CTLインスタンス
+ */
+void ESP32_QC3_CTL::controlTask(void *arg) {
+    ESP32_QC3_CTL *self = (ESP32_QC3_CTL *)arg;
+    TickType_t last = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(self->_ctl_period_ms);
+    if (period == 0) {
+        period = 1;
+    }
+
+    while (self->_ctl_run) {
+        self->update();
+        vTaskDelayUntil(&last, period);
+    }
+
+    self->_ctl_task = NULL;
+    vTaskDelete(NULL);
+}
+#endif
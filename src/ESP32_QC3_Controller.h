@@ -0,0 +1,70 @@
+/**
+ * @file ESP32_QC3_Controller.h
+ * @brief ピン配置をテンプレート引数で固定したESP32_QC3_CTL
+ *
+ * ピン番号をコンパイル時に与えることで、出力不可のピンやADC非対応のピン、
+ * （QC3_ADC1_ONLY=1の場合）ADC2のピンをstatic_assertでビルド時に検出します。
+ * begin()でD+/D-の駆動方式をPIN_BACKEND_BUNDLE（GPIOレジスタ直接書き込み）にします
+ * （ESP32_QC3_CTL*経由でbegin()を呼び出した場合も同様）。
+ */
+
+#ifndef ESP32_QC3_CONTROLLER_H
+#define ESP32_QC3_CONTROLLER_H
+
+#include "ESP32_QC3_CTL.h"
+
+#ifndef QC3_ADC1_ONLY
+ #define QC3_ADC1_ONLY 0  ///< 1: ADC読み取りピンをADC1に限定（ESP32でWiFiを使う場合）
+#endif
+
+/**
+ * @brief ピン配置をコンパイル時に固定したQC3制御クラス
+ * @tparam DP_H D+端子のHIGHピン
+ * @tparam DP_L D+端子のLOWピン
+ * @tparam DM_H D-端子のHIGHピン
+ * @tparam DM_L D-端子のLOWピン
+ * @tparam VBUS_DET VBUS検出ピン
+ * @tparam OUT_EN 出力有効ピン（0: 未使用）
+ */
+template <uint8_t DP_H, uint8_t DP_L, uint8_t DM_H, uint8_t DM_L, uint8_t VBUS_DET, uint8_t OUT_EN = 0>
+class QC3Controller : public ESP32_QC3_CTL {
+    static_assert(qc3IsOutputPin(DP_H) && qc3IsOutputPin(DP_L),
+        "D+ pins must be output-capable GPIOs");
+    static_assert(qc3IsOutputPin(DM_H) && qc3IsOutputPin(DM_L),
+        "D- pins must be output-capable GPIOs");
+    static_assert((OUT_EN == 0) || qc3IsOutputPin(OUT_EN),
+        "OUT_EN must be an output-capable GPIO");
+    static_assert((DP_H != DP_L) && (DP_H != DM_H) && (DP_H != DM_L) &&
+        (DP_L != DM_H) && (DP_L != DM_L) && (DM_H != DM_L),
+        "D+/D- pins must be distinct");
+    static_assert((VBUS_DET != DP_H) && (VBUS_DET != DP_L) &&
+        (VBUS_DET != DM_H) && (VBUS_DET != DM_L) && (VBUS_DET != OUT_EN),
+        "VBUS_DET must not share a pin with D+/D-/OUT_EN");
+    static_assert(qc3IsValidPin(VBUS_DET) && qc3IsAdcPin(VBUS_DET, QC3_ADC1_ONLY),
+        "VBUS_DET must be an ADC pin (ADC1 when QC3_ADC1_ONLY=1)");
+    // DP_H/DM_Hは検出時に読み返す。ADC非対応のピン（M5Stack Core2のGPIO19等）は0mVとして扱われるため許容する
+    static_assert(!QC3_ADC1_ONLY ||
+        ((qc3AdcUnit(DP_H) != QC3_ADC_UNIT2) && (qc3AdcUnit(DM_H) != QC3_ADC_UNIT2)),
+        "DP_H/DM_H must not be ADC2 pins when QC3_ADC1_ONLY=1");
+
+public:
+    /**
+     * @brief コンストラクタ
+     * @note ESP32ではbegin()以降、D+/D-をGPIOレジスタ直接書き込みで駆動する
+     */
+    QC3Controller() : ESP32_QC3_CTL(DP_H, DP_L, DM_H, DM_L, VBUS_DET, OUT_EN) {
+#if defined(ARDUINO_ARCH_ESP32)
+        _begin_backend = PIN_BACKEND_BUNDLE;
+#endif
+    }
+
+    /**
+     * @brief VBUS検出ピンのADCユニット
+     * @return ADCユニット（QC3_ADC_UNIT）
+     */
+    static constexpr uint8_t vbusAdcUnit() {
+        return qc3AdcUnit(VBUS_DET);
+    }
+};
+
+#endif // ESP32_QC3_CONTROLLER_H
@@ -0,0 +1,183 @@
+/**
+ * @file ESP32_QC3_Energy.cpp
+ * @brief 電力量・電荷量の積算の実装
+ */
+
+#include "ESP32_QC3_Energy.h"
+
+#include <string.h>
+
+static const int64_t QC3_UWH_DIV = 7200000000LL;  ///< 1uWh = 3.6e9 uW*us（台形積分の2倍値で保持）
+static const int64_t QC3_UAH_DIV = 7200000LL;     ///< 1uAh = 3.6e6 mA*us（台形積分の2倍値で保持）
+
+QC3EnergyMeter::QC3EnergyMeter() {
+    clear(&_total);
+    for (uint16_t i = 0U; i < QC3_ENERGY_MAX_STEPS; i++) {
+        clear(&_steps[i]);
+    }
+    _seq.store(0U, std::memory_order_relaxed);
+    _reset_req.store(false, std::memory_order_relaxed);
+    _step.store(0xFFFFU, std::memory_order_relaxed);
+    _max_gap_us = 1000000UL;
+    _gaps = 0U;
+    _has_prev = false;
+    _prev_us = 0U;
+    _prev_mV = 0U;
+    _prev_mA = 0;
+}
+
+/**
+ * @brief サンプルの追加（前回のサンプルとの区間を積算）
+ * @param vbus_mV VBUS（mV）
+ * @param current_mA 電流（mA）
+ * @param now_us サンプルの時刻（us）
+ * @note 前回からの間隔がsetMaxGap()を超えた場合は積算せず、このサンプルから再開する
+ */
+void QC3EnergyMeter::addSample(uint16_t vbus_mV, int32_t current_mA, uint32_t now_us) {
+    const bool do_reset = _reset_req.exchange(false, std::memory_order_acquire);
+    const uint32_t dt = now_us - _prev_us;
+    const bool integrate = _has_prev && (dt <= _max_gap_us);
+    if (_has_prev && !integrate) {
+        _gaps++;
+    }
+
+    if (do_reset || integrate) {
+        const uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1U, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (do_reset) {
+            clear(&_total);
+            for (uint16_t i = 0U; i < QC3_ENERGY_MAX_STEPS; i++) {
+                clear(&_steps[i]);
+            }
+            _gaps = 0U;
+        }
+        if (integrate) {
+            // 台形積分（2倍値）: (p0 + p1) * dt
+            const int64_t p0 = (int64_t)_prev_mV * _prev_mA;
+            const int64_t p1 = (int64_t)vbus_mV * current_mA;
+            const int64_t e2 = (p0 + p1) * dt;
+            const int64_t q2 = ((int64_t)_prev_mA + current_mA) * dt;
+            const uint32_t mW = (p1 > 0) ? (uint32_t)(p1 / 1000) : 0U;
+            accumulate(&_total, e2, q2, dt, current_mA, mW);
+            const uint16_t step = _step.load(std::memory_order_relaxed);
+            if (step < QC3_ENERGY_MAX_STEPS) {
+                accumulate(&_steps[step], e2, q2, dt, current_mA, mW);
+            }
+        }
+
+        _seq.store(seq + 2U, std::memory_order_release);
+    }
+
+    _has_prev = true;
+    _prev_us = now_us;
+    _prev_mV = vbus_mV;
+    _prev_mA = current_mA;
+}
+
+/**
+ * @brief 積算のリセット（ステップ毎の合計を含む）
+ * @note 次のaddSample()で反映する。反映までgetTotals()は0を返す
+ */
+void QC3EnergyMeter::reset() {
+    _reset_req.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief 以降の区間を積算するステップの設定
+ * @param step ステップ番号（QC3_ENERGY_MAX_STEPS以上はステップ毎の合計に含めない）
+ */
+void QC3EnergyMeter::setStep(uint16_t step) {
+    _step.store(step, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 積算を中断するサンプル間隔の設定
+ * @param gap_us サンプル間隔の上限（us、既定1秒）
+ */
+void QC3EnergyMeter::setMaxGap(uint32_t gap_us) {
+    _max_gap_us = gap_us;
+}
+
+/**
+ * @brief 全体の合計の取得
+ * @param totals 取得先
+ */
+void QC3EnergyMeter::getTotals(Totals *totals) {
+    read(&_total, totals);
+}
+
+/**
+ * @brief ステップ毎の合計の取得
+ * @param step ステップ番号
+ * @param totals 取得先
+ * @return 取得結果（true: 成功, false: 範囲外のステップ番号）
+ */
+bool QC3EnergyMeter::getStepTotals(uint16_t step, Totals *totals) {
+    if (step >= QC3_ENERGY_MAX_STEPS) {
+        return false;
+    }
+    read(&_steps[step], totals);
+    return true;
+}
+
+/**
+ * @brief 積算を中断した回数（サンプル間隔の超過）
+ * @return 回数
+ */
+uint32_t QC3EnergyMeter::getGapCount() {
+    return _gaps;
+}
+
+/**
+ * @brief 積算値のクリア
+ * @param acc 積算値
+ */
+void QC3EnergyMeter::clear(Accumulator *acc) {
+    memset(acc, 0, sizeof(Accumulator));
+}
+
+/**
+ * @brief 1区間の積算（端数は繰り越す）
+ * @param acc 積算値
+ * @param e2 電力量の2倍値（uW*us）
+ * @param q2 電荷量の2倍値（mA*us）
+ * @param dt_us 区間の長さ（us）
+ * @param mA 区間終点の電流（mA）
+ * @param mW 区間終点の電力（mW）
+ */
+void QC3EnergyMeter::accumulate(Accumulator *acc, int64_t e2, int64_t q2, uint32_t dt_us, int32_t mA, uint32_t mW) {
+    acc->e_rem += e2;
+    acc->totals.energy_uWh += acc->e_rem / QC3_UWH_DIV;
+    acc->e_rem %= QC3_UWH_DIV;
+    acc->q_rem += q2;
+    acc->totals.charge_uAh += acc->q_rem / QC3_UAH_DIV;
+    acc->q_rem %= QC3_UAH_DIV;
+    acc->totals.duration_us += dt_us;
+    acc->totals.samples++;
+    if (mA > acc->totals.peak_mA) {
+        acc->totals.peak_mA = mA;
+    }
+    if (mW > acc->totals.peak_mW) {
+        acc->totals.peak_mW = mW;
+    }
+}
+
+/**
+ * @brief 積算結果の読み出し（更新中は読み直す）
+ * @param acc 積算値
+ * @param totals 取得先
+ */
+void QC3EnergyMeter::read(const Accumulator *acc, Totals *totals) {
+    if (_reset_req.load(std::memory_order_acquire)) {
+        memset(totals, 0, sizeof(Totals));
+        return;
+    }
+    uint32_t seq;
+    do {
+        seq = _seq.load(std::memory_order_acquire);
+        *totals = acc->totals;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (((seq & 1U) != 0U) || (seq != _seq.load(std::memory_order_relaxed)));
+}
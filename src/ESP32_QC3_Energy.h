@@ -0,0 +1,119 @@
+/**
+ * @file ESP32_QC3_Energy.h
+ * @brief 電力量（mWh）・電荷量（mAh）の積算
+ *
+ * VBUS（mV）と電流（mA）の組をタイムスタンプ付きで受け取り、前回のサンプルとの
+ * 台形積分で電力量・電荷量を整数演算のみで積算します。端数は次回へ繰り越すため、
+ * 長時間積算しても丸め誤差は蓄積しません。
+ * 積算はサンプル間隔に依存するため、制御周期やADCの取り込み周期で呼び出すほど
+ * 負荷変動の大きい対象でも正確になります。
+ * 全体の合計に加えて、setStep()で指定したステップ（QC3Sequenceのステップ番号等）
+ * 毎の合計を保持します。
+ */
+
+#ifndef ESP32_QC3_ENERGY_H
+#define ESP32_QC3_ENERGY_H
+
+#include <stdint.h>
+#include <atomic>
+
+#ifndef QC3_ENERGY_MAX_STEPS
+ #define QC3_ENERGY_MAX_STEPS 16  ///< ステップ毎の合計を保持するステップ数
+#endif
+
+/**
+ * @brief 電力量・電荷量の積算
+ * @note addSample()は1つのタスクから呼び出すこと。getTotals()/getStepTotals()/
+ *       reset()/setStep()は他のタスクから呼び出してよい
+ */
+class QC3EnergyMeter {
+public:
+    /**
+     * @brief 積算結果
+     */
+    struct Totals {
+        int64_t energy_uWh;    ///< 電力量（uWh）
+        int64_t charge_uAh;    ///< 電荷量（uAh、電流が負の区間は減算）
+        uint64_t duration_us;  ///< 積算した時間（us）
+        uint32_t samples;      ///< 積算した区間数
+        int32_t peak_mA;       ///< 最大電流（mA）
+        uint32_t peak_mW;      ///< 最大電力（mW）
+    };
+
+    QC3EnergyMeter();
+
+    /**
+     * @brief サンプルの追加（前回のサンプルとの区間を積算）
+     * @param vbus_mV VBUS（mV）
+     * @param current_mA 電流（mA）
+     * @param now_us サンプルの時刻（us）
+     * @note 前回からの間隔がsetMaxGap()を超えた場合は積算せず、このサンプルから再開する
+     */
+    void addSample(uint16_t vbus_mV, int32_t current_mA, uint32_t now_us);
+
+    /**
+     * @brief 積算のリセット（ステップ毎の合計を含む）
+     * @note 次のaddSample()で反映する。反映までgetTotals()は0を返す
+     */
+    void reset();
+
+    /**
+     * @brief 以降の区間を積算するステップの設定
+     * @param step ステップ番号（QC3_ENERGY_MAX_STEPS以上はステップ毎の合計に含めない）
+     */
+    void setStep(uint16_t step);
+
+    /**
+     * @brief 積算を中断するサンプル間隔の設定
+     * @param gap_us サンプル間隔の上限（us、既定1秒）
+     */
+    void setMaxGap(uint32_t gap_us);
+
+    /**
+     * @brief 全体の合計の取得
+     * @param totals 取得先
+     */
+    void getTotals(Totals *totals);
+
+    /**
+     * @brief ステップ毎の合計の取得
+     * @param step ステップ番号
+     * @param totals 取得先
+     * @return 取得結果（true: 成功, false: 範囲外のステップ番号）
+     */
+    bool getStepTotals(uint16_t step, Totals *totals);
+
+    /**
+     * @brief 積算を中断した回数（サンプル間隔の超過）
+     * @return 回数
+     */
+    uint32_t getGapCount();
+
+private:
+    /**
+     * @brief 積算値（端数を含む）
+     */
+    struct Accumulator {
+        Totals totals;      ///< 積算結果
+        int64_t e_rem;      ///< 電力量の端数（uW*us*2）
+        int64_t q_rem;      ///< 電荷量の端数（mA*us*2）
+    };
+
+    Accumulator _total;                            ///< 全体の合計
+    Accumulator _steps[QC3_ENERGY_MAX_STEPS];      ///< ステップ毎の合計
+    std::atomic<uint32_t> _seq;                    ///< 更新カウンタ（更新中は奇数）
+    std::atomic<bool> _reset_req;                  ///< リセット要求
+    std::atomic<uint16_t> _step;                   ///< 積算先のステップ番号
+    uint32_t _max_gap_us;                          ///< 積算を中断するサンプル間隔（us）
+    uint32_t _gaps;                                ///< 積算を中断した回数
+    bool _has_prev;                                ///< 前回のサンプルあり
+    uint32_t _prev_us;                             ///< 前回のサンプルの時刻（us）
+    uint16_t _prev_mV;                             ///< 前回のVBUS（mV）
+    int32_t _prev_mA;                              ///< 前回の電流（mA）
+
+    static void clear(Accumulator *acc);
+    static void accumulate(Accumulator *acc, int64_t e2, int64_t q2, uint32_t dt_us, int32_t mA, uint32_t mW);
+    void read(const Accumulator *acc, Totals *totals);
+};
+
+#endif // ESP32_QC3_ENERGY_H
@@ -0,0 +1,250 @@
+/**
+ * @file ESP32_QC3_Filter.h
+ * @brief 計測値用の固定小数点フィルタ（動的メモリ確保なし）
+ * 
+ * 窓長とサンプル型をテンプレート引数で指定し、更新はいずれもO(1)
+ * （メディアンのみO(N)）で動作します。浮動小数点演算は使用しません。
+ */
+
+#ifndef ESP32_QC3_FILTER_H
+#define ESP32_QC3_FILTER_H
+
+#include <stdint.h>
+
+/**
+ * @brief 移動平均フィルタ（リングバッファ + 累積和）
+ * @tparam T サンプルの型
+ * @tparam N 窓長の上限（バッファの要素数）
+ * @tparam SumT 累積和の型（T * Nが収まる型）
+ * @note 窓長はsetLength()で実行時にN以下へ変更できる（既定はN）
+ */
+template <typename T, uint8_t N, typename SumT = int32_t>
+class QC3BoxcarFilter {
+    static_assert(N > 0U, "window length must be positive");
+
+public:
+    QC3BoxcarFilter() : _len(N) {
+        reset();
+    }
+
+    /**
+     * @brief 窓長の変更（サンプルは破棄される）
+     * @param len 窓長（1〜N、範囲外は丸める）
+     */
+    void setLength(uint8_t len) {
+        _len = (len == 0U) ? 1U : ((len > N) ? N : len);
+        reset();
+    }
+
+    /**
+     * @brief 窓長の取得
+     * @return 窓長
+     */
+    uint8_t length() const {
+        return _len;
+    }
+
+    /**
+     * @brief フィルタの初期化
+     */
+    void reset() {
+        for (uint8_t i = 0U; i < N; i++) {
+            _buf[i] = 0;
+        }
+        _sum = 0;
+        _idx = 0U;
+        _count = 0U;
+    }
+
+    /**
+     * @brief 全要素を同じ値で初期化
+     * @param value 初期値
+     */
+    void fill(T value) {
+        for (uint8_t i = 0U; i < _len; i++) {
+            _buf[i] = value;
+        }
+        _sum = (SumT)value * (SumT)_len;
+        _idx = 0U;
+        _count = _len;
+    }
+
+    /**
+     * @brief サンプルの追加
+     * @param sample サンプル
+     * @return 追加後の平均値
+     */
+    T push(T sample) {
+        _sum -= (SumT)_buf[_idx];
+        _buf[_idx] = sample;
+        _sum += (SumT)sample;
+        _idx = (uint8_t)((_idx + 1U) % _len);
+        if (_count < _len) {
+            _count++;
+        }
+        return value();
+    }
+
+    /**
+     * @brief 平均値の取得
+     * @return 平均値（サンプル未追加の場合は0）
+     */
+    T value() const {
+        if (_count == 0U) {
+            return 0;
+        }
+        return (T)(_sum / (SumT)_count);
+    }
+
+    /**
+     * @brief 窓が埋まったかどうか
+     * @return true: 窓長以上追加済み
+     */
+    bool full() const {
+        return _count >= _len;
+    }
+
+    /**
+     * @brief 有効なサンプル数の取得
+     * @return サンプル数（最大は窓長）
+     */
+    uint8_t count() const {
+        return _count;
+    }
+
+private:
+    T _buf[N];       ///< サンプル
+    SumT _sum;       ///< 累積和
+    uint8_t _len;    ///< 窓長
+    uint8_t _idx;    ///< 次に書き込む位置
+    uint8_t _count;  ///< 有効なサンプル数
+};
+
+/**
+ * @brief 指数移動平均フィルタ（係数 1/2^SHIFT）
+ * @tparam T サンプルの型
+ * @tparam SHIFT 平滑化の強さ
+ */
+template <typename T, uint8_t SHIFT>
+class QC3EmaFilter {
+    static_assert((SHIFT > 0U) && (SHIFT < 16U), "shift must be 1..15");
+
+public:
+    QC3EmaFilter() {
+        reset();
+    }
+
+    /**
+     * @brief フィルタの初期化
+     */
+    void reset() {
+        _acc = 0;
+        _primed = false;
+    }
+
+    /**
+     * @brief サンプルの追加
+     * @param sample サンプル
+     * @return 追加後の平滑値
+     * @note 最初のサンプルで内部状態を初期化する
+     */
+    T push(T sample) {
+        const int32_t scaled = (int32_t)sample << SHIFT;
+        if (!_primed) {
+            _acc = scaled;
+            _primed = true;
+        } else {
+            _acc += (scaled - _acc) >> SHIFT;
+        }
+        return value();
+    }
+
+    /**
+     * @brief 平滑値の取得
+     * @return 平滑値
+     */
+    T value() const {
+        return (T)((_acc + (1L << (SHIFT - 1U))) >> SHIFT);
+    }
+
+private:
+    int32_t _acc;  ///< 平滑値（2^SHIFT倍）
+    bool _primed;  ///< 初期化済みフラグ
+};
+
+/**
+ * @brief メディアンフィルタ
+ * @tparam T サンプルの型
+ * @tparam N 窓長（奇数推奨）
+ * @note 到着順のリングバッファと整列済み配列を併せて保持し、更新はO(N)
+ */
+template <typename T, uint8_t N>
+class QC3MedianFilter {
+    static_assert(N > 0U, "window length must be positive");
+
+public:
+    QC3MedianFilter() {
+        reset();
+    }
+
+    /**
+     * @brief フィルタの初期化
+     */
+    void reset() {
+        _idx = 0U;
+        _count = 0U;
+    }
+
+    /**
+     * @brief サンプルの追加
+     * @param sample サンプル
+     * @return 追加後の中央値
+     */
+    T push(T sample) {
+        uint8_t pos;
+        if (_count < N) {
+            pos = _count;
+            _count++;
+        } else {
+            // 最も古いサンプルを整列済み配列から取り除く
+            const T oldest = _ring[_idx];
+            pos = 0U;
+            while ((pos < (N - 1U)) && (_sorted[pos] != oldest)) {
+                pos++;
+            }
+            while (pos < (N - 1U)) {
+                _sorted[pos] = _sorted[pos + 1U];
+                pos++;
+            }
+        }
+        _ring[_idx] = sample;
+        _idx = (uint8_t)((_idx + 1U) % N);
+
+        // 挿入ソート
+        while ((pos > 0U) && (_sorted[pos - 1U] > sample)) {
+            _sorted[pos] = _sorted[pos - 1U];
+            pos--;
+        }
+        _sorted[pos] = sample;
+        return value();
+    }
+
+    /**
+     * @brief 中央値の取得
+     * @return 中央値（サンプル未追加の場合は0）
+     */
+    T value() const {
+        if (_count == 0U) {
+            return 0;
+        }
+        return _sorted[(_count - 1U) / 2U];
+    }
+
+private:
+    T _ring[N];      ///< 到着順のサンプル
+    T _sorted[N];    ///< 整列済みのサンプル
+    uint8_t _idx;    ///< 次に書き込む位置
+    uint8_t _count;  ///< 有効なサンプル数
+};
+
+#endif // ESP32_QC3_FILTER_H
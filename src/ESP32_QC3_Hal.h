@@ -0,0 +1,113 @@
+/**
+ * @file ESP32_QC3_Hal.h
+ * @brief ESP32_QC3_CTL用のハードウェア抽象化レイヤ
+ *
+ * ESP32_QC3_CTLはGPIO/ADC/時刻の操作をQC3Hal経由で行います。
+ * Arduino環境では既定でQC3ArduinoHalを使用し、PC上ではQC3SimCharger等の
+ * 実装を差し替えることで実機なしに検出・電圧設定の処理を動かせます。
+ */
+
+#ifndef ESP32_QC3_HAL_H
+#define ESP32_QC3_HAL_H
+
+#if defined(ARDUINO)
+ #include <Arduino.h>
+#else
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <string.h>
+
+ // Arduino以外の環境向けのピン設定値（Arduino-ESP32と同じ値）
+ #ifndef INPUT
+  #define INPUT 0x01
+ #endif
+ #ifndef OUTPUT
+  #define OUTPUT 0x03
+ #endif
+ #ifndef LOW
+  #define LOW 0x0
+ #endif
+ #ifndef HIGH
+  #define HIGH 0x1
+ #endif
+#endif
+
+/**
+ * @brief GPIO/ADC/時刻操作のインターフェース
+ */
+class QC3Hal {
+public:
+    virtual ~QC3Hal() {}
+
+    /**
+     * @brief ピンの入出力設定
+     * @param pin ピン番号
+     * @param mode INPUT / OUTPUT
+     */
+    virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+
+    /**
+     * @brief デジタル出力
+     * @param pin ピン番号
+     * @param level LOW / HIGH
+     */
+    virtual void digitalWrite(uint8_t pin, uint8_t level) = 0;
+
+    /**
+     * @brief ADC読み取り
+     * @param pin ピン番号
+     * @return ADCの読み取り値（12bit）
+     */
+    virtual uint16_t analogRead(uint8_t pin) = 0;
+
+    /**
+     * @brief 待機（ms）
+     * @param ms 待機時間
+     */
+    virtual void delay(uint32_t ms) = 0;
+
+    /**
+     * @brief 待機（us）
+     * @param us 待機時間
+     */
+    virtual void delayMicroseconds(uint32_t us) = 0;
+
+    /**
+     * @brief 経過時間（ms）
+     * @return 起動からの経過時間
+     */
+    virtual uint32_t millis() = 0;
+
+    /**
+     * @brief 経過時間（us）
+     * @return 起動からの経過時間
+     */
+    virtual uint32_t micros() = 0;
+};
+
+#if defined(ARDUINO)
+/**
+ * @brief Arduino APIによるQC3Halの実装（既定）
+ */
+class QC3ArduinoHal : public QC3Hal {
+public:
+    /**
+     * @brief 共有インスタンスの取得
+     * @return インスタンス
+     */
+    static QC3ArduinoHal &instance() {
+        static QC3ArduinoHal hal;
+        return hal;
+    }
+
+    void pinMode(uint8_t pin, uint8_t mode) { ::pinMode(pin, mode); }
+    void digitalWrite(uint8_t pin, uint8_t level) { ::digitalWrite(pin, level); }
+    uint16_t analogRead(uint8_t pin) { return (uint16_t)::analogRead(pin); }
+    void delay(uint32_t ms) { ::delay(ms); }
+    void delayMicroseconds(uint32_t us) { ::delayMicroseconds(us); }
+    uint32_t millis() { return (uint32_t)::millis(); }
+    uint32_t micros() { return (uint32_t)::micros(); }
+};
+#endif
+
+#endif // ESP32_QC3_HAL_H
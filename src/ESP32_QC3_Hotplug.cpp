@@ -0,0 +1,194 @@
+/**
+ * @file ESP32_QC3_Hotplug.cpp
+ * @brief ESP32_QC3_CTLの抜き差し監視と再接続時の再検出
+ *
+ * VBUS検出ピンを制御周期毎に読み、しきい値未満が続いたら切断と判定します。
+ * 切断中は出力をOFF・D+/D-をハイインピーダンスにし、ホストタイプをBC_NAにして
+ * 電圧設定を受け付けません。VBUSが戻って安定したら、切断前の状態でstartResume()を
+ * 開始するため、QC3だった場合はClass B判定（20V印加）を省略して切断前の電圧へ戻ります。
+ * 抜いた直後のVBUSの低下では切断の判定より先に低電圧保護（UVP）が働くことがあるため、
+ * 出力ON中にラッチしたUVPのうち、ラッチからdebounce_ms以内にVBUSが切断のしきい値を
+ * 下回ったものは切断時に解除し、切断前の出力をONとして扱います。
+ * それより前にラッチしたUVP（過負荷等による充電器の停止）とOVP/OCPは解除しません。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+/**
+ * @brief 抜き差し監視の設定
+ * @param enable true: pollHotplug()でVBUSを監視し、切断・再接続を検出
+ * @param restore_output true: 再検出後に切断前の出力ON/OFFも復元
+ */
+void ESP32_QC3_CTL::setHotplugMonitor(bool enable, bool restore_output) {
+    _hp_restore_output = restore_output;
+    _hp_low = false;
+    if (!enable) {
+        _hp_state = HOTPLUG_OFF;
+        return;
+    }
+    // 有効化時点のVBUSで初期状態を決める（接続中なら検出は呼び出し側で行う）
+    getState(&_hp_saved);
+    _hp_was_on = _is_on;
+    _hp_tripped = false;
+    _hp_ts = _hal->millis();
+    _hp_state = (readVbusMillivolts() >= _hp_attach_mV) ? HOTPLUG_ATTACHED : HOTPLUG_DETACHED;
+}
+
+/**
+ * @brief 抜き差し監視のしきい値設定
+ * @param detach_mV 切断と判定するVBUS（mV、可変モードの下限より低くする）
+ * @param attach_mV 再接続と判定するVBUS（mV）
+ * @param debounce_ms 切断と判定するまでのVBUS低下の継続時間（ms）
+ * @param settle_ms 再接続後、再検出を始めるまでのVBUS安定待ち時間（ms）
+ */
+void ESP32_QC3_CTL::setHotplugThresholds(uint16_t detach_mV, uint16_t attach_mV,
+                                         uint16_t debounce_ms, uint16_t settle_ms) {
+    _hp_detach_mV = detach_mV;
+    _hp_attach_mV = (attach_mV > detach_mV) ? attach_mV : detach_mV;
+    _hp_debounce_ms = debounce_ms;
+    _hp_settle_ms = settle_ms;
+}
+
+/**
+ * @brief 抜き差し監視の処理
+ * @return 監視の状態（HOTPLUG_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollHotplug() {
+    return pollHotplug(_hal->millis());
+}
+
+/**
+ * @brief 抜き差し監視の処理（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ * @return 監視の状態（HOTPLUG_STATE）
+ * @note 再検出はpollDetect()（update()）で進める
+ */
+uint8_t ESP32_QC3_CTL::pollHotplug(uint32_t now_ms) {
+    if (_hp_state == HOTPLUG_OFF) {
+        return _hp_state;
+    }
+
+    const uint16_t vbus = readVbusMillivolts();
+    switch (_hp_state) {
+        case HOTPLUG_ATTACHED:
+        case HOTPLUG_REDETECT:
+            // フォルトをラッチした時刻（切断によるUVPかの判定に使う）
+            if (_fault_code == FAULT_NONE) {
+                _hp_tripped = false;
+            } else if (!_hp_tripped) {
+                _hp_tripped = true;
+                _hp_trip_ts = now_ms;
+            }
+            if (vbus >= _hp_detach_mV) {
+                _hp_low = false;
+                if (_fault_code == FAULT_NONE) {
+                    _hp_was_on = _is_on;
+                }
+                if ((_hp_state == HOTPLUG_REDETECT) && !isDetecting()) {
+                    _hp_state = HOTPLUG_ATTACHED;
+                    notifyHotplug(HOTPLUG_EV_READY, _host_type);
+                }
+                break;
+            }
+            // 負荷変動による瞬低と区別するため、低下が続いた場合のみ切断とする
+            if (!_hp_low) {
+                _hp_low = true;
+                _hp_ts = now_ms;
+            }
+            if ((uint32_t)(now_ms - _hp_ts) >= _hp_debounce_ms) {
+                QC3_TRACE(TRACE_HOTPLUG, HOTPLUG_EV_DETACH, vbus);
+                detachHotplug();
+            }
+            break;
+        case HOTPLUG_DETACHED:
+            if (vbus >= _hp_attach_mV) {
+                _hp_state = HOTPLUG_SETTLE;
+                _hp_ts = now_ms;
+            }
+            break;
+        case HOTPLUG_SETTLE:
+            if (vbus < _hp_attach_mV) {
+                // 挿し込み時のチャタリング: 安定待ちをやり直す
+                _hp_state = HOTPLUG_DETACHED;
+            } else if ((uint32_t)(now_ms - _hp_ts) >= _hp_settle_ms) {
+                QC3_TRACE(TRACE_HOTPLUG, HOTPLUG_EV_ATTACH, vbus);
+                _hp_state = HOTPLUG_REDETECT;
+                notifyHotplug(HOTPLUG_EV_ATTACH, BC_NA);
+                (void)startResume(_hp_saved, _hp_restore_output);
+            }
+            break;
+        default:
+            break;
+    }
+    return _hp_state;
+}
+
+/**
+ * @brief 抜き差し監視の状態の取得
+ * @return 監視の状態（HOTPLUG_STATE）
+ */
+uint8_t ESP32_QC3_CTL::getHotplugState() {
+    return _hp_state;
+}
+
+/**
+ * @brief 抜き差し監視コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void ESP32_QC3_CTL::setHotplugCallback(HotplugCallback cb, void *arg) {
+    _hp_cb = cb;
+    _hp_cb_arg = arg;
+}
+
+/**
+ * @brief 切断時の処理
+ * @note 再検出中に切断した場合は、再検出前に保持した切断前の状態を使い続ける。
+ *       切断中は出力OFFのため保護機能の判定は行われない
+ */
+void ESP32_QC3_CTL::detachHotplug() {
+    // 出力ON中のUVPのうち、ラッチ直後にVBUSが切断のしきい値を下回ったものは抜いたことによる
+    // VBUSの低下とみなし、ラッチを残さず再接続時に出力を戻す
+    // （VBUS低下の検出がラッチより先の場合も含む）
+    const bool unplug_uvp = (_fault_code == FAULT_UVP) && _hp_was_on && _hp_tripped &&
+                            ((int32_t)(_hp_ts - _hp_trip_ts) <= (int32_t)_hp_debounce_ms);
+    if (unplug_uvp) {
+        clearFault();
+    }
+    if (_hp_state == HOTPLUG_ATTACHED) {
+        getState(&_hp_saved);
+        if (unplug_uvp) {
+            _hp_saved.output = true;
+        }
+    }
+
+    // 可変モードのパルス出力と定電圧制御を中止し、端子を開放する
+    if (_host_type == QC3) {
+        (void)set_VBUS(QC_5V);
+    }
+    if (_is_on) {
+        (void)setOutput(false);
+    }
+    set_DP(QC_HIZ);
+    set_DM(QC_HIZ);
+    _detect_state = DETECT_IDLE;
+    _resume_pending = false;
+    _host_type = BC_NA;
+    _qc_mode = QC_5V;
+    _vbus_val = 0;
+
+    _hp_low = false;
+    _hp_state = HOTPLUG_DETACHED;
+    notifyHotplug(HOTPLUG_EV_DETACH, BC_NA);
+}
+
+/**
+ * @brief 抜き差し監視コールバックの呼び出し
+ * @param event イベント（HOTPLUG_EVENT）
+ * @param host_type ホストタイプ
+ */
+void ESP32_QC3_CTL::notifyHotplug(uint8_t event, uint8_t host_type) {
+    if (_hp_cb != NULL) {
+        _hp_cb(event, host_type, _hp_cb_arg);
+    }
+}
@@ -0,0 +1,660 @@
+/**
+ * @file ESP32_QC3_Log.cpp
+ * @brief 電力ログのバイナリ記録の実装
+ *
+ * ブロックヘッダ（24バイト、リトルエンディアン）:
+ *   0: magic(u16) 2: version(u8) 3: mode(u8) 4: seq(u32) 8: t0(u32)
+ *   12: unit_us(u16) 14: vbus_mV(u16) 16: current_mA(i32) 20: used(u16) 22: check(u16)
+ * checkは記録部（usedバイト）のFletcher-16です。
+ *
+ * 記録部（dtは前回の記録からの経過時間、dv/di/valueはzigzag符号化の可変長整数）:
+ *   0x80|dt       dv di      サンプル（dt < 128）
+ *   0x01 dt       dv di      サンプル
+ *   0x02 dt       mode(u8)   電圧モードの変更
+ *   0x03 dt       code(u8) value  イベント
+ */
+
+#include "ESP32_QC3_Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+ #include <Arduino.h>
+#endif
+
+static const uint16_t QC3_LOG_RECORD_MAX = 16U;  ///< 1件の記録の最大バイト数
+
+static void putU16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+    putU16(p, (uint16_t)v);
+    putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t getU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *p) {
+    return (uint32_t)getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+static uint8_t *putVar(uint8_t *p, uint32_t v) {
+    while (v >= 0x80U) {
+        *p++ = (uint8_t)(v | 0x80U);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t *putSigned(uint8_t *p, int32_t v) {
+    return putVar(p, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+static const uint8_t *getVar(const uint8_t *p, const uint8_t *end, uint32_t *v) {
+    uint32_t r = 0U;
+    for (uint8_t shift = 0U; shift < 35U; shift += 7U) {
+        if (p >= end) {
+            return NULL;
+        }
+        const uint8_t b = *p++;
+        r |= (uint32_t)(b & 0x7FU) << shift;
+        if ((b & 0x80U) == 0U) {
+            *v = r;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static const uint8_t *getSigned(const uint8_t *p, const uint8_t *end, int32_t *v) {
+    uint32_t u = 0U;
+    p = getVar(p, end, &u);
+    *v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1U);
+    return p;
+}
+
+static uint16_t fletcher16(const uint8_t *p, uint16_t len) {
+    uint16_t a = 0U;
+    uint16_t b = 0U;
+    for (uint16_t i = 0U; i < len; i++) {
+        a = (uint16_t)((a + p[i]) % 255U);
+        b = (uint16_t)((b + a) % 255U);
+    }
+    return (uint16_t)((b << 8) | a);
+}
+
+QC3Logger::QC3Logger() {
+    _buf[0] = NULL;
+    _buf[1] = NULL;
+    _cur = 0U;
+    _pending = false;
+    _pending_index = 0U;
+    _used = 0U;
+    _index = 0U;
+    _max_blocks = 0U;
+    _seq = 0U;
+    _unit_us = 1000U;
+    _active = false;
+    _has_time = false;
+    _last_us = 0U;
+    _rem_us = 0U;
+    _now = 0U;
+    _t = 0U;
+    _vbus_mV = 0U;
+    _current_mA = 0;
+    _mode = 0U;
+    _dropped = 0U;
+    _blocks = 0U;
+    _bytes = 0U;
+    _sink = NULL;
+    _sink_arg = NULL;
+}
+
+QC3Logger::~QC3Logger() {
+    end();
+}
+
+/**
+ * @brief 書き込み先の登録（ファイル以外へ書き込む場合）
+ * @param sink 書き込み関数
+ * @param arg 書き込み関数に渡すユーザー引数
+ */
+void QC3Logger::setBlockSink(BlockSink sink, void *arg) {
+    _sink = sink;
+    _sink_arg = arg;
+}
+
+/**
+ * @brief 記録の開始（setBlockSink()の書き込み先へ記録）
+ * @param max_blocks リングのブロック数
+ * @param unit_us 時刻の単位（us、既定1ms）
+ * @return 開始結果（true: 成功, false: 引数不正または書き込み先なし）
+ */
+bool QC3Logger::begin(uint16_t max_blocks, uint16_t unit_us) {
+    return start(max_blocks, unit_us, 0U, 0U, 0U);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * @brief 最後の記録の保持（続けて記録する場合の基準値）
+ */
+static void keepLast(const QC3Logger::Record &rec, void *arg) {
+    *(QC3Logger::Record *)arg = rec;
+}
+
+/**
+ * @brief 記録の開始（ファイルへ記録）
+ * @param fs ファイルシステム（LittleFS, SPIFFS等、begin()済みのもの）
+ * @param path ファイルのパス
+ * @param max_blocks リングのブロック数（ファイルサイズ = max_blocks * BLOCK_SIZE）
+ * @param unit_us 時刻の単位（us、既定1ms）
+ * @return 開始結果（true: 成功, false: 引数不正またはファイルを開けない）
+ * @note 既存のファイルがあれば最新のブロックの次から続けて記録する
+ */
+bool QC3Logger::begin(fs::FS &fs, const char *path, uint16_t max_blocks, uint16_t unit_us) {
+    end();
+    if ((path == NULL) || (max_blocks == 0U) || (unit_us == 0U)) {
+        return false;
+    }
+    _file = fs.exists(path) ? fs.open(path, "r+") : fs.open(path, "w+");
+    if (!_file) {
+        return false;
+    }
+
+    // 既存のブロックから最新の通し番号を探す（ヘッダのみ読む）
+    uint16_t index = 0U;
+    uint32_t seq = 0U;
+    bool found = false;
+    uint16_t newest = 0U;
+    uint8_t hdr[HEADER_SIZE];
+    const uint32_t count = (uint32_t)(_file.size() / BLOCK_SIZE);
+    for (uint32_t i = 0U; (i < count) && (i < max_blocks); i++) {
+        BlockInfo info;
+        if (!_file.seek(i * BLOCK_SIZE) || (_file.read(hdr, HEADER_SIZE) != HEADER_SIZE) ||
+            !parseHeader(hdr, &info) || (info.unit_us != unit_us)) {
+            continue;
+        }
+        if (!found || ((int32_t)(info.seq - seq) > 0)) {
+            seq = info.seq;
+            newest = (uint16_t)i;
+            found = true;
+        }
+    }
+
+    Record last;
+    memset(&last, 0, sizeof(last));
+    if (found) {
+        index = (uint16_t)((newest + 1U) % max_blocks);
+        // 最新のブロックの最後の記録から時刻・値を引き継ぐ
+        uint8_t *block = (uint8_t *)malloc(BLOCK_SIZE);
+        if (block != NULL) {
+            if (_file.seek((uint32_t)newest * BLOCK_SIZE) && (_file.read(block, BLOCK_SIZE) == BLOCK_SIZE)) {
+                BlockInfo info;
+                if (readBlockInfo(block, &info)) {
+                    last.t_us = (uint64_t)info.t0 * unit_us;
+                    last.vbus_mV = info.vbus_mV;
+                    last.current_mA = info.current_mA;
+                    last.mode = info.mode;
+                    (void)decodeBlock(block, keepLast, &last);
+                }
+            }
+            free(block);
+        }
+        seq++;
+    }
+
+    setBlockSink(fileSink, this);
+    if (!start(max_blocks, unit_us, index, seq, (uint32_t)(last.t_us / unit_us))) {
+        _file.close();
+        return false;
+    }
+    if (found) {
+        _vbus_mV = last.vbus_mV;
+        _current_mA = last.current_mA;
+        _mode = last.mode;
+        openBlock();
+        (void)logEvent(EVENT_RESTART, 0);
+    }
+    return true;
+}
+
+/**
+ * @brief ファイルへのブロック書き込み
+ * @param index リング上のブロック位置
+ * @param block ブロック（BLOCK_SIZEバイト）
+ * @param arg QC3Loggerインスタンス
+ * @return 書き込み結果（true: 成功）
+ */
+bool QC3Logger::fileSink(uint16_t index, const uint8_t *block, void *arg) {
+    fs::File &file = ((QC3Logger *)arg)->_file;
+    if (!file.seek((uint32_t)index * BLOCK_SIZE)) {
+        return false;
+    }
+    if (file.write(block, BLOCK_SIZE) != BLOCK_SIZE) {
+        return false;
+    }
+    file.flush();
+    return true;
+}
+#endif
+
+/**
+ * @brief 記録の終了（書き込み途中のブロックも書き込む）
+ */
+void QC3Logger::end() {
+    if (_active) {
+        (void)flush();
+    }
+    _active = false;
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_file) {
+        _file.close();
+    }
+#endif
+    free(_buf[0]);
+    free(_buf[1]);
+    _buf[0] = NULL;
+    _buf[1] = NULL;
+}
+
+#if defined(ARDUINO)
+/**
+ * @brief VBUS/電流のサンプルを記録
+ * @param vbus_mV VBUS（mV）
+ * @param current_mA 電流（mA）
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logSample(uint16_t vbus_mV, int32_t current_mA) {
+    return logSample(vbus_mV, current_mA, (uint32_t)micros());
+}
+
+/**
+ * @brief 電圧モードの変更を記録
+ * @param mode 電圧モード（QC_VOLTAGE_MODE）
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logMode(uint8_t mode) {
+    return logMode(mode, (uint32_t)micros());
+}
+
+/**
+ * @brief イベントマーカーを記録
+ * @param code イベントコード（利用側で定義）
+ * @param value 値
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logEvent(uint8_t code, int32_t value) {
+    return logEvent(code, value, (uint32_t)micros());
+}
+#endif
+
+/**
+ * @brief VBUS/電流のサンプルを記録（時刻指定）
+ * @param vbus_mV VBUS（mV）
+ * @param current_mA 電流（mA）
+ * @param now_us 現在時刻（us）
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logSample(uint16_t vbus_mV, int32_t current_mA, uint32_t now_us) {
+    uint32_t dt = 0U;
+    uint8_t *p = reserve(now_us, &dt);
+    if (p == NULL) {
+        return false;
+    }
+    if (dt < 0x80U) {
+        *p++ = (uint8_t)(0x80U | dt);
+    } else {
+        *p++ = LOG_SAMPLE;
+        p = putVar(p, dt);
+    }
+    p = putSigned(p, (int32_t)vbus_mV - (int32_t)_vbus_mV);
+    p = putSigned(p, (int32_t)((uint32_t)current_mA - (uint32_t)_current_mA));
+    _vbus_mV = vbus_mV;
+    _current_mA = current_mA;
+    commit(p);
+    return true;
+}
+
+/**
+ * @brief 電圧モードの変更を記録（時刻指定）
+ * @param mode 電圧モード（QC_VOLTAGE_MODE）
+ * @param now_us 現在時刻（us）
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logMode(uint8_t mode, uint32_t now_us) {
+    uint32_t dt = 0U;
+    uint8_t *p = reserve(now_us, &dt);
+    if (p == NULL) {
+        return false;
+    }
+    *p++ = LOG_MODE;
+    p = putVar(p, dt);
+    *p++ = mode;
+    _mode = mode;
+    commit(p);
+    return true;
+}
+
+/**
+ * @brief イベントマーカーを記録（時刻指定）
+ * @param code イベントコード（利用側で定義）
+ * @param value 値
+ * @param now_us 現在時刻（us）
+ * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+ */
+bool QC3Logger::logEvent(uint8_t code, int32_t value, uint32_t now_us) {
+    uint32_t dt = 0U;
+    uint8_t *p = reserve(now_us, &dt);
+    if (p == NULL) {
+        return false;
+    }
+    *p++ = LOG_EVENT;
+    p = putVar(p, dt);
+    *p++ = code;
+    p = putSigned(p, value);
+    commit(p);
+    return true;
+}
+
+/**
+ * @brief 書き込み待ちのブロックを書き込む
+ * @return 書き込み結果（true: 書き込んだ, false: 書き込み待ちなしまたは失敗）
+ * @note loop()等から定期的に呼び出すこと
+ */
+bool QC3Logger::poll() {
+    if (!_pending) {
+        return false;
+    }
+    if (!_sink(_pending_index, _buf[_cur ^ 1U], _sink_arg)) {
+        return false;
+    }
+    _pending = false;
+    _blocks++;
+    return true;
+}
+
+/**
+ * @brief 書き込み途中のブロックも含めて書き込む
+ * @return 書き込み結果（true: 成功）
+ * @note 書き込み途中のブロックは同じ位置に再度書き込まれるため、頻繁に呼び出さないこと
+ */
+bool QC3Logger::flush() {
+    if (!_active) {
+        return false;
+    }
+    if (_pending && !poll()) {
+        return false;
+    }
+    if (_used == 0U) {
+        return true;
+    }
+    finishHeader(_buf[_cur]);
+    return _sink(_index, _buf[_cur], _sink_arg);
+}
+
+/**
+ * @brief 記録中かどうか
+ * @return true: 記録中
+ */
+bool QC3Logger::isActive() {
+    return _active;
+}
+
+/**
+ * @brief バッファ満杯で記録できなかった件数
+ * @return 件数
+ */
+uint32_t QC3Logger::getDropped() {
+    return _dropped;
+}
+
+/**
+ * @brief 書き込んだブロック数（flush()による書き込み途中のブロックを除く）
+ * @return ブロック数
+ */
+uint32_t QC3Logger::getBlocksWritten() {
+    return _blocks;
+}
+
+/**
+ * @brief 記録したバイト数（ヘッダを除く）
+ * @return バイト数
+ */
+uint32_t QC3Logger::getBytesLogged() {
+    return _bytes;
+}
+
+/**
+ * @brief ブロックヘッダの読み取り
+ * @param block ブロック（BLOCK_SIZEバイト）
+ * @param info 読み取り先
+ * @return 読み取り結果（true: 有効なブロック, false: 未使用または破損）
+ */
+bool QC3Logger::readBlockInfo(const uint8_t *block, BlockInfo *info) {
+    if (!parseHeader(block, info)) {
+        return false;
+    }
+    return fletcher16(block + HEADER_SIZE, info->used) == getU16(block + 22);
+}
+
+/**
+ * @brief ブロックの復号
+ * @param block ブロック（BLOCK_SIZEバイト）
+ * @param cb 記録毎に呼び出す関数
+ * @param arg 関数に渡すユーザー引数
+ * @return 記録数（-1: 未使用または破損）
+ */
+int32_t QC3Logger::decodeBlock(const uint8_t *block, RecordCallback cb, void *arg) {
+    BlockInfo info;
+    if (!readBlockInfo(block, &info)) {
+        return -1;
+    }
+
+    const uint8_t *p = block + HEADER_SIZE;
+    const uint8_t *end = p + info.used;
+    uint32_t t = info.t0;
+    Record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.vbus_mV = info.vbus_mV;
+    rec.current_mA = info.current_mA;
+    rec.mode = info.mode;
+
+    int32_t count = 0;
+    while (p < end) {
+        const uint8_t tag = *p++;
+        uint32_t dt = 0U;
+        int32_t dv = 0;
+        int32_t di = 0;
+        if ((tag & 0x80U) != 0U) {
+            dt = tag & 0x7FU;
+            rec.type = LOG_SAMPLE;
+        } else {
+            p = getVar(p, end, &dt);
+            rec.type = tag;
+        }
+        if (p == NULL) {
+            return -1;
+        }
+        switch (rec.type) {
+            case LOG_SAMPLE:
+                p = getSigned(p, end, &dv);
+                p = (p != NULL) ? getSigned(p, end, &di) : NULL;
+                if (p != NULL) {
+                    rec.vbus_mV = (uint16_t)(rec.vbus_mV + dv);
+                    rec.current_mA = (int32_t)((uint32_t)rec.current_mA + (uint32_t)di);
+                }
+                break;
+            case LOG_MODE:
+                p = (p < end) ? p : NULL;
+                if (p != NULL) {
+                    rec.mode = *p++;
+                }
+                break;
+            case LOG_EVENT:
+                p = (p < end) ? p : NULL;
+                if (p != NULL) {
+                    rec.code = *p++;
+                    p = getSigned(p, end, &rec.value);
+                }
+                break;
+            default:
+                return -1;
+        }
+        if (p == NULL) {
+            return -1;
+        }
+        t += dt;
+        rec.t_us = (uint64_t)t * info.unit_us;
+        if (cb != NULL) {
+            cb(rec, arg);
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 記録の開始（共通処理）
+ * @param max_blocks リングのブロック数
+ * @param unit_us 時刻の単位（us）
+ * @param index 最初に書き込むブロック位置
+ * @param seq 最初のブロックの通し番号
+ * @param t 開始時刻（unit_us単位）
+ * @return 開始結果（true: 成功, false: 引数不正・書き込み先なし・メモリ不足）
+ */
+bool QC3Logger::start(uint16_t max_blocks, uint16_t unit_us, uint16_t index, uint32_t seq, uint32_t t) {
+    if (_active) {
+        (void)flush();
+        _active = false;
+    }
+    if ((max_blocks == 0U) || (unit_us == 0U) || (_sink == NULL)) {
+        return false;
+    }
+    for (uint8_t i = 0U; i < 2U; i++) {
+        if (_buf[i] == NULL) {
+            _buf[i] = (uint8_t *)malloc(BLOCK_SIZE);
+        }
+        if (_buf[i] == NULL) {
+            return false;
+        }
+    }
+
+    _cur = 0U;
+    _pending = false;
+    _max_blocks = max_blocks;
+    _index = (uint16_t)(index % max_blocks);
+    _seq = seq;
+    _unit_us = unit_us;
+    _has_time = false;
+    _rem_us = 0U;
+    _now = t;
+    _t = t;
+    _vbus_mV = 0U;
+    _current_mA = 0;
+    _mode = 0U;
+    _dropped = 0U;
+    _blocks = 0U;
+    _bytes = 0U;
+    openBlock();
+    _active = true;
+    return true;
+}
+
+/**
+ * @brief 書き込み中のブロックの初期化（前回の記録を基準値とする）
+ */
+void QC3Logger::openBlock() {
+    uint8_t *block = _buf[_cur];
+    memset(block, 0, BLOCK_SIZE);
+    putU16(block, MAGIC);
+    block[2] = VERSION;
+    block[3] = _mode;
+    putU32(block + 4, _seq);
+    putU32(block + 8, _t);
+    putU16(block + 12, _unit_us);
+    putU16(block + 14, _vbus_mV);
+    putU32(block + 16, (uint32_t)_current_mA);
+    _used = 0U;
+}
+
+/**
+ * @brief ブロックヘッダの記録部のバイト数とチェックサムの確定
+ * @param block ブロック
+ */
+void QC3Logger::finishHeader(uint8_t *block) {
+    putU16(block + 20, _used);
+    putU16(block + 22, fletcher16(block + HEADER_SIZE, _used));
+}
+
+/**
+ * @brief 1件分の記録領域の確保（ブロックが満杯なら書き込み待ちへ回す）
+ * @param now_us 現在時刻（us）
+ * @param dt 前回の記録からの経過時間（unit_us単位）
+ * @return 記録位置（NULL: 未開始またはバッファ満杯）
+ */
+uint8_t *QC3Logger::reserve(uint32_t now_us, uint32_t *dt) {
+    if (!_active) {
+        return NULL;
+    }
+    // micros()の一周（約71分）をまたいでも経過時間で進める
+    if (_has_time) {
+        _rem_us += now_us - _last_us;
+        _now += _rem_us / _unit_us;
+        _rem_us %= _unit_us;
+    }
+    _last_us = now_us;
+    _has_time = true;
+
+    if ((uint16_t)(BLOCK_SIZE - HEADER_SIZE - _used) < QC3_LOG_RECORD_MAX) {
+        if (_pending) {
+            _dropped++;
+            return NULL;
+        }
+        finishHeader(_buf[_cur]);
+        _pending = true;
+        _pending_index = _index;
+        _cur ^= 1U;
+        _index = (uint16_t)((_index + 1U) % _max_blocks);
+        _seq++;
+        openBlock();
+    }
+    *dt = _now - _t;
+    return _buf[_cur] + HEADER_SIZE + _used;
+}
+
+/**
+ * @brief 記録の確定
+ * @param end 記録の末尾
+ */
+void QC3Logger::commit(uint8_t *end) {
+    const uint16_t len = (uint16_t)(end - (_buf[_cur] + HEADER_SIZE + _used));
+    _used = (uint16_t)(_used + len);
+    _bytes += len;
+    _t = _now;
+}
+
+/**
+ * @brief ブロックヘッダの解析（チェックサムは確認しない）
+ * @param block ブロック（先頭HEADER_SIZEバイト以上）
+ * @param info 読み取り先
+ * @return 解析結果（true: 識別子・版数・記録部のサイズが正しい）
+ */
+bool QC3Logger::parseHeader(const uint8_t *block, BlockInfo *info) {
+    if ((getU16(block) != MAGIC) || (block[2] != VERSION)) {
+        return false;
+    }
+    info->mode = block[3];
+    info->seq = getU32(block + 4);
+    info->t0 = getU32(block + 8);
+    info->unit_us = getU16(block + 12);
+    info->vbus_mV = getU16(block + 14);
+    info->current_mA = (int32_t)getU32(block + 16);
+    info->used = getU16(block + 20);
+    return (info->unit_us != 0U) && (info->used <= (uint16_t)(BLOCK_SIZE - HEADER_SIZE));
+}
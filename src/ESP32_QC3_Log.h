@@ -0,0 +1,274 @@
+/**
+ * @file ESP32_QC3_Log.h
+ * @brief 電力ログ（VBUS・電流・電圧モード・イベント）のバイナリ記録
+ *
+ * 記録はQC3_LOG_BLOCK_SIZE単位のブロックにまとめ、前回値との差分を
+ * 可変長整数で格納します（1kHzのサンプルで1件あたり約3バイト）。
+ * ブロックは先頭に基準値を持つため、単独で復号できます。
+ * 書き込み中のブロックと書き込み待ちのブロックの2面を持ち、記録側は
+ * フラッシュへ書き込みません。書き込みはpoll()で行います。
+ * ESP32ではLittleFS/SPIFFS上のファイルをmax_blocks個のブロックのリングとして
+ * 使用し、一周すると古いブロックから上書きします。
+ * 復号はextras/tools/qc3log2csv.cppでCSVへ変換できます。
+ */
+
+#ifndef ESP32_QC3_LOG_H
+#define ESP32_QC3_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #include <FS.h>
+#endif
+
+#ifndef QC3_LOG_BLOCK_SIZE
+ #define QC3_LOG_BLOCK_SIZE 4096  ///< ブロックサイズ（バイト、フラッシュの消去単位に合わせる）
+#endif
+
+/**
+ * @brief 電力ログのバイナリ記録
+ * @note log*()とpoll()/flush()は同じタスクから呼び出すこと
+ */
+class QC3Logger {
+public:
+    static const uint16_t BLOCK_SIZE = QC3_LOG_BLOCK_SIZE;  ///< ブロックサイズ（バイト）
+    static const uint16_t HEADER_SIZE = 24;                 ///< ブロックヘッダのサイズ（バイト）
+    static const uint16_t MAGIC = 0x4C51U;                  ///< ブロックの識別子
+    static const uint8_t VERSION = 1U;                      ///< 形式の版数
+    static const uint8_t EVENT_RESTART = 0xFFU;             ///< 既存のファイルへ続けて記録を開始したイベント
+
+    /**
+     * @brief 記録の種類
+     */
+    enum LOG_RECORD {
+        LOG_SAMPLE = 0x01,  ///< VBUS/電流のサンプル
+        LOG_MODE = 0x02,    ///< 電圧モードの変更
+        LOG_EVENT = 0x03    ///< イベントマーカー
+    };
+
+    /**
+     * @brief ブロックヘッダ
+     */
+    struct BlockInfo {
+        uint32_t seq;         ///< 通し番号
+        uint32_t t0;          ///< 基準時刻（unit_us単位）
+        uint16_t unit_us;     ///< 時刻の単位（us）
+        uint16_t vbus_mV;     ///< 基準VBUS（mV）
+        int32_t current_mA;   ///< 基準電流（mA）
+        uint8_t mode;         ///< 基準の電圧モード
+        uint16_t used;        ///< 記録部のバイト数
+    };
+
+    /**
+     * @brief 復号した記録
+     */
+    struct Record {
+        uint8_t type;         ///< 種類（LOG_RECORD）
+        uint8_t mode;         ///< 電圧モード（記録時点）
+        uint8_t code;         ///< イベントコード（LOG_EVENT）
+        uint16_t vbus_mV;     ///< VBUS（mV、記録時点）
+        int32_t current_mA;   ///< 電流（mA、記録時点）
+        int32_t value;        ///< イベントの値（LOG_EVENT）
+        uint64_t t_us;        ///< 時刻（us、開始時点を0とする）
+    };
+
+    /**
+     * @brief ブロックの書き込み先
+     * @param index リング上のブロック位置（0からmax_blocks-1）
+     * @param block ブロック（BLOCK_SIZEバイト）
+     * @param arg setBlockSink()で渡したユーザー引数
+     * @return 書き込み結果（true: 成功）
+     */
+    typedef bool (*BlockSink)(uint16_t index, const uint8_t *block, void *arg);
+
+    /**
+     * @brief 復号した記録の通知
+     * @param rec 記録
+     * @param arg decodeBlock()で渡したユーザー引数
+     */
+    typedef void (*RecordCallback)(const Record &rec, void *arg);
+
+    QC3Logger();
+    ~QC3Logger();
+
+    /**
+     * @brief 書き込み先の登録（ファイル以外へ書き込む場合）
+     * @param sink 書き込み関数
+     * @param arg 書き込み関数に渡すユーザー引数
+     */
+    void setBlockSink(BlockSink sink, void *arg = NULL);
+
+    /**
+     * @brief 記録の開始（setBlockSink()の書き込み先へ記録）
+     * @param max_blocks リングのブロック数
+     * @param unit_us 時刻の単位（us、既定1ms）
+     * @return 開始結果（true: 成功, false: 引数不正または書き込み先なし）
+     */
+    bool begin(uint16_t max_blocks, uint16_t unit_us = 1000);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    /**
+     * @brief 記録の開始（ファイルへ記録）
+     * @param fs ファイルシステム（LittleFS, SPIFFS等、begin()済みのもの）
+     * @param path ファイルのパス
+     * @param max_blocks リングのブロック数（ファイルサイズ = max_blocks * BLOCK_SIZE）
+     * @param unit_us 時刻の単位（us、既定1ms）
+     * @return 開始結果（true: 成功, false: 引数不正またはファイルを開けない）
+     * @note 既存のファイルがあれば最新のブロックの次から続けて記録する
+     */
+    bool begin(fs::FS &fs, const char *path, uint16_t max_blocks, uint16_t unit_us = 1000);
+#endif
+
+    /**
+     * @brief 記録の終了（書き込み途中のブロックも書き込む）
+     */
+    void end();
+
+#if defined(ARDUINO)
+    /**
+     * @brief VBUS/電流のサンプルを記録
+     * @param vbus_mV VBUS（mV）
+     * @param current_mA 電流（mA）
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logSample(uint16_t vbus_mV, int32_t current_mA);
+
+    /**
+     * @brief 電圧モードの変更を記録
+     * @param mode 電圧モード（QC_VOLTAGE_MODE）
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logMode(uint8_t mode);
+
+    /**
+     * @brief イベントマーカーを記録
+     * @param code イベントコード（利用側で定義）
+     * @param value 値
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logEvent(uint8_t code, int32_t value = 0);
+#endif
+
+    /**
+     * @brief VBUS/電流のサンプルを記録（時刻指定）
+     * @param vbus_mV VBUS（mV）
+     * @param current_mA 電流（mA）
+     * @param now_us 現在時刻（us）
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logSample(uint16_t vbus_mV, int32_t current_mA, uint32_t now_us);
+
+    /**
+     * @brief 電圧モードの変更を記録（時刻指定）
+     * @param mode 電圧モード（QC_VOLTAGE_MODE）
+     * @param now_us 現在時刻（us）
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logMode(uint8_t mode, uint32_t now_us);
+
+    /**
+     * @brief イベントマーカーを記録（時刻指定）
+     * @param code イベントコード（利用側で定義）
+     * @param value 値
+     * @param now_us 現在時刻（us）
+     * @return 記録結果（true: 成功, false: 未開始またはバッファ満杯）
+     */
+    bool logEvent(uint8_t code, int32_t value, uint32_t now_us);
+
+    /**
+     * @brief 書き込み待ちのブロックを書き込む
+     * @return 書き込み結果（true: 書き込んだ, false: 書き込み待ちなしまたは失敗）
+     * @note loop()等から定期的に呼び出すこと
+     */
+    bool poll();
+
+    /**
+     * @brief 書き込み途中のブロックも含めて書き込む
+     * @return 書き込み結果（true: 成功）
+     * @note 書き込み途中のブロックは同じ位置に再度書き込まれるため、頻繁に呼び出さないこと
+     */
+    bool flush();
+
+    /**
+     * @brief 記録中かどうか
+     * @return true: 記録中
+     */
+    bool isActive();
+
+    /**
+     * @brief バッファ満杯で記録できなかった件数
+     * @return 件数
+     */
+    uint32_t getDropped();
+
+    /**
+     * @brief 書き込んだブロック数（flush()による書き込み途中のブロックを除く）
+     * @return ブロック数
+     */
+    uint32_t getBlocksWritten();
+
+    /**
+     * @brief 記録したバイト数（ヘッダを除く）
+     * @return バイト数
+     */
+    uint32_t getBytesLogged();
+
+    /**
+     * @brief ブロックヘッダの読み取り
+     * @param block ブロック（BLOCK_SIZEバイト）
+     * @param info 読み取り先
+     * @return 読み取り結果（true: 有効なブロック, false: 未使用または破損）
+     */
+    static bool readBlockInfo(const uint8_t *block, BlockInfo *info);
+
+    /**
+     * @brief ブロックの復号
+     * @param block ブロック（BLOCK_SIZEバイト）
+     * @param cb 記録毎に呼び出す関数
+     * @param arg 関数に渡すユーザー引数
+     * @return 記録数（-1: 未使用または破損）
+     */
+    static int32_t decodeBlock(const uint8_t *block, RecordCallback cb, void *arg = NULL);
+
+private:
+    uint8_t *_buf[2];        ///< ブロックバッファ（書き込み中・書き込み待ち）
+    uint8_t _cur;            ///< 書き込み中のバッファ
+    bool _pending;           ///< 書き込み待ちのブロックあり
+    uint16_t _pending_index; ///< 書き込み待ちのブロック位置
+    uint16_t _used;          ///< 書き込み中のブロックの記録部のバイト数
+    uint16_t _index;         ///< 書き込み中のブロック位置
+    uint16_t _max_blocks;    ///< リングのブロック数
+    uint32_t _seq;           ///< 書き込み中のブロックの通し番号
+    uint16_t _unit_us;       ///< 時刻の単位（us）
+    bool _active;            ///< 記録中フラグ
+    bool _has_time;          ///< 時刻の基準あり
+
+    uint32_t _last_us;       ///< 前回の記録時刻（us、micros()の値）
+    uint32_t _rem_us;        ///< 単位未満の端数（us）
+    uint32_t _now;           ///< 現在時刻（unit_us単位、開始時点を0とする）
+    uint32_t _t;             ///< 前回の記録時刻（unit_us単位）
+    uint16_t _vbus_mV;       ///< 前回のVBUS（mV）
+    int32_t _current_mA;     ///< 前回の電流（mA）
+    uint8_t _mode;           ///< 現在の電圧モード
+
+    uint32_t _dropped;       ///< 記録できなかった件数
+    uint32_t _blocks;        ///< 書き込んだブロック数
+    uint32_t _bytes;         ///< 記録したバイト数
+
+    BlockSink _sink;         ///< 書き込み先
+    void *_sink_arg;         ///< 書き込み先のユーザー引数
+#if defined(ARDUINO_ARCH_ESP32)
+    fs::File _file;          ///< 記録先ファイル
+    static bool fileSink(uint16_t index, const uint8_t *block, void *arg);
+#endif
+
+    bool start(uint16_t max_blocks, uint16_t unit_us, uint16_t index, uint32_t seq, uint32_t t);
+    void openBlock();
+    void finishHeader(uint8_t *block);
+    uint8_t *reserve(uint32_t now_us, uint32_t *dt);
+    void commit(uint8_t *end);
+    static bool parseHeader(const uint8_t *block, BlockInfo *info);
+};
+
+#endif // ESP32_QC3_LOG_H
@@ -0,0 +1,192 @@
+/**
+ * @file ESP32_QC3_MultiPort.cpp
+ * @brief 複数ポートのQC3制御マネージャの実装
+ */
+
+#include "ESP32_QC3_MultiPort.h"
+
+QC3MultiPort::QC3MultiPort() {
+    for (uint8_t i = 0U; i < QC3_MAX_PORTS; i++) {
+        _ports[i] = NULL;
+        _ctx[i].self = this;
+        _ctx[i].port = i;
+        _vbus_mV[i] = 0U;
+    }
+    _port_count = 0U;
+    _detect_cb = NULL;
+    _detect_cb_arg = NULL;
+}
+
+/**
+ * @brief ポートの追加
+ * @param ctl 制御インスタンス
+ * @return ポート番号（-1: 上限超過）
+ */
+int8_t QC3MultiPort::addPort(ESP32_QC3_CTL *ctl) {
+    if ((ctl == NULL) || (_port_count >= QC3_MAX_PORTS)) {
+        return -1;
+    }
+    const uint8_t port = _port_count;
+    _ports[port] = ctl;
+    ctl->setDetectCallback(&QC3MultiPort::onPortDetect, &_ctx[port]);
+    _port_count++;
+    return (int8_t)port;
+}
+
+/**
+ * @brief 登録済みのポート数
+ * @return ポート数
+ */
+uint8_t QC3MultiPort::getPortCount() {
+    return _port_count;
+}
+
+/**
+ * @brief ポートの制御インスタンスを取得
+ * @param port ポート番号
+ * @return 制御インスタンス（範囲外はNULL）
+ */
+ESP32_QC3_CTL *QC3MultiPort::getPort(uint8_t port) {
+    return (port < _port_count) ? _ports[port] : NULL;
+}
+
+/**
+ * @brief 全ポートの初期化
+ * @return 初期化結果（true: 全ポート成功）
+ */
+bool QC3MultiPort::begin() {
+    bool ok = true;
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        if (!_ports[i]->begin()) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief 全ポートの検出を同時に開始
+ */
+void QC3MultiPort::startDetect() {
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        _ports[i]->startDetect();
+    }
+}
+
+/**
+ * @brief 検出中のポートがあるかどうか
+ * @return true: 検出中のポートあり
+ */
+bool QC3MultiPort::isDetecting() {
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        if (_ports[i]->isDetecting()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 全ポートの検出（ブロッキング）
+ * @return QC3を検出したポート数
+ */
+uint8_t QC3MultiPort::detectAll() {
+    startDetect();
+    while (isDetecting()) {
+        update();
+        // 各ポートの時刻源を1msずつ進める（シミュレーション時は全ポート分）
+        for (uint8_t i = 0U; i < _port_count; i++) {
+            QC3Hal *hal = _ports[i]->getHal();
+            bool shared = false;
+            for (uint8_t j = 0U; j < i; j++) {
+                if (_ports[j]->getHal() == hal) {
+                    shared = true;
+                    break;
+                }
+            }
+            if (!shared) {
+                hal->delay(1);
+            }
+        }
+    }
+
+    uint8_t n = 0U;
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        if (_ports[i]->getHostType() == ESP32_QC3_CTL::QC3) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief 全ポートの処理を1回ずつ進め、VBUSをまとめて読み取る
+ */
+void QC3MultiPort::update() {
+    // プロトコル処理（D+/D-操作）を先に全ポート分行う
+    // 順序はESP32_QC3_CTL::update()と同じ（保護・抜き差し監視・検出・パルス出力・定電圧制御・保存）
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        ESP32_QC3_CTL *ctl = _ports[i];
+        QC3Hal *hal = ctl->getHal();
+        const uint32_t now_ms = hal->millis();
+        (void)ctl->pollProtection(hal->micros());
+        (void)ctl->pollHotplug(now_ms);
+        if (ctl->isDetecting()) {
+            (void)ctl->pollDetect(now_ms);
+        }
+        (void)ctl->pollVar(hal->micros());
+        (void)ctl->pollRegulation(now_ms);
+        (void)ctl->pollAdcStream();
+        (void)ctl->pollSave(now_ms);
+    }
+
+    // VBUSの読み取りはパルス出力と交互にならないよう最後にまとめて行う
+    for (uint8_t i = 0U; i < _port_count; i++) {
+        _vbus_mV[i] = _ports[i]->readVbusMillivolts();
+    }
+}
+
+/**
+ * @brief ポートの状態を取得
+ * @param port ポート番号
+ * @param state 取得先
+ * @return 取得結果（true: 成功, false: 範囲外）
+ */
+bool QC3MultiPort::getPortState(uint8_t port, PortState *state) {
+    if ((port >= _port_count) || (state == NULL)) {
+        return false;
+    }
+    ESP32_QC3_CTL *ctl = _ports[port];
+    state->host_type = ctl->getHostType();
+    state->detect_state = ctl->getDetectState();
+    state->qc_mode = ctl->getMode();
+    state->reg_state = ctl->getRegulationState();
+    state->class_b = ctl->getUseClassB();
+    state->var_busy = ctl->isVarBusy();
+    state->voltage = ctl->getVoltage();
+    state->var_target = ctl->getVarTarget();
+    state->vbus_mV = _vbus_mV[port];
+    return true;
+}
+
+/**
+ * @brief 検出完了コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void QC3MultiPort::setDetectCallback(PortDetectCallback cb, void *arg) {
+    _detect_cb = cb;
+    _detect_cb_arg = arg;
+}
+
+/**
+ * @brief 各ポートの検出完了通知
+ * @param host_type 検出結果（BC_NA, BC_DCP, QC3）
+ * @param arg PortContext
+ */
+void QC3MultiPort::onPortDetect(uint8_t host_type, void *arg) {
+    PortContext *ctx = (PortContext *)arg;
+    if (ctx->self->_detect_cb != NULL) {
+        ctx->self->_detect_cb(ctx->port, host_type, ctx->self->_detect_cb_arg);
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file ESP32_QC3_MultiPort.h
+ * @brief 複数のESP32_QC3_CTLをまとめて制御するマネージャ
+ *
+ * 各ポートの検出・可変モードのパルス出力・定電圧制御・出力保護・抜き差し監視・
+ * 状態の自動保存を1つのupdate()で並行して進めます。検出は全ポート同時に開始するため、ポート数に関わらず
+ * 1ポート分の時間（約1.6秒）で完了します。VBUSの読み取りはプロトコル処理の後に
+ * 全ポート分をまとめて行い、getPortState()はその結果を返します。
+ */
+
+#ifndef ESP32_QC3_MULTIPORT_H
+#define ESP32_QC3_MULTIPORT_H
+
+#include "ESP32_QC3_CTL.h"
+
+#ifndef QC3_MAX_PORTS
+ #define QC3_MAX_PORTS 4  ///< 管理できるポート数
+#endif
+
+/**
+ * @brief 複数ポートのQC3制御マネージャ
+ */
+class QC3MultiPort {
+public:
+    /**
+     * @brief ポートの状態
+     */
+    struct PortState {
+        uint8_t host_type;     ///< ホストタイプ（HOST_PORT_TYPE）
+        uint8_t detect_state;  ///< 検出の進行状態（DETECT_STATE）
+        uint8_t qc_mode;       ///< 電圧モード（QC_VOLTAGE_MODE）
+        uint8_t reg_state;     ///< 定電圧制御の状態（REG_STATE）
+        bool class_b;          ///< Class B使用フラグ
+        bool var_busy;         ///< 可変モードのパルス出力中
+        uint16_t voltage;      ///< 設定電圧（mV）
+        uint16_t var_target;   ///< 可変モードの目標電圧（mV）
+        uint16_t vbus_mV;      ///< VBUS実測値（mV、最後のupdate()時点）
+    };
+
+    /**
+     * @brief ポート毎の検出完了コールバック
+     * @param port ポート番号
+     * @param host_type 検出結果（BC_NA, BC_DCP, QC3）
+     * @param arg setDetectCallback()で指定したユーザー引数
+     */
+    typedef void (*PortDetectCallback)(uint8_t port, uint8_t host_type, void *arg);
+
+    QC3MultiPort();
+
+    /**
+     * @brief ポートの追加
+     * @param ctl 制御インスタンス
+     * @return ポート番号（-1: 上限超過）
+     * @note 各インスタンスの検出完了コールバックはマネージャが使用する
+     */
+    int8_t addPort(ESP32_QC3_CTL *ctl);
+
+    /**
+     * @brief 登録済みのポート数
+     * @return ポート数
+     */
+    uint8_t getPortCount();
+
+    /**
+     * @brief ポートの制御インスタンスを取得
+     * @param port ポート番号
+     * @return 制御インスタンス（範囲外はNULL）
+     */
+    ESP32_QC3_CTL *getPort(uint8_t port);
+
+    /**
+     * @brief 全ポートの初期化
+     * @return 初期化結果（true: 全ポート成功）
+     */
+    bool begin();
+
+    /**
+     * @brief 全ポートの検出を同時に開始
+     */
+    void startDetect();
+
+    /**
+     * @brief 検出中のポートがあるかどうか
+     * @return true: 検出中のポートあり
+     */
+    bool isDetecting();
+
+    /**
+     * @brief 全ポートの検出（ブロッキング）
+     * @return QC3を検出したポート数
+     */
+    uint8_t detectAll();
+
+    /**
+     * @brief 全ポートの処理を1回ずつ進め、VBUSをまとめて読み取る
+     * @note loop()等から定期的に呼び出す。各ポートのupdate()の代わりに使い、
+     *       pollProtection()・pollHotplug()・pollSave()もポート毎に呼び出す
+     *       （コマンドキューとgetSnapshot()は制御タスク用のため扱わない）
+     */
+    void update();
+
+    /**
+     * @brief ポートの状態を取得
+     * @param port ポート番号
+     * @param state 取得先
+     * @return 取得結果（true: 成功, false: 範囲外）
+     */
+    bool getPortState(uint8_t port, PortState *state);
+
+    /**
+     * @brief 検出完了コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setDetectCallback(PortDetectCallback cb, void *arg = NULL);
+
+private:
+    /**
+     * @brief 検出完了コールバックへ渡すポート情報
+     */
+    struct PortContext {
+        QC3MultiPort *self;
+        uint8_t port;
+    };
+
+    ESP32_QC3_CTL *_ports[QC3_MAX_PORTS];  ///< 制御インスタンス
+    PortContext _ctx[QC3_MAX_PORTS];       ///< コールバック用のポート情報
+    uint16_t _vbus_mV[QC3_MAX_PORTS];      ///< VBUS実測値（mV）
+    uint8_t _port_count;                   ///< 登録済みのポート数
+
+    PortDetectCallback _detect_cb;         ///< 検出完了コールバック
+    void *_detect_cb_arg;                  ///< 検出完了コールバックのユーザー引数
+
+    static void onPortDetect(uint8_t host_type, void *arg);
+};
+
+#endif // ESP32_QC3_MULTIPORT_H
@@ -0,0 +1,148 @@
+/**
+ * @file ESP32_QC3_Pins.h
+ * @brief GPIO/ADCピンの属性（constexpr）とGPIOレジスタ直接書き込み
+ *
+ * ピン番号からGPIOレジスタのビットマスクやADCユニットをconstexprで求めます。
+ * QC3Controllerはこれらをstatic_assertでのピン検証に使用し、
+ * ESP32_QC3_CTLはPIN_BACKEND_BUNDLEのマスク計算に使用します。
+ */
+
+#ifndef ESP32_QC3_PINS_H
+#define ESP32_QC3_PINS_H
+
+#include <stdint.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #include <soc/soc_caps.h>
+ #include <soc/gpio_reg.h>
+ #include <soc/soc.h>
+#endif
+
+#if defined(SOC_GPIO_PIN_COUNT)
+ #define QC3_GPIO_PIN_COUNT SOC_GPIO_PIN_COUNT
+#else
+ #define QC3_GPIO_PIN_COUNT 64  ///< ターゲット不明時のGPIO数
+#endif
+
+/**
+ * @brief ADCユニット
+ */
+enum QC3_ADC_UNIT {
+    QC3_ADC_NONE = 0x00,     ///< ADC非対応ピン
+    QC3_ADC_UNIT1 = 0x01,    ///< ADC1
+    QC3_ADC_UNIT2 = 0x02,    ///< ADC2（ESP32ではWiFi使用中に読めない）
+    QC3_ADC_UNKNOWN = 0xFF   ///< ターゲット不明（検証しない）
+};
+
+/**
+ * @brief GPIO番号が範囲内かどうか
+ * @param pin ピン番号
+ * @return true: 有効
+ */
+constexpr bool qc3IsValidPin(uint8_t pin) {
+    return pin < QC3_GPIO_PIN_COUNT;
+}
+
+/**
+ * @brief 出力可能なピンかどうか
+ * @param pin ピン番号
+ * @return true: 出力可能
+ */
+constexpr bool qc3IsOutputPin(uint8_t pin) {
+#if defined(CONFIG_IDF_TARGET_ESP32)
+    // GPIO34-39は入力専用
+    return qc3IsValidPin(pin) && !((pin >= 34U) && (pin <= 39U));
+#else
+    return qc3IsValidPin(pin);
+#endif
+}
+
+/**
+ * @brief ピンのADCユニット
+ * @param pin ピン番号
+ * @return ADCユニット（QC3_ADC_UNIT）
+ */
+constexpr uint8_t qc3AdcUnit(uint8_t pin) {
+#if defined(CONFIG_IDF_TARGET_ESP32)
+    return ((pin >= 32U) && (pin <= 39U)) ? QC3_ADC_UNIT1 :
+        ((pin == 0U) || (pin == 2U) || (pin == 4U) ||
+         ((pin >= 12U) && (pin <= 15U)) || ((pin >= 25U) && (pin <= 27U))) ? QC3_ADC_UNIT2 :
+        QC3_ADC_NONE;
+#elif defined(CONFIG_IDF_TARGET_ESP32S2) || defined(CONFIG_IDF_TARGET_ESP32S3)
+    return ((pin >= 1U) && (pin <= 10U)) ? QC3_ADC_UNIT1 :
+        ((pin >= 11U) && (pin <= 20U)) ? QC3_ADC_UNIT2 :
+        QC3_ADC_NONE;
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+    return (pin <= 4U) ? QC3_ADC_UNIT1 : (pin == 5U) ? QC3_ADC_UNIT2 : QC3_ADC_NONE;
+#elif defined(CONFIG_IDF_TARGET_ESP32C6)
+    return (pin <= 6U) ? QC3_ADC_UNIT1 : QC3_ADC_NONE;
+#elif defined(CONFIG_IDF_TARGET_ESP32H2)
+    return ((pin >= 1U) && (pin <= 5U)) ? QC3_ADC_UNIT1 : QC3_ADC_NONE;
+#else
+    return (void)pin, QC3_ADC_UNKNOWN;
+#endif
+}
+
+/**
+ * @brief ADCとして読めるピンかどうか
+ * @param pin ピン番号
+ * @param adc1_only true: ADC1のみ許可
+ * @return true: 使用可能（ターゲット不明時は常にtrue）
+ */
+constexpr bool qc3IsAdcPin(uint8_t pin, bool adc1_only) {
+    return (qc3AdcUnit(pin) == QC3_ADC_UNKNOWN) ||
+        (qc3AdcUnit(pin) == QC3_ADC_UNIT1) ||
+        (!adc1_only && (qc3AdcUnit(pin) == QC3_ADC_UNIT2));
+}
+
+/**
+ * @brief GPIOレジスタのビットマスク
+ * @param pin ピン番号
+ * @param bank バンク（0: GPIO0-31, 1: GPIO32-）
+ * @return ビットマスク（別バンクのピンは0）
+ */
+constexpr uint32_t qc3PinMask(uint8_t pin, uint8_t bank) {
+    return ((pin >> 5) == bank) ? (1UL << (pin & 31U)) : 0UL;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * @brief GPIO出力レジスタへの書き込み
+ * @param mask0 GPIO0-31のビットマスク
+ * @param mask1 GPIO32-のビットマスク
+ * @param high true: W1TS, false: W1TC
+ */
+static inline void qc3GpioWriteOut(uint32_t mask0, uint32_t mask1, bool high) {
+    if (mask0 != 0U) {
+        REG_WRITE(high ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, mask0);
+    }
+ #if (SOC_GPIO_PIN_COUNT > 32)
+    if (mask1 != 0U) {
+        REG_WRITE(high ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, mask1);
+    }
+ #else
+    (void)mask1;
+ #endif
+}
+
+/**
+ * @brief GPIO出力有効レジスタへの書き込み
+ * @param mask0 GPIO0-31のビットマスク
+ * @param mask1 GPIO32-のビットマスク
+ * @param enable true: 出力有効, false: ハイインピーダンス
+ */
+static inline void qc3GpioWriteEnable(uint32_t mask0, uint32_t mask1, bool enable) {
+    if (mask0 != 0U) {
+        REG_WRITE(enable ? GPIO_ENABLE_W1TS_REG : GPIO_ENABLE_W1TC_REG, mask0);
+    }
+ #if (SOC_GPIO_PIN_COUNT > 32)
+    if (mask1 != 0U) {
+        REG_WRITE(enable ? GPIO_ENABLE1_W1TS_REG : GPIO_ENABLE1_W1TC_REG, mask1);
+    }
+ #else
+    (void)mask1;
+ #endif
+}
+#endif
+
+#endif // ESP32_QC3_PINS_H
@@ -0,0 +1,303 @@
+/**
+ * @file ESP32_QC3_Protection.cpp
+ * @brief ESP32_QC3_CTLの過電圧・低電圧・過電流保護
+ *
+ * 出力ON中にVBUS/電流をしきい値と比較し、しきい値を連続して超えたら
+ * 出力有効ピンをLOWにしてフォルトをラッチします。ESP32ではesp_timerの周期タスク
+ * （優先度はloop()や制御タスクより高い）で判定するため、遮断までの遅れは
+ * 制御周期に依存しません。連続ADCサンプリング中は間引き窓の最小・最大値で判定し、
+ * 窓内の短いスパイクも取りこぼしません。窓を更新する制御タスクより優先度が高いため、
+ * 更新中の窓は待たずに前回の窓で判定します。
+ * 遮断の通知（トレース・コールバック）はpollProtection()（update()）で行います。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #define QC3_PROT_LOCK()   portENTER_CRITICAL(&_prot_mux)
+ #define QC3_PROT_UNLOCK() portEXIT_CRITICAL(&_prot_mux)
+#else
+ #define QC3_PROT_LOCK()
+ #define QC3_PROT_UNLOCK()
+#endif
+
+static const uint32_t QC3_PROT_MIN_PERIOD_US = 50U;  ///< esp_timerの最小周期（us）
+
+/**
+ * @brief しきい値を連続して超えたサンプル数の更新
+ * @param count サンプル数
+ * @param over 今回しきい値を超えた
+ * @param limit 遮断するサンプル数
+ * @return true: 遮断する
+ */
+static bool countOver(uint8_t *count, bool over, uint8_t limit) {
+    if (!over) {
+        *count = 0U;
+        return false;
+    }
+    if (*count < limit) {
+        (*count)++;
+    }
+    return *count >= limit;
+}
+
+/**
+ * @brief 保護機能（過電圧・低電圧・過電流）の開始
+ * @param limits しきい値
+ * @param period_us サンプリング周期（us）
+ * @return 開始結果（true: 成功, false: 出力有効ピン未設定またはタイマー作成失敗）
+ */
+bool ESP32_QC3_CTL::startProtection(const ProtectionLimits &limits, uint32_t period_us) {
+    if (_out_en == 0U) {
+        return false;
+    }
+    stopProtection();
+    _prot_limits = limits;
+    if (_prot_limits.trip_count == 0U) {
+        _prot_limits.trip_count = 1U;
+    }
+    memset(_prot_over, 0, sizeof(_prot_over));
+    memset(_prot_win_valid, 0, sizeof(_prot_win_valid));
+    _prot_miss = 0U;
+    // ADC変換テーブルは判定タイマーの起動前に作成しておく
+    (void)readMillivolts(_vbus_det, 0U);
+    if (_cur_sense != 0U) {
+        (void)readMillivolts(_cur_sense, 0U);
+    }
+
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_prot_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = &ESP32_QC3_CTL::protTimerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "qc3_prot";
+        if (esp_timer_create(&args, &_prot_timer) != ESP_OK) {
+            _prot_timer = NULL;
+            return false;
+        }
+    }
+    _prot_enabled = true;
+    const uint32_t period = (period_us > QC3_PROT_MIN_PERIOD_US) ? period_us : QC3_PROT_MIN_PERIOD_US;
+    if (esp_timer_start_periodic(_prot_timer, period) != ESP_OK) {
+        _prot_enabled = false;
+        return false;
+    }
+#else
+    (void)period_us;
+    _prot_enabled = true;
+#endif
+    return true;
+}
+
+/**
+ * @brief 保護機能の停止（ラッチ中のフォルトは保持）
+ */
+void ESP32_QC3_CTL::stopProtection() {
+    _prot_enabled = false;
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_prot_timer != NULL) {
+        (void)esp_timer_stop(_prot_timer);
+    }
+#endif
+}
+
+/**
+ * @brief 遮断の通知処理
+ * @return フォルトコード（FAULT_CODE）
+ */
+uint8_t ESP32_QC3_CTL::pollProtection() {
+    return pollProtection(_hal->micros());
+}
+
+/**
+ * @brief 遮断の通知処理（時刻指定）
+ * @param now_us 現在時刻（us）
+ * @return フォルトコード（FAULT_CODE）
+ */
+uint8_t ESP32_QC3_CTL::pollProtection(uint32_t now_us) {
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_prot_timer == NULL) {
+        checkProtection(now_us);
+    }
+#else
+    checkProtection(now_us);
+#endif
+
+    FaultInfo fault;
+    bool report = false;
+    QC3_PROT_LOCK();
+    if ((_fault_code != FAULT_NONE) && !_fault_reported) {
+        _fault_reported = true;
+        fault = _fault_info;
+        report = true;
+    }
+    QC3_PROT_UNLOCK();
+    if (report) {
+        QC3_TRACE(TRACE_FAULT, fault.code, now_us - fault.timestamp_us);
+        markStateDirty();
+        if (_fault_cb != NULL) {
+            _fault_cb(fault, _fault_cb_arg);
+        }
+    }
+    return _fault_code;
+}
+
+/**
+ * @brief ラッチ中のフォルトコードの取得
+ * @return フォルトコード（FAULT_CODE）
+ */
+uint8_t ESP32_QC3_CTL::getFault() {
+    return _fault_code;
+}
+
+/**
+ * @brief 遮断の記録の取得
+ * @param fault 取得先
+ * @return 取得結果（true: フォルトをラッチ中, false: フォルトなし）
+ */
+bool ESP32_QC3_CTL::getFaultInfo(FaultInfo *fault) {
+    QC3_PROT_LOCK();
+    const bool latched = (_fault_code != FAULT_NONE);
+    *fault = _fault_info;
+    QC3_PROT_UNLOCK();
+    return latched;
+}
+
+/**
+ * @brief フォルトの解除
+ */
+void ESP32_QC3_CTL::clearFault() {
+    QC3_PROT_LOCK();
+    _fault_code = FAULT_NONE;
+    _fault_reported = true;
+    memset(_prot_over, 0, sizeof(_prot_over));
+    QC3_PROT_UNLOCK();
+}
+
+/**
+ * @brief 遮断通知コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void ESP32_QC3_CTL::setFaultCallback(FaultCallback cb, void *arg) {
+    _fault_cb = cb;
+    _fault_cb_arg = arg;
+}
+
+/**
+ * @brief VBUS/電流の判定と遮断
+ * @param now_us 現在時刻（us）
+ * @note ESP32ではesp_timerタスクから呼び出される
+ */
+void ESP32_QC3_CTL::checkProtection(uint32_t now_us) {
+    if (!_prot_enabled || !_is_on || (_fault_code != FAULT_NONE)) {
+        memset(_prot_over, 0, sizeof(_prot_over));
+        return;
+    }
+
+    const ProtectionLimits &lim = _prot_limits;
+    uint16_t lo;
+    uint16_t hi;
+    readProtectionPin(0U, _vbus_det, &lo, &hi);
+    const uint16_t vbus_lo = convertVbusMillivolts(lo);
+    const uint16_t vbus_hi = convertVbusMillivolts(hi);
+    int32_t current = 0;
+    if ((_cur_sense != 0U) && (lim.ocp_mA != 0)) {
+        readProtectionPin(1U, _cur_sense, &lo, &hi);
+        // センサの向き（係数の符号）によって最大電流は最小・最大のどちらにもなる
+        const int32_t a = convertCurrentMilliamps(lo);
+        const int32_t b = convertCurrentMilliamps(hi);
+        current = (a > b) ? a : b;
+    }
+
+    const bool ovp = countOver(&_prot_over[0], (lim.ovp_mV != 0U) && (vbus_hi > lim.ovp_mV), lim.trip_count);
+    const bool uvp = countOver(&_prot_over[1], (lim.uvp_mV != 0U) && (vbus_lo < lim.uvp_mV), lim.trip_count);
+    const bool ocp = countOver(&_prot_over[2], (lim.ocp_mA != 0) && (current > lim.ocp_mA), lim.trip_count);
+    if (!ovp && !uvp && !ocp) {
+        return;
+    }
+
+    QC3_PROT_LOCK();
+    if (_fault_code == FAULT_NONE) {
+        _hal->digitalWrite(_out_en, LOW);
+        _is_on = false;
+        _fault_info.code = ovp ? FAULT_OVP : (uvp ? FAULT_UVP : FAULT_OCP);
+        _fault_info.vbus_mV = (uvp && !ovp) ? vbus_lo : vbus_hi;
+        _fault_info.current_mA = current;
+        _fault_info.timestamp_us = now_us;
+        _fault_reported = false;
+        _fault_code = _fault_info.code;
+    }
+    QC3_PROT_UNLOCK();
+}
+
+/**
+ * @brief 判定に使う電圧の読み取り
+ * @param slot 前回値の格納先（0: VBUS, 1: 電流）
+ * @param pin ピン番号
+ * @param lo_mV 最小値（mV）
+ * @param hi_mV 最大値（mV）
+ * @note 連続ADCサンプリング中は間引き窓の最小・最大値、それ以外は1回の読み取り値。
+ *       esp_timerタスクは窓を更新する制御タスクを中断して動くため、getAdcStream()のように
+ *       読み直しを待つと更新が終わらない。読み取りは1回だけ試し、更新中なら前回の窓を使う
+ */
+void ESP32_QC3_CTL::readProtectionPin(uint8_t slot, uint8_t pin, uint16_t *lo_mV, uint16_t *hi_mV) {
+    const int8_t idx = (_adc_stream != NULL) ? findAdcPin(pin) : -1;
+    if ((idx >= 0) && (_adcStreamChan[idx] != 0xFFU) && (_adcStreamData[idx].seq != 0U)) {
+        const uint32_t seq = _adcStreamData[idx].seq;
+        const uint16_t min = _adcStreamData[idx].min;
+        const uint16_t max = _adcStreamData[idx].max;
+        if (((seq & 1U) == 0U) && (seq == _adcStreamData[idx].seq)) {
+            _prot_win_lo[slot] = readMillivolts(pin, min);
+            _prot_win_hi[slot] = readMillivolts(pin, max);
+            _prot_win_valid[slot] = true;
+        } else {
+            _prot_miss = _prot_miss + 1U;
+        }
+        if (_prot_win_valid[slot]) {
+            *lo_mV = _prot_win_lo[slot];
+            *hi_mV = _prot_win_hi[slot];
+            return;
+        }
+    }
+    const uint16_t mV = readMillivolts(pin, _hal->analogRead(pin));
+    *lo_mV = mV;
+    *hi_mV = mV;
+}
+
+/**
+ * @brief 判定時に連続ADCサンプリングの間引き窓を読めなかった回数の取得
+ * @return 回数（startProtection()で0に戻る）
+ */
+uint32_t ESP32_QC3_CTL::getProtectionMissCount() {
+    return _prot_miss;
+}
+
+/**
+ * @brief 出力有効ピンの操作
+ * @param on true: 出力ON
+ * @return 操作結果（true: 成功, false: フォルトをラッチ中）
+ * @note 判定タイマーによる遮断と競合しないよう、フォルトの確認と書き込みを排他する
+ */
+bool ESP32_QC3_CTL::writeOutput(bool on) {
+    QC3_PROT_LOCK();
+    const bool ok = !on || (_fault_code == FAULT_NONE);
+    if (ok) {
+        _hal->digitalWrite(_out_en, on ? HIGH : LOW);
+        _is_on = on;
+    }
+    QC3_PROT_UNLOCK();
+    return ok;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * @brief 判定タイマーのコールバック
+ * @param arg ESP32_QC3_CTLインスタンス
+ */
+void ESP32_QC3_CTL::protTimerCallback(void *arg) {
+    ESP32_QC3_CTL *self = static_cast<ESP32_QC3_CTL *>(arg);
+    self->checkProtection(self->_hal->micros());
+}
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file ESP32_QC3_Queue.h
+ * @brief 固定長のロックフリーキュー（複数生産者・単一消費者）
+ * 
+ * 各セルのシーケンス番号で空き/使用中を判定する方式で、割り込み禁止や
+ * ミューテックスを使わずに複数タスクから投入できます。取り出しは
+ * 単一のタスク（制御タスク）から行う前提です。
+ */
+
+#ifndef ESP32_QC3_QUEUE_H
+#define ESP32_QC3_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief 複数生産者・単一消費者の固定長キュー
+ * @tparam T 要素の型
+ * @tparam N 要素数（2のべき乗）
+ */
+template <typename T, uint8_t N>
+class QC3MpscQueue {
+    static_assert((N >= 2U) && ((N & (N - 1U)) == 0U), "queue length must be a power of two");
+
+public:
+    QC3MpscQueue() {
+        for (uint8_t i = 0U; i < N; i++) {
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        _head.store(0U, std::memory_order_relaxed);
+        _tail = 0U;
+    }
+
+    /**
+     * @brief 要素の投入
+     * @param item 要素
+     * @return 投入結果（true: 成功, false: 満杯）
+     */
+    bool push(const T &item) {
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _cells[pos & (N - 1U)];
+            const uint32_t seq = cell.seq.load(std::memory_order_acquire);
+            const int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed)) {
+                    cell.data = item;
+                    cell.seq.store(pos + 1U, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief 複数要素の一括投入
+     * @param items 要素
+     * @param count 要素数（1〜N）
+     * @return 投入結果（true: 全要素を投入, false: 空きが足りない（何も投入しない））
+     * @note 連続した位置をまとめて確保し、先頭の要素を最後に公開する。
+     *       消費者は先頭が公開されるまでいずれの要素も取り出せないため、全要素を続けて取り出す
+     */
+    bool pushBatch(const T *items, uint8_t count) {
+        if ((count == 0U) || (count > N)) {
+            return false;
+        }
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            bool free = true;
+            bool stale = false;
+            for (uint8_t i = 0U; i < count; i++) {
+                const uint32_t seq = _cells[(pos + i) & (N - 1U)].seq.load(std::memory_order_acquire);
+                const int32_t diff = (int32_t)(seq - (pos + i));
+                if (diff < 0) {
+                    free = false;
+                    break;
+                } else if (diff > 0) {
+                    stale = true;
+                    break;
+                }
+            }
+            if (!free) {
+                return false;
+            }
+            if (stale) {
+                pos = _head.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (uint8_t i = count; i > 0U; i--) {
+            Cell &cell = _cells[(pos + i - 1U) & (N - 1U)];
+            cell.data = items[i - 1U];
+            cell.seq.store(pos + i, std::memory_order_release);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 要素の取り出し（消費者タスクのみ）
+     * @param item 取り出し先
+     * @return 取り出し結果（true: 成功, false: 空）
+     */
+    bool pop(T &item) {
+        Cell &cell = _cells[_tail & (N - 1U)];
+        const uint32_t seq = cell.seq.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (_tail + 1U)) < 0) {
+            return false;
+        }
+        item = cell.data;
+        cell.seq.store(_tail + N, std::memory_order_release);
+        _tail++;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;  ///< セルのシーケンス番号
+        T data;                     ///< 要素
+    };
+
+    Cell _cells[N];                 ///< 要素
+    std::atomic<uint32_t> _head;    ///< 次に投入する位置
+    uint32_t _tail;                 ///< 次に取り出す位置
+};
+
+#endif // ESP32_QC3_QUEUE_H
@@ -0,0 +1,111 @@
+/**
+ * @file ESP32_QC3_Regulation.cpp
+ * @brief ESP32_QC3_CTLの定電圧制御（VBUS実測値フィードバック）実装
+ * 
+ * 可変モード(QC_VAR)の設定値はパルス数から求めた値のため、充電器側の誤差や
+ * 負荷による電圧降下は反映されません。ここではVBUS検出ピンの実測値と目標の
+ * 差から可変モードのステップを発行し、許容範囲に収まるまで補正します。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+/**
+ * @brief 定電圧制御の開始
+ * @param target_mV 目標電圧（mV）
+ * @param tolerance_mV 許容誤差（mV）
+ * @param retrim_ms 安定後に再測定する間隔（ms）
+ * @return 開始結果（true: 成功, false: QC3以外）
+ */
+bool ESP32_QC3_CTL::startRegulation(uint16_t target_mV, uint16_t tolerance_mV, uint32_t retrim_ms) {
+    // まず設定値ベースで目標電圧へ移行
+    if (!setVarVoltage(target_mV)) {
+        return false;
+    }
+
+    _reg_target = target_mV;
+    _reg_tolerance = tolerance_mV;
+    _reg_retrim_ms = retrim_ms;
+    _reg_ts = _hal->millis();
+    _reg_state = REG_ADJUSTING;
+    return true;
+}
+
+/**
+ * @brief 定電圧制御の停止
+ */
+void ESP32_QC3_CTL::stopRegulation() {
+    _reg_state = REG_OFF;
+}
+
+/**
+ * @brief 定電圧制御を進める
+ * @return 制御状態（REG_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollRegulation() {
+    return pollRegulation(_hal->millis());
+}
+
+/**
+ * @brief 定電圧制御を進める（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ * @return 制御状態（REG_STATE）
+ */
+uint8_t ESP32_QC3_CTL::pollRegulation(uint32_t now_ms) {
+    if (_reg_state == REG_OFF) {
+        return REG_OFF;
+    }
+
+    // パルス出力中は完了後の安定待ちから数え直す
+    if (isVarBusy()) {
+        _reg_ts = now_ms;
+        return _reg_state;
+    }
+
+    const uint32_t elapsed = now_ms - _reg_ts;
+    if (_reg_state == REG_ADJUSTING) {
+        if (elapsed < REG_SETTLE_MS) {
+            return _reg_state;
+        }
+    } else if (elapsed < _reg_retrim_ms) {
+        return _reg_state;
+    }
+
+    _reg_ts = now_ms;
+    const int32_t err = (int32_t)_reg_target - (int32_t)readVbusMillivolts();
+    if ((err <= (int32_t)_reg_tolerance) && (err >= -(int32_t)_reg_tolerance)) {
+        _reg_state = REG_LOCKED;
+        QC3_TRACE(TRACE_REG, _reg_state, err);
+        return _reg_state;
+    }
+
+    // 誤差分のステップ数（最低1ステップ）だけ設定値を動かす
+    int32_t steps = err / 200;
+    if (steps == 0) {
+        steps = (err > 0) ? 1 : -1;
+    }
+    const uint16_t current = getVarTarget();
+    int32_t next = (int32_t)current + (steps * 200);
+    if (next < 0) {
+        next = 0;
+    } else if (next > 0xFFFF) {
+        next = 0xFFFF;
+    }
+    (void)setVarVoltage((uint16_t)next);
+
+    // 可変範囲の端で動けない場合は補正を打ち切る
+    if (getVarTarget() == current) {
+        _reg_state = REG_LIMIT;
+    } else {
+        _reg_state = REG_ADJUSTING;
+    }
+    QC3_TRACE(TRACE_REG, _reg_state, err);
+    return _reg_state;
+}
+
+/**
+ * @brief 定電圧制御の状態を取得
+ * @return 制御状態（REG_STATE）
+ */
+uint8_t ESP32_QC3_CTL::getRegulationState() {
+    return _reg_state;
+}
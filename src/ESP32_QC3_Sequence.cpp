@@ -0,0 +1,336 @@
+/**
+ * @file ESP32_QC3_Sequence.cpp
+ * @brief 電圧プロファイルのシーケンス実行の実装
+ */
+
+#include "ESP32_QC3_Sequence.h"
+
+QC3Sequence::QC3Sequence(ESP32_QC3_CTL *ctl) {
+    _ctl = ctl;
+    _steps = NULL;
+    _count = 0U;
+    _repeat = 1U;
+    _index = 0U;
+    _sub = 0U;
+    _cycle = 0U;
+    _set_mV = 0U;
+    _state = SEQ_IDLE;
+    _use_queue = false;
+    _wait_id = 0U;
+    _start_ms = 0U;
+    _ts = 0U;
+    memset(&_last, 0, sizeof(_last));
+    _has_sample = false;
+    _cb = NULL;
+    _cb_arg = NULL;
+    _meter = NULL;
+}
+
+/**
+ * @brief シーケンスの開始
+ * @param steps ステップ配列（実行中は保持すること）
+ * @param count ステップ数
+ * @param repeat 繰り返し回数（0: 停止するまで繰り返す）
+ * @return 開始結果（true: 成功, false: 引数不正またはQC3以外）
+ */
+bool QC3Sequence::start(const Step *steps, uint16_t count, uint16_t repeat) {
+    if ((_ctl == NULL) || (steps == NULL) || (count == 0U)) {
+        return false;
+    }
+    for (uint16_t i = 0U; i < count; i++) {
+        if (steps[i].type > SEQ_WAIT) {
+            return false;
+        }
+    }
+
+    // 制御タスクの動作中は状態をスナップショットから取得する
+    _use_queue = _ctl->isControlTaskRunning();
+    uint8_t host_type = _ctl->getHostType();
+    if (_use_queue) {
+        ESP32_QC3_CTL::Snapshot snap;
+        if (!_ctl->getSnapshot(&snap)) {
+            return false;
+        }
+        host_type = snap.host_type;
+    }
+    if (host_type != ESP32_QC3_CTL::QC3) {
+        return false;
+    }
+
+    _steps = steps;
+    _count = count;
+    _repeat = repeat;
+    _index = 0U;
+    _sub = 0U;
+    _cycle = 0U;
+    _has_sample = false;
+    _start_ms = _ctl->getHal()->millis();
+    if (!beginStep(_start_ms)) {
+        finish(SEQ_ERROR);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief シーケンスの停止（電圧・出力はその時点のまま）
+ */
+void QC3Sequence::stop() {
+    if (isRunning()) {
+        finish(SEQ_IDLE);
+    }
+}
+
+/**
+ * @brief シーケンスを進める
+ * @return 実行状態（SEQ_STATE）
+ */
+uint8_t QC3Sequence::poll() {
+    if (_ctl == NULL) {
+        return _state;
+    }
+    return poll(_ctl->getHal()->millis());
+}
+
+/**
+ * @brief シーケンスを進める（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ * @return 実行状態（SEQ_STATE）
+ */
+uint8_t QC3Sequence::poll(uint32_t now_ms) {
+    if (_state == SEQ_SETTLE) {
+        if (!isSettled()) {
+            if ((uint32_t)(now_ms - _ts) >= SETTLE_TIMEOUT_MS) {
+                finish(SEQ_ERROR);
+            }
+            return _state;
+        }
+        _state = SEQ_DWELL;
+        _ts = now_ms;
+    }
+    if (_state != SEQ_DWELL) {
+        return _state;
+    }
+
+    const Step &step = _steps[_index];
+    if ((uint32_t)(now_ms - _ts) < step.dwell_ms) {
+        return _state;
+    }
+    capture(now_ms);
+
+    // 次の段・ステップ・繰り返しへ
+    if ((step.type == SEQ_RAMP) && ((uint16_t)(_sub + 1U) < rampLength(step))) {
+        _sub++;
+    } else {
+        _sub = 0U;
+        _index++;
+        if (_index >= _count) {
+            _index = 0U;
+            _cycle++;
+            if ((_repeat != 0U) && (_cycle >= _repeat)) {
+                _cycle = (uint16_t)(_repeat - 1U);
+                _index = (uint16_t)(_count - 1U);
+                finish(SEQ_DONE);
+                return _state;
+            }
+        }
+    }
+    if (!beginStep(now_ms)) {
+        finish(SEQ_ERROR);
+    }
+    return _state;
+}
+
+/**
+ * @brief 実行中かどうか
+ * @return true: 実行中
+ */
+bool QC3Sequence::isRunning() {
+    return (_state == SEQ_SETTLE) || (_state == SEQ_DWELL);
+}
+
+/**
+ * @brief 実行状態の取得
+ * @return 実行状態（SEQ_STATE）
+ */
+uint8_t QC3Sequence::getState() {
+    return _state;
+}
+
+/**
+ * @brief 実行中のステップ番号
+ * @return ステップ番号
+ */
+uint16_t QC3Sequence::getStepIndex() {
+    return _index;
+}
+
+/**
+ * @brief 実行中の繰り返し回数
+ * @return 繰り返し回数（0から）
+ */
+uint16_t QC3Sequence::getCycle() {
+    return _cycle;
+}
+
+/**
+ * @brief 最後の計測結果の取得
+ * @param sample 取得先
+ * @return 取得結果（true: 成功, false: 未計測）
+ */
+bool QC3Sequence::getLastSample(Sample *sample) {
+    if (!_has_sample) {
+        return false;
+    }
+    *sample = _last;
+    return true;
+}
+
+/**
+ * @brief 計測コールバックの登録
+ * @param cb コールバック関数（NULLで解除）
+ * @param arg コールバックに渡すユーザー引数
+ */
+void QC3Sequence::setSampleCallback(SampleCallback cb, void *arg) {
+    _cb = cb;
+    _cb_arg = arg;
+}
+
+/**
+ * @brief ステップ毎の電力量の積算先の登録
+ * @param meter 積算先（NULLで解除）
+ * @note 各ステップの開始時にmeter->setStep()でステップ番号を設定し、終了時に解除する
+ */
+void QC3Sequence::setEnergyMeter(QC3EnergyMeter *meter) {
+    _meter = meter;
+}
+
+/**
+ * @brief ランプの段数
+ * @param step ランプのステップ
+ * @return 段数（開始・終了電圧を含む）
+ */
+uint16_t QC3Sequence::rampLength(const Step &step) {
+    const uint16_t inc = (step.step_mV >= 200U) ? step.step_mV : 200U;
+    const uint16_t span = (step.to_mV >= step.from_mV) ?
+        (uint16_t)(step.to_mV - step.from_mV) : (uint16_t)(step.from_mV - step.to_mV);
+    return (uint16_t)((span + inc - 1U) / inc + 1U);
+}
+
+/**
+ * @brief 現在のステップ（ランプは現在の段）の設定
+ * @param now_ms 現在時刻（ms）
+ * @return 設定結果（true: 成功, false: QC3以外またはキュー満杯）
+ */
+bool QC3Sequence::beginStep(uint32_t now_ms) {
+    const Step &step = _steps[_index];
+    bool ok = true;
+    _wait_id = 0U;
+    if (_meter != NULL) {
+        _meter->setStep(_index);
+    }
+
+    switch (step.type) {
+        case SEQ_FIXED:
+            _set_mV = (step.mode == ESP32_QC3_CTL::QC_9V) ? 9000U :
+                (step.mode == ESP32_QC3_CTL::QC_12V) ? 12000U :
+                (step.mode == ESP32_QC3_CTL::QC_20V) ? 20000U : 5000U;
+            ok = _use_queue ? post(ESP32_QC3_CTL::CMD_SET_MODE, step.mode) : _ctl->set_VBUS(step.mode);
+            break;
+        case SEQ_VAR:
+        case SEQ_RAMP: {
+            uint32_t target = step.from_mV;
+            if (step.type == SEQ_RAMP) {
+                const uint32_t inc = (uint32_t)((step.step_mV >= 200U) ? step.step_mV : 200U) * _sub;
+                if (step.to_mV >= step.from_mV) {
+                    target = step.from_mV + inc;
+                    target = (target > step.to_mV) ? step.to_mV : target;
+                } else {
+                    target = (inc < (uint32_t)(step.from_mV - step.to_mV)) ? (step.from_mV - inc) : step.to_mV;
+                }
+            }
+            _set_mV = (uint16_t)target;
+            ok = _use_queue ? post(ESP32_QC3_CTL::CMD_SET_VAR, (int32_t)target) : _ctl->setVarVoltage((uint16_t)target);
+            break;
+        }
+        case SEQ_OUTPUT:
+            ok = _use_queue ? post(ESP32_QC3_CTL::CMD_OUTPUT, step.mode) : _ctl->setOutput(step.mode != 0U);
+            break;
+        default:
+            break;
+    }
+
+    _state = SEQ_SETTLE;
+    _ts = now_ms;
+    return ok;
+}
+
+/**
+ * @brief 設定が反映されたかどうか
+ * @return true: 反映済み（投入したコマンドが実行され、パルス出力も完了）
+ */
+bool QC3Sequence::isSettled() {
+    if (!_use_queue) {
+        // esp_timer非対応の環境ではここでパルス出力を進める
+        (void)_ctl->pollVar();
+        return !_ctl->isVarBusy();
+    }
+    ESP32_QC3_CTL::Snapshot snap;
+    if (!_ctl->getSnapshot(&snap)) {
+        return false;
+    }
+    return ((int32_t)(snap.last_cmd_id - _wait_id) >= 0) && !snap.var_busy;
+}
+
+/**
+ * @brief 計測結果の記録と通知
+ * @param now_ms 現在時刻（ms）
+ */
+void QC3Sequence::capture(uint32_t now_ms) {
+    Sample s;
+    s.step = _index;
+    s.cycle = _cycle;
+    s.set_mV = _set_mV;
+    if (_use_queue) {
+        ESP32_QC3_CTL::Snapshot snap;
+        (void)_ctl->getSnapshot(&snap);
+        s.vbus_mV = snap.vbus_mV;
+        s.current_mA = snap.current_mA;
+    } else {
+        s.vbus_mV = _ctl->readVbusMillivolts();
+        s.current_mA = _ctl->readCurrentMilliamps();
+    }
+    s.t_ms = now_ms - _start_ms;
+
+    _last = s;
+    _has_sample = true;
+    if (_cb != NULL) {
+        _cb(s, _cb_arg);
+    }
+}
+
+/**
+ * @brief 実行の終了（電力量の積算先のステップも解除）
+ * @param state 終了後の状態（SEQ_IDLE, SEQ_DONE, SEQ_ERROR）
+ */
+void QC3Sequence::finish(uint8_t state) {
+    _state = state;
+    if (_meter != NULL) {
+        _meter->setStep(0xFFFFU);
+    }
+}
+
+/**
+ * @brief 制御タスクへのコマンド投入
+ * @param type コマンド種別（CMD_TYPE）
+ * @param value 引数
+ * @return 投入結果（true: 成功, false: キュー満杯）
+ */
+bool QC3Sequence::post(uint8_t type, int32_t value) {
+    const uint32_t id = _ctl->postCommand(type, value);
+    if (id == 0U) {
+        return false;
+    }
+    _wait_id = id;
+    return true;
+}
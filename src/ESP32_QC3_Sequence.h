@@ -0,0 +1,230 @@
+/**
+ * @file ESP32_QC3_Sequence.h
+ * @brief 電圧プロファイル（ステップ・ランプ・待機・繰り返し）のシーケンス実行
+ *
+ * Step配列で宣言したプロファイルをpoll()でノンブロッキングに実行し、
+ * 各ステップ（ランプは200mV単位の各段）の待機時間の終わりにVBUS/電流を計測します。
+ * 可変モードの段は目標電圧への到達（パルス出力の完了）後から待機時間を数えます。
+ * 固定電圧のステップは電圧の安定を待たないため、待機時間に安定時間を含めてください。
+ * 制御タスクの動作中はpostCommand()でコマンドを投入し、状態はgetSnapshot()で取得します。
+ */
+
+#ifndef ESP32_QC3_SEQUENCE_H
+#define ESP32_QC3_SEQUENCE_H
+
+#include "ESP32_QC3_CTL.h"
+
+/**
+ * @brief 電圧プロファイルのシーケンス実行
+ */
+class QC3Sequence {
+public:
+    /**
+     * @brief ステップの種類
+     */
+    enum SEQ_STEP_TYPE {
+        SEQ_FIXED = 0x00,   ///< 固定電圧（mode: QC_VOLTAGE_MODE）
+        SEQ_VAR = 0x01,     ///< 可変モードの目標電圧（from_mV）
+        SEQ_RAMP = 0x02,    ///< 可変モードのランプ（from_mV→to_mV, step_mV毎）
+        SEQ_OUTPUT = 0x03,  ///< 出力ON/OFF（mode: 0/1）
+        SEQ_WAIT = 0x04     ///< 待機のみ
+    };
+
+    /**
+     * @brief 実行状態
+     */
+    enum SEQ_STATE {
+        SEQ_IDLE = 0x00,    ///< 未実行
+        SEQ_SETTLE = 0x01,  ///< 設定の反映待ち（可変モードのパルス出力中）
+        SEQ_DWELL = 0x02,   ///< 待機中
+        SEQ_DONE = 0x03,    ///< 完了
+        SEQ_ERROR = 0x04    ///< 中断（QC3以外・キュー満杯・反映待ちのタイムアウト）
+    };
+
+    /**
+     * @brief プロファイルの1ステップ
+     */
+    struct Step {
+        uint8_t type;       ///< 種類（SEQ_STEP_TYPE）
+        uint8_t mode;       ///< SEQ_FIXED: 電圧モード, SEQ_OUTPUT: 1=ON/0=OFF
+        uint16_t from_mV;   ///< SEQ_VAR: 目標電圧, SEQ_RAMP: 開始電圧（mV）
+        uint16_t to_mV;     ///< SEQ_RAMP: 終了電圧（mV）
+        uint16_t step_mV;   ///< SEQ_RAMP: 1段の電圧（mV、200mV単位）
+        uint32_t dwell_ms;  ///< 待機時間（ms、SEQ_RAMPは1段毎）
+    };
+
+    /**
+     * @brief 計測結果
+     */
+    struct Sample {
+        uint16_t step;       ///< ステップ番号
+        uint16_t cycle;      ///< 繰り返し回数（0から）
+        uint16_t set_mV;     ///< 設定電圧（mV）
+        uint16_t vbus_mV;    ///< VBUS実測値（mV）
+        int32_t current_mA;  ///< 電流実測値（mA）
+        uint32_t t_ms;       ///< 開始からの経過時間（ms）
+    };
+
+    /**
+     * @brief 計測コールバック
+     * @param sample 計測結果
+     * @param arg setSampleCallback()で渡したユーザー引数
+     */
+    typedef void (*SampleCallback)(const Sample &sample, void *arg);
+
+    /**
+     * @brief 固定電圧のステップ
+     * @param mode 電圧モード（QC_5V, QC_9V, QC_12V, QC_20V）
+     * @param dwell_ms 待機時間（ms）
+     */
+    static constexpr Step fixed(uint8_t mode, uint32_t dwell_ms) {
+        return Step{ SEQ_FIXED, mode, 0U, 0U, 0U, dwell_ms };
+    }
+
+    /**
+     * @brief 可変モードの目標電圧のステップ
+     * @param mV 目標電圧（mV）
+     * @param dwell_ms 到達後の待機時間（ms）
+     */
+    static constexpr Step var(uint16_t mV, uint32_t dwell_ms) {
+        return Step{ SEQ_VAR, 0U, mV, 0U, 0U, dwell_ms };
+    }
+
+    /**
+     * @brief 可変モードのランプのステップ
+     * @param from_mV 開始電圧（mV）
+     * @param to_mV 終了電圧（mV、開始電圧より低くてもよい）
+     * @param step_mV 1段の電圧（mV、200mV単位）
+     * @param dwell_ms 1段毎の待機時間（ms）
+     */
+    static constexpr Step ramp(uint16_t from_mV, uint16_t to_mV, uint16_t step_mV, uint32_t dwell_ms) {
+        return Step{ SEQ_RAMP, 0U, from_mV, to_mV, step_mV, dwell_ms };
+    }
+
+    /**
+     * @brief 出力ON/OFFのステップ
+     * @param on true: 出力ON
+     * @param dwell_ms 待機時間（ms）
+     */
+    static constexpr Step output(bool on, uint32_t dwell_ms = 0U) {
+        return Step{ SEQ_OUTPUT, (uint8_t)(on ? 1U : 0U), 0U, 0U, 0U, dwell_ms };
+    }
+
+    /**
+     * @brief 待機のみのステップ
+     * @param dwell_ms 待機時間（ms）
+     */
+    static constexpr Step wait(uint32_t dwell_ms) {
+        return Step{ SEQ_WAIT, 0U, 0U, 0U, 0U, dwell_ms };
+    }
+
+    /**
+     * @brief コンストラクタ
+     * @param ctl 制御インスタンス
+     */
+    explicit QC3Sequence(ESP32_QC3_CTL *ctl);
+
+    /**
+     * @brief シーケンスの開始
+     * @param steps ステップ配列（実行中は保持すること）
+     * @param count ステップ数
+     * @param repeat 繰り返し回数（0: 停止するまで繰り返す）
+     * @return 開始結果（true: 成功, false: 引数不正またはQC3以外）
+     */
+    bool start(const Step *steps, uint16_t count, uint16_t repeat = 1);
+
+    /**
+     * @brief シーケンスの停止（電圧・出力はその時点のまま）
+     */
+    void stop();
+
+    /**
+     * @brief シーケンスを進める
+     * @return 実行状態（SEQ_STATE）
+     */
+    uint8_t poll();
+
+    /**
+     * @brief シーケンスを進める（時刻指定）
+     * @param now_ms 現在時刻（ms）
+     * @return 実行状態（SEQ_STATE）
+     */
+    uint8_t poll(uint32_t now_ms);
+
+    /**
+     * @brief 実行中かどうか
+     * @return true: 実行中
+     */
+    bool isRunning();
+
+    /**
+     * @brief 実行状態の取得
+     * @return 実行状態（SEQ_STATE）
+     */
+    uint8_t getState();
+
+    /**
+     * @brief 実行中のステップ番号
+     * @return ステップ番号
+     */
+    uint16_t getStepIndex();
+
+    /**
+     * @brief 実行中の繰り返し回数
+     * @return 繰り返し回数（0から）
+     */
+    uint16_t getCycle();
+
+    /**
+     * @brief 最後の計測結果の取得
+     * @param sample 取得先
+     * @return 取得結果（true: 成功, false: 未計測）
+     */
+    bool getLastSample(Sample *sample);
+
+    /**
+     * @brief 計測コールバックの登録
+     * @param cb コールバック関数（NULLで解除）
+     * @param arg コールバックに渡すユーザー引数
+     */
+    void setSampleCallback(SampleCallback cb, void *arg = NULL);
+
+    /**
+     * @brief ステップ毎の電力量の積算先の登録
+     * @param meter 積算先（NULLで解除）
+     * @note 各ステップの開始時にmeter->setStep()でステップ番号を設定し、終了時に解除する
+     */
+    void setEnergyMeter(QC3EnergyMeter *meter);
+
+private:
+    static const uint32_t SETTLE_TIMEOUT_MS = 30000;  ///< 設定の反映待ちの上限（ms）
+
+    ESP32_QC3_CTL *_ctl;     ///< 制御インスタンス
+    const Step *_steps;      ///< ステップ配列
+    uint16_t _count;         ///< ステップ数
+    uint16_t _repeat;        ///< 繰り返し回数（0: 無限）
+    uint16_t _index;         ///< 実行中のステップ番号
+    uint16_t _sub;           ///< ランプの段番号
+    uint16_t _cycle;         ///< 繰り返し回数
+    uint16_t _set_mV;        ///< 設定電圧（mV）
+    uint8_t _state;          ///< 実行状態
+    bool _use_queue;         ///< 制御タスクへコマンドを投入する
+    uint32_t _wait_id;       ///< 反映を待つコマンドID
+    uint32_t _start_ms;      ///< 開始時刻（ms）
+    uint32_t _ts;            ///< 現在の状態に入った時刻（ms）
+
+    Sample _last;            ///< 最後の計測結果
+    bool _has_sample;        ///< 計測済みフラグ
+    SampleCallback _cb;      ///< 計測コールバック
+    void *_cb_arg;           ///< コールバックのユーザー引数
+    QC3EnergyMeter *_meter;  ///< ステップ毎の電力量の積算先
+
+    uint16_t rampLength(const Step &step);
+    bool beginStep(uint32_t now_ms);
+    bool isSettled();
+    void capture(uint32_t now_ms);
+    void finish(uint8_t state);
+    bool post(uint8_t type, int32_t value);
+};
+
+#endif // ESP32_QC3_SEQUENCE_H
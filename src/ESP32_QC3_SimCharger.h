@@ -0,0 +1,523 @@
+/**
+ * @file ESP32_QC3_SimCharger.h
+ * @brief QC3.0充電器のシミュレーションモデル（QC3Hal実装）
+ *
+ * D+/D-のH/Lピン出力から端子電圧を求め、BC1.2 DCPの短絡・QC3.0ハンドシェイク・
+ * 電圧モードの切り替え・可変モードのパルスに仮想時間で応答します。
+ * VBUS検出ピンのanalogRead()はモデルのVBUS出力を分圧比で割った値を返すため、
+ * ESP32_QC3_CTLへsetHal()で渡すとPC上で検出や電圧設定の処理を実行できます。
+ * 時間はdelay()/delayMicroseconds()/advance()でのみ進むため、結果は再現可能です。
+ */
+
+#ifndef ESP32_QC3_SIMCHARGER_H
+#define ESP32_QC3_SIMCHARGER_H
+
+#include "ESP32_QC3_Hal.h"
+
+#ifndef QC3_SIM_MAX_PINS
+ #define QC3_SIM_MAX_PINS 64  ///< シミュレーション対象のピン数
+#endif
+
+/**
+ * @brief QC3.0充電器のシミュレーションモデル
+ */
+class QC3SimCharger : public QC3Hal {
+public:
+    /**
+     * @brief 充電器の種類
+     */
+    enum SIM_TYPE {
+        SIM_NONE = 0x00,  ///< DCP以外（D+が2.7Vにプルアップされたポート）
+        SIM_DCP = 0x01,   ///< BC1.2 DCPのみ（D+/D-短絡）
+        SIM_QC3A = 0x02,  ///< QC3.0 Class A（最大12V）
+        SIM_QC3B = 0x03,  ///< QC3.0 Class B（最大20V）
+        SIM_UNPLUGGED = 0x04  ///< 未接続（unplug()で設定）
+    };
+
+    /**
+     * @brief 充電器の出力モード
+     */
+    enum SIM_MODE {
+        SIM_MODE_BC12 = 0x00,  ///< ハンドシェイク前（5V）
+        SIM_MODE_5V = 0x01,    ///< 5V
+        SIM_MODE_9V = 0x02,    ///< 9V
+        SIM_MODE_12V = 0x03,   ///< 12V
+        SIM_MODE_20V = 0x04,   ///< 20V
+        SIM_MODE_CONT = 0x05   ///< 可変モード
+    };
+
+    static const uint32_t BC_DONE_US = 1250000UL;  ///< ハンドシェイク完了までのD+保持時間（T_GLITCH_BC_DONE）
+    static const uint32_t V_CHANGE_US = 40000UL;   ///< 電圧モード確定までの保持時間（T_GLITCH_V_CHANGE）
+    static const uint32_t PULSE_MIN_US = 100UL;    ///< 可変モードの最小パルス幅
+    static const uint16_t VTH_MV = 325U;           ///< D+/D-の判定しきい値（mV）
+    static const uint16_t CONT_MIN_MV = 3600U;     ///< 可変モードの下限電圧（mV）
+    static const uint16_t PULLUP_MV = 2700U;       ///< SIM_NONEのD+電圧（mV）
+    static const uint16_t ADC_OFFSET_MV = 30U;     ///< ADCのオフセット（mV）
+
+    /**
+     * @brief コンストラクタ
+     * @param dp_h D+端子のHIGHピン
+     * @param dp_l D+端子のLOWピン
+     * @param dm_h D-端子のHIGHピン
+     * @param dm_l D-端子のLOWピン
+     * @param vbus_det VBUS検出ピン
+     * @param type 充電器の種類（SIM_TYPE）
+     */
+    QC3SimCharger(uint8_t dp_h, uint8_t dp_l, uint8_t dm_h, uint8_t dm_l, uint8_t vbus_det, uint8_t type = SIM_QC3B) {
+        _dp_h = dp_h;
+        _dp_l = dp_l;
+        _dm_h = dm_h;
+        _dm_l = dm_l;
+        _vbus_det = vbus_det;
+        _now_us = 0U;
+        _div_x100 = 767U;
+        _slew_mV_per_ms = 500U;
+        for (uint8_t i = 0U; i < QC3_SIM_MAX_PINS; i++) {
+            _pin_mode[i] = INPUT;
+            _pin_level[i] = LOW;
+            _analog_mV[i] = 0U;
+        }
+        plug(type);
+    }
+
+    /**
+     * @brief 充電器の接続（差し替え）
+     * @param type 充電器の種類（SIM_TYPE）
+     * @note VBUSは5V、ハンドシェイク前の状態から開始する
+     */
+    void plug(uint8_t type) {
+        _type = type;
+        _mode = SIM_MODE_BC12;
+        _shorted = (type != SIM_NONE);
+        _vbus_mV = 5000U;
+        _vbus_target = 5000U;
+        _slew_rem = 0U;
+        _pulse_count = 0U;
+        _dp_mV = lineMillivolts(_dp_h, _dp_l);
+        _dm_mV = lineMillivolts(_dm_h, _dm_l);
+        _dp_hold_us = _now_us;
+        _dp_high_us = _now_us;
+        _dm_low_us = _now_us;
+        _line_us = _now_us;
+        resolveLines();
+    }
+
+    /**
+     * @brief 充電器の取り外し
+     * @note VBUSはsetSlewRate()の速度で0Vまで下がり、D+/D-は開放になる。plug()で再接続する
+     */
+    void unplug() {
+        _type = SIM_UNPLUGGED;
+        _mode = SIM_MODE_BC12;
+        _shorted = false;
+        _vbus_target = 0U;
+        _slew_rem = 0U;
+        resolveLines();
+    }
+
+    /**
+     * @brief VBUS検出ピンの分圧比設定
+     * @param ratio_x100 分圧比の100倍（VBUS / VBUS検出ピン電圧）
+     */
+    void setVbusDivider(uint16_t ratio_x100) {
+        _div_x100 = (ratio_x100 > 0U) ? ratio_x100 : 100U;
+    }
+
+    /**
+     * @brief VBUSの変化速度設定
+     * @param mV_per_ms 変化速度（mV/ms、0で即時）
+     */
+    void setSlewRate(uint16_t mV_per_ms) {
+        _slew_mV_per_ms = mV_per_ms;
+    }
+
+    /**
+     * @brief D+/D-/VBUS検出以外のピンのアナログ電圧設定
+     * @param pin ピン番号
+     * @param mV 電圧（mV）
+     * @note 電流センサ出力等の模擬に使用する
+     */
+    void setAnalogMillivolts(uint8_t pin, uint16_t mV) {
+        if (pin < QC3_SIM_MAX_PINS) {
+            _analog_mV[pin] = mV;
+        }
+    }
+
+    /**
+     * @brief 仮想時間を進める
+     * @param us 経過時間（us）
+     */
+    void advance(uint32_t us) {
+        // D+保持・電圧モード確定の期限をまたぐ場合はその時刻で一旦処理する
+        while (us > 0U) {
+            uint32_t step = us;
+            const uint32_t next = nextEventUs();
+            if ((next > 0U) && (next < step)) {
+                step = next;
+            }
+            slew(step);
+            _now_us += step;
+            us -= step;
+            evaluate();
+        }
+    }
+
+    /**
+     * @brief 仮想時間の取得
+     * @return 経過時間（us）
+     */
+    uint64_t nowUs() const {
+        return _now_us;
+    }
+
+    /**
+     * @brief VBUS出力の取得
+     * @return VBUS電圧（mV）
+     */
+    uint16_t getVbusMillivolts() const {
+        return _vbus_mV;
+    }
+
+    /**
+     * @brief VBUS出力の目標値の取得
+     * @return 目標電圧（mV）
+     */
+    uint16_t getVbusTarget() const {
+        return _vbus_target;
+    }
+
+    /**
+     * @brief 出力モードの取得
+     * @return 出力モード（SIM_MODE）
+     */
+    uint8_t getMode() const {
+        return _mode;
+    }
+
+    /**
+     * @brief 受け付けた可変モードのパルス数
+     * @return パルス数（plug()で0に戻る）
+     */
+    uint32_t getPulseCount() const {
+        return _pulse_count;
+    }
+
+    /**
+     * @brief D+端子電圧の取得
+     * @return 電圧（mV）
+     */
+    uint16_t getDpMillivolts() const {
+        return _dp_line;
+    }
+
+    /**
+     * @brief D-端子電圧の取得
+     * @return 電圧（mV）
+     */
+    uint16_t getDmMillivolts() const {
+        return _dm_line;
+    }
+
+    // QC3Hal
+    void pinMode(uint8_t pin, uint8_t mode) {
+        if (pin < QC3_SIM_MAX_PINS) {
+            _pin_mode[pin] = mode;
+            updateLines();
+        }
+    }
+
+    void digitalWrite(uint8_t pin, uint8_t level) {
+        if (pin < QC3_SIM_MAX_PINS) {
+            _pin_level[pin] = (level != LOW) ? HIGH : LOW;
+            updateLines();
+        }
+    }
+
+    uint16_t analogRead(uint8_t pin) {
+        uint32_t mV;
+        if (pin == _vbus_det) {
+            mV = ((uint32_t)_vbus_mV * 100U + (_div_x100 / 2U)) / _div_x100;
+        } else if ((pin == _dp_h) || (pin == _dp_l)) {
+            mV = _dp_line;
+        } else if ((pin == _dm_h) || (pin == _dm_l)) {
+            mV = _dm_line;
+        } else if (pin < QC3_SIM_MAX_PINS) {
+            mV = _analog_mV[pin];
+        } else {
+            mV = 0U;
+        }
+        // ESP32以外でのreadVoltage()の換算式（30mVオフセット）の逆変換
+        if (mV <= ADC_OFFSET_MV) {
+            return 0U;
+        }
+        const uint32_t raw = ((mV - ADC_OFFSET_MV) * 4096U + 1650U) / 3300U;
+        return (uint16_t)((raw > 4095U) ? 4095U : raw);
+    }
+
+    void delay(uint32_t ms) {
+        advance(ms * 1000U);
+    }
+
+    void delayMicroseconds(uint32_t us) {
+        advance(us);
+    }
+
+    uint32_t millis() {
+        return (uint32_t)(_now_us / 1000U);
+    }
+
+    uint32_t micros() {
+        return (uint32_t)_now_us;
+    }
+
+private:
+    uint8_t _dp_h;
+    uint8_t _dp_l;
+    uint8_t _dm_h;
+    uint8_t _dm_l;
+    uint8_t _vbus_det;
+    uint8_t _pin_mode[QC3_SIM_MAX_PINS];
+    uint8_t _pin_level[QC3_SIM_MAX_PINS];
+    uint16_t _analog_mV[QC3_SIM_MAX_PINS];
+
+    uint64_t _now_us;        ///< 仮想時間（us）
+    uint8_t _type;           ///< 充電器の種類（SIM_TYPE）
+    uint8_t _mode;           ///< 出力モード（SIM_MODE）
+    bool _shorted;           ///< D+/D-短絡中（BC1.2 DCP）
+    uint16_t _div_x100;      ///< VBUS検出ピンの分圧比の100倍
+    uint16_t _slew_mV_per_ms;///< VBUSの変化速度（mV/ms）
+    uint32_t _slew_rem;      ///< 変化量の端数（mV*us/ms）
+    uint16_t _vbus_mV;       ///< VBUS出力（mV）
+    uint16_t _vbus_target;   ///< VBUS出力の目標値（mV）
+    uint32_t _pulse_count;   ///< 受け付けたパルス数
+
+    uint16_t _dp_mV;         ///< ホストが駆動するD+電圧（mV、0xFFFF: ハイインピーダンス）
+    uint16_t _dm_mV;         ///< ホストが駆動するD-電圧（mV、0xFFFF: ハイインピーダンス）
+    uint16_t _dp_line;       ///< 充電器側を含めたD+端子電圧（mV）
+    uint16_t _dm_line;       ///< 充電器側を含めたD-端子電圧（mV）
+    uint64_t _dp_hold_us;    ///< D+がしきい値以上になった時刻
+    uint64_t _dp_high_us;    ///< D+パルスの開始時刻
+    uint64_t _dm_low_us;     ///< D-パルスの開始時刻
+    uint64_t _line_us;       ///< D+/D-が最後に変化した時刻
+
+    static const uint16_t HIZ_MV = 0xFFFFU;
+
+    /**
+     * @brief H/Lピン対の出力電圧
+     * @param pin_h HIGHピン
+     * @param pin_l LOWピン
+     * @return 電圧（mV、HIZ_MV: ハイインピーダンス）
+     */
+    uint16_t lineMillivolts(uint8_t pin_h, uint8_t pin_l) const {
+        if ((pin_h >= QC3_SIM_MAX_PINS) || (pin_l >= QC3_SIM_MAX_PINS)) {
+            return HIZ_MV;
+        }
+        if ((_pin_mode[pin_h] != OUTPUT) && (_pin_mode[pin_l] != OUTPUT)) {
+            return HIZ_MV;
+        }
+        const bool h = (_pin_mode[pin_h] == OUTPUT) && (_pin_level[pin_h] == HIGH);
+        const bool l = (_pin_mode[pin_l] == OUTPUT) && (_pin_level[pin_l] == HIGH);
+        if (h && l) {
+            return 3300U;
+        }
+        if (h) {
+            return 600U;
+        }
+        return 0U;
+    }
+
+    /**
+     * @brief 充電器側の短絡・プルダウンを含めた端子電圧を求める
+     */
+    void resolveLines() {
+        const uint16_t dp = _dp_mV;
+        const uint16_t dm = _dm_mV;
+        if (_shorted) {
+            // 駆動側の電圧がもう一方にも現れる
+            const uint16_t v = (dp != HIZ_MV) ? dp : ((dm != HIZ_MV) ? dm : 0U);
+            _dp_line = (dp != HIZ_MV) ? dp : v;
+            _dm_line = (dm != HIZ_MV) ? dm : v;
+            return;
+        }
+        if (dp != HIZ_MV) {
+            _dp_line = dp;
+        } else {
+            _dp_line = (_type == SIM_NONE) ? PULLUP_MV : 0U;
+        }
+        _dm_line = (dm != HIZ_MV) ? dm : 0U;
+    }
+
+    /**
+     * @brief ピン操作後の端子電圧更新とパルス判定
+     */
+    void updateLines() {
+        const uint16_t prev_dp = _dp_line;
+        const uint16_t prev_dm = _dm_line;
+        _dp_mV = lineMillivolts(_dp_h, _dp_l);
+        _dm_mV = lineMillivolts(_dm_h, _dm_l);
+        resolveLines();
+        if ((_dp_line == prev_dp) && (_dm_line == prev_dm)) {
+            return;
+        }
+
+        const bool cont = (_mode == SIM_MODE_CONT);
+        bool pulse = false;
+        if (_dp_line != prev_dp) {
+            if ((prev_dp < VTH_MV) || (_dp_line < VTH_MV)) {
+                _dp_hold_us = _now_us;
+            }
+            if (_dp_line == 3300U) {
+                _dp_high_us = _now_us;
+            } else if (cont && (prev_dp == 3300U) && (_dp_line == 600U) && (_dm_line == 3300U)) {
+                // D+ 0.6V→3.3V→0.6V で200mV増加
+                if ((_now_us - _dp_high_us) >= PULSE_MIN_US) {
+                    stepContinuous(true);
+                    pulse = true;
+                }
+            }
+        }
+        if (_dm_line != prev_dm) {
+            if (_dm_line == 600U) {
+                _dm_low_us = _now_us;
+            } else if (cont && (prev_dm == 600U) && (_dm_line == 3300U) && (_dp_line == 600U)) {
+                // D- 3.3V→0.6V→3.3V で200mV減少
+                if ((_now_us - _dm_low_us) >= PULSE_MIN_US) {
+                    stepContinuous(false);
+                    pulse = true;
+                }
+            }
+        }
+        if (!pulse) {
+            _line_us = _now_us;
+        }
+        evaluate();
+    }
+
+    /**
+     * @brief 可変モードの1ステップ
+     * @param up true: 増加, false: 減少
+     */
+    void stepContinuous(bool up) {
+        const uint16_t vmax = (_type == SIM_QC3B) ? 20000U : 12000U;
+        if (up) {
+            if (_vbus_target + 200U <= vmax) {
+                _vbus_target = (uint16_t)(_vbus_target + 200U);
+            }
+        } else if (_vbus_target >= CONT_MIN_MV + 200U) {
+            _vbus_target = (uint16_t)(_vbus_target - 200U);
+        }
+        _pulse_count++;
+    }
+
+    /**
+     * @brief 時間経過による状態遷移
+     */
+    void evaluate() {
+        if ((_type != SIM_QC3A) && (_type != SIM_QC3B)) {
+            return;
+        }
+
+        if (_mode == SIM_MODE_BC12) {
+            if ((_dp_line >= VTH_MV) && ((_now_us - _dp_hold_us) >= BC_DONE_US)) {
+                // ハンドシェイク完了: 短絡を解除しD-をプルダウン
+                _shorted = false;
+                _mode = SIM_MODE_5V;
+                _line_us = _now_us;
+                resolveLines();
+            }
+            return;
+        }
+
+        if (_dp_line < VTH_MV) {
+            // D+が下がったらBC1.2 DCPへ戻る
+            if ((_now_us - _dp_hold_us) >= V_CHANGE_US) {
+                _shorted = true;
+                _mode = SIM_MODE_BC12;
+                _vbus_target = 5000U;
+                _dp_hold_us = _now_us;
+                resolveLines();
+            }
+            return;
+        }
+
+        if ((_now_us - _line_us) < V_CHANGE_US) {
+            return;
+        }
+        const bool dp_high = (_dp_line >= 2000U);
+        const uint8_t dm = (_dm_line >= 2000U) ? 2U : ((_dm_line >= VTH_MV) ? 1U : 0U);
+        if (!dp_high && (dm == 0U)) {
+            setMode(SIM_MODE_5V, 5000U);
+        } else if (dp_high && (dm == 1U)) {
+            setMode(SIM_MODE_9V, 9000U);
+        } else if (!dp_high && (dm == 1U)) {
+            setMode(SIM_MODE_12V, 12000U);
+        } else if (dp_high && (dm == 2U)) {
+            if (_type == SIM_QC3B) {
+                setMode(SIM_MODE_20V, 20000U);
+            }
+        } else if (!dp_high && (dm == 2U)) {
+            if (_mode != SIM_MODE_CONT) {
+                // 現在の電圧から可変モードを開始
+                _mode = SIM_MODE_CONT;
+            }
+        }
+    }
+
+    /**
+     * @brief 固定電圧モードの設定
+     * @param mode 出力モード（SIM_MODE）
+     * @param mV 出力電圧（mV）
+     */
+    void setMode(uint8_t mode, uint16_t mV) {
+        _mode = mode;
+        _vbus_target = mV;
+    }
+
+    /**
+     * @brief 次の状態遷移までの時間
+     * @return 時間（us、0: 予定なし）
+     */
+    uint32_t nextEventUs() const {
+        uint64_t due = 0U;
+        if ((_mode == SIM_MODE_BC12) && (_dp_line >= VTH_MV)) {
+            due = _dp_hold_us + BC_DONE_US;
+        } else if ((_mode != SIM_MODE_BC12) && (_dp_line < VTH_MV)) {
+            due = _dp_hold_us + V_CHANGE_US;
+        } else if (_mode != SIM_MODE_BC12) {
+            due = _line_us + V_CHANGE_US;
+        }
+        if (due <= _now_us) {
+            return 0U;
+        }
+        return (uint32_t)(due - _now_us);
+    }
+
+    /**
+     * @brief VBUS出力を目標値へ近づける
+     * @param us 経過時間（us）
+     */
+    void slew(uint32_t us) {
+        if (_vbus_mV == _vbus_target) {
+            _slew_rem = 0U;
+            return;
+        }
+        uint32_t diff = (_vbus_mV < _vbus_target) ?
+            (uint32_t)(_vbus_target - _vbus_mV) : (uint32_t)(_vbus_mV - _vbus_target);
+        uint32_t step = diff;
+        if (_slew_mV_per_ms > 0U) {
+            const uint64_t amount = (uint64_t)_slew_mV_per_ms * us + _slew_rem;
+            const uint64_t mV = amount / 1000U;
+            _slew_rem = (uint32_t)(amount % 1000U);
+            if (mV < step) {
+                step = (uint32_t)mV;
+            }
+        }
+        if (_vbus_mV < _vbus_target) {
+            _vbus_mV = (uint16_t)(_vbus_mV + step);
+        } else {
+            _vbus_mV = (uint16_t)(_vbus_mV - step);
+        }
+    }
+};
+
+#endif // ESP32_QC3_SIMCHARGER_H
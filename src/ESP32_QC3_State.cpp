@@ -0,0 +1,297 @@
+/**
+ * @file ESP32_QC3_State.cpp
+ * @brief ESP32_QC3_CTLの制御状態の保存と高速復帰
+ * 
+ * 検出結果（ホストタイプ・Class A/B）と最後に要求した電圧プロファイルを
+ * NVS（Preferences）へ保存します。startResume()は前回QC3だった場合、
+ * BC1.2ハンドシェイク後のClass B判定（20V印加）を省略して前回の電圧へ
+ * 直接戻すため、リセットやブラウンアウトからの復帰が短くなります。
+ * 充電器を取り替えた場合に前回の電圧（最大20V）を別の充電器へ要求しないよう、
+ * 5V出力時のVBUSとClass A/Bを照合し、一致しなければ通常の判定を行います。
+ */
+
+#include "ESP32_QC3_CTL.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+ #include <Preferences.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+static const char *QC3_STATE_NAMESPACE = "qc3state";  ///< NVSの名前空間
+static const char *QC3_STATE_KEY = "state";           ///< NVSのキー
+#endif
+static const uint16_t QC3_STATE_MAGIC = 0x51C5U;      ///< 保存データの識別子
+static const uint8_t QC3_STATE_VERSION = 2U;          ///< 保存データの版数
+static const uint16_t QC3_RESUME_V5_TOL_MV = 150U;    ///< 同じ充電器とみなす5V出力時のVBUSの差（mV）
+
+/**
+ * @brief NVSへ保存するデータ形式
+ */
+struct QC3StateRecord {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    ESP32_QC3_CTL::SavedState state;
+};
+
+/**
+ * @brief 現在の制御状態の取得（saveState()で保存される内容）
+ * @param state 取得先
+ */
+void ESP32_QC3_CTL::getState(SavedState *state) {
+    memset(state, 0, sizeof(SavedState));
+    state->host_type = _host_type;
+    state->qc_mode = _qc_mode;
+    state->class_b = _use_class_b;
+    state->output = _is_on;
+    state->voltage = (_qc_mode == QC_VAR) ? getVarTarget() : _vbus_val;
+    state->v5_mV = (_host_type == QC3) ? _cap.v5_mV : 0U;
+}
+
+/**
+ * @brief 制御状態をNVSへ保存
+ * @return 保存結果（true: 成功または変更なし, false: 失敗またはESP32以外）
+ * @note 保存済みの内容と同じ場合は書き込まない
+ */
+bool ESP32_QC3_CTL::saveState() {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3StateRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = QC3_STATE_MAGIC;
+    rec.version = QC3_STATE_VERSION;
+    getState(&rec.state);
+
+    Preferences prefs;
+    if (!prefs.begin(QC3_STATE_NAMESPACE, false)) {
+        return false;
+    }
+    QC3StateRecord old;
+    if ((prefs.getBytes(QC3_STATE_KEY, &old, sizeof(old)) == sizeof(old)) &&
+        (memcmp(&old, &rec, sizeof(rec)) == 0)) {
+        prefs.end();
+        return true;
+    }
+    const size_t written = prefs.putBytes(QC3_STATE_KEY, &rec, sizeof(rec));
+    prefs.end();
+    return written == sizeof(rec);
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 制御状態をNVSから読み込み
+ * @param state 読み込み先
+ * @return 読み込み結果（true: 成功, false: 未保存または失敗）
+ */
+bool ESP32_QC3_CTL::loadState(SavedState *state) {
+#if defined(ARDUINO_ARCH_ESP32)
+    QC3StateRecord rec;
+    Preferences prefs;
+    if (!prefs.begin(QC3_STATE_NAMESPACE, true)) {
+        return false;
+    }
+    const size_t len = prefs.getBytes(QC3_STATE_KEY, &rec, sizeof(rec));
+    prefs.end();
+    if ((len != sizeof(rec)) || (rec.magic != QC3_STATE_MAGIC) || (rec.version != QC3_STATE_VERSION)) {
+        return false;
+    }
+    *state = rec.state;
+    return true;
+#else
+    (void)state;
+    return false;
+#endif
+}
+
+/**
+ * @brief NVSに保存した制御状態の削除
+ * @return 削除結果（true: 成功, false: 失敗またはESP32以外）
+ */
+bool ESP32_QC3_CTL::clearState() {
+#if defined(ARDUINO_ARCH_ESP32)
+    Preferences prefs;
+    if (!prefs.begin(QC3_STATE_NAMESPACE, false)) {
+        return false;
+    }
+    const bool ret = prefs.clear();
+    prefs.end();
+    return ret;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 制御状態の自動保存設定
+ * @param enable true: 検出結果・電圧モード・出力の変更をpollSave()で保存
+ * @param delay_ms 最後の変更から保存までの待ち時間（ms）
+ */
+void ESP32_QC3_CTL::setAutoSave(bool enable, uint32_t delay_ms) {
+    _auto_save = enable;
+    _save_delay_ms = delay_ms;
+    _save_dirty = false;
+    getState(&_save_last);
+}
+
+/**
+ * @brief 自動保存の処理
+ * @return true: 保存した
+ */
+bool ESP32_QC3_CTL::pollSave() {
+    return pollSave(_hal->millis());
+}
+
+/**
+ * @brief 自動保存の処理（時刻指定）
+ * @param now_ms 現在時刻（ms）
+ * @return true: 保存した
+ * @note 検出中と可変モードのパルス出力中は保存しない（NVS書き込み中はフラッシュへのアクセスが止まるため）。
+ *       抜き差し監視で切断中の状態も保存しない（切断前の状態を残す）。
+ *       充電器の能力判定の記録もここで保存する
+ */
+bool ESP32_QC3_CTL::pollSave(uint32_t now_ms) {
+    if (_cap_dirty && !isDetecting() && !isVarBusy()) {
+        _cap_dirty = false;
+        (void)saveCapabilityCache();
+    }
+    if (!_save_dirty || isDetecting() || isVarBusy() ||
+        (_hp_state == HOTPLUG_DETACHED) || (_hp_state == HOTPLUG_SETTLE)) {
+        return false;
+    }
+    if ((uint32_t)(now_ms - _save_ts) < _save_delay_ms) {
+        return false;
+    }
+    _save_dirty = false;
+    return saveState();
+}
+
+/**
+ * @brief 変更の記録（自動保存が有効な場合のみ）
+ * @note 保存する内容が前回の記録と同じ場合は保存までの待ち時間を延長しない
+ *       （同じ設定を周期的に書き込むスケッチでも保存されるようにする）
+ */
+void ESP32_QC3_CTL::markStateDirty() {
+    if (!_auto_save) {
+        return;
+    }
+    SavedState state;
+    getState(&state);
+    if (memcmp(&state, &_save_last, sizeof(state)) == 0) {
+        return;
+    }
+    _save_last = state;
+    _save_dirty = true;
+    _save_ts = _hal->millis();
+}
+
+/**
+ * @brief NVSの制御状態を使った検出の開始
+ * @param restore_output true: 出力ON/OFFも復元
+ * @return true: 前回QC3を検出済み（高速復帰）, false: 通常の検出を開始
+ */
+bool ESP32_QC3_CTL::startResume(bool restore_output) {
+    SavedState state;
+    if (!loadState(&state)) {
+        startDetect();
+        return false;
+    }
+    return startResume(state, restore_output);
+}
+
+/**
+ * @brief 指定した制御状態を使った検出の開始
+ * @param state 前回の制御状態
+ * @param restore_output true: 出力ON/OFFも復元
+ * @return true: stateがQC3（高速復帰）, false: 通常の検出を開始
+ * @note BC1.2のハンドシェイクは省略できないため、QC3の再検出までは通常の検出と同じ時間がかかる。
+ *       ハンドシェイク後にmatchResumeCharger()で前回と同じ充電器か確認する
+ */
+bool ESP32_QC3_CTL::startResume(const SavedState &state, bool restore_output) {
+    startDetect();
+    if ((state.host_type != QC3) || (state.qc_mode > QC_VAR)) {
+        return false;
+    }
+    _resume_state = state;
+    _resume_output = restore_output;
+    _resume_pending = true;
+    return true;
+}
+
+/**
+ * @brief NVSの制御状態を使った検出（ブロッキング）
+ * @param restore_output true: 出力ON/OFFも復元
+ * @return ホストタイプ（BC_NA, BC_DCP, QC3）
+ */
+uint8_t ESP32_QC3_CTL::resume(bool restore_output) {
+    (void)startResume(restore_output);
+    while (pollDetect() != DETECT_DONE) {
+        _hal->delay(1);
+    }
+    return _host_type;
+}
+
+/**
+ * @brief 直前の検出で前回の状態を復元したかどうか
+ * @return true: 復元した（Class B判定は前回の結果）
+ */
+bool ESP32_QC3_CTL::isResumed() {
+    return _resumed;
+}
+
+/**
+ * @brief 接続中の充電器が前回の状態を保存した充電器と一致するかどうか
+ * @return true: 一致（前回の状態を復元する）
+ * @note beginCapability()の後に呼び出す。5V出力時のVBUSが記録されていない状態は照合できないため不一致とする。
+ *       能力判定の記録に同じ識別値の充電器があれば、Class A/Bも照合する
+ */
+bool ESP32_QC3_CTL::matchResumeCharger() {
+    const SavedState &st = _resume_state;
+    if (st.v5_mV == 0U) {
+        return false;
+    }
+    const int32_t diff = (int32_t)_cap.v5_mV - (int32_t)st.v5_mV;
+    if ((diff > (int32_t)QC3_RESUME_V5_TOL_MV) || (diff < -(int32_t)QC3_RESUME_V5_TOL_MV)) {
+        return false;
+    }
+    for (uint8_t i = 0U; i < _cap_count; i++) {
+        if ((_cap_cache[i].signature == _cap.signature) && (_cap_cache[i].class_b != st.class_b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 前回の電圧プロファイルと出力の復元
+ * @return true: 完了, false: 可変モードへの移行待ち（DETECT_RESUMEで継続）
+ * @note 可変モードは目標以下で最も近い固定電圧から入り、パルス数を減らす。
+ *       切り替え途中に可変モードへ移行すると充電器が切り替え前の電圧に留まるため、
+ *       移行はpollDetect()で固定電圧の安定を待ってから行う
+ */
+bool ESP32_QC3_CTL::restoreState() {
+    const SavedState &st = _resume_state;
+    if (_resume_output) {
+        (void)setOutput(st.output);
+    }
+    _resumed = true;
+
+    if (st.qc_mode == QC_VAR) {
+        uint8_t base = QC_5V;
+        if (_use_class_b && (st.voltage >= 20000U)) {
+            base = QC_20V;
+        } else if (st.voltage >= 12000U) {
+            base = QC_12V;
+        } else if (st.voltage >= 9000U) {
+            base = QC_9V;
+        }
+        (void)set_VBUS(base);
+        return false;
+    }
+    if ((st.qc_mode == QC_20V) && !_use_class_b) {
+        (void)set_VBUS(QC_12V);
+    } else {
+        (void)set_VBUS(st.qc_mode);
+    }
+    return true;
+}
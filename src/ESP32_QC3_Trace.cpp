@@ -0,0 +1,160 @@
+/**
+ * @file ESP32_QC3_Trace.cpp
+ * @brief ESP32_QC3_CTLのイベントトレース実装
+ * 
+ * QC3_TRACE_ENABLE=0（既定）の場合は記録処理もバッファも含まず、
+ * 読み出し系のAPIは空の結果を返します。
+ * バッファはここで確保するため、ESP32_QC3_CTLの配置はQC3_TRACE_ENABLE/QC3_TRACE_LENに依存しません
+ * （値はライブラリのビルド時のものが使われます）。
+ */
+
+#include "ESP32_QC3_CTL.h"
+#include <new>
+
+#if QC3_TRACE_ENABLE
+/**
+ * @brief ESP32_QC3_CTLが保持するトレースバッファ
+ */
+struct QC3TraceStore {
+    QC3TraceBuffer<QC3_TRACE_LEN> buf;  ///< トレースイベント
+};
+#endif
+
+/**
+ * @brief トレースバッファの確保（QC3_TRACE_ENABLE=0ではNULL）
+ */
+void ESP32_QC3_CTL::initTrace() {
+#if QC3_TRACE_ENABLE
+    _trace = new (std::nothrow) QC3TraceStore();
+#else
+    _trace = NULL;
+#endif
+}
+
+/**
+ * @brief デストラクタ（トレース用のバッファを解放）
+ */
+ESP32_QC3_CTL::~ESP32_QC3_CTL() {
+#if QC3_TRACE_ENABLE
+    delete _trace;
+#endif
+    _trace = NULL;
+}
+
+/**
+ * @brief 記録済みトレースイベントを古い順に取得
+ * @param events 取得先
+ * @param max_events 取得先の要素数
+ * @return 取得したイベント数
+ */
+uint16_t ESP32_QC3_CTL::readTrace(QC3TraceEvent *events, uint16_t max_events) {
+#if QC3_TRACE_ENABLE
+    if (_trace == NULL) {
+        return 0U;
+    }
+    const uint32_t head = _trace->buf.total();
+    uint32_t pos = _trace->buf.oldest();
+    if ((head - pos) > max_events) {
+        pos = head - max_events;
+    }
+    uint16_t n = 0U;
+    for (; pos < head; pos++) {
+        if (_trace->buf.read(pos, &events[n])) {
+            n++;
+        }
+    }
+    return n;
+#else
+    (void)events;
+    (void)max_events;
+    return 0U;
+#endif
+}
+
+/**
+ * @brief トレースイベントの破棄
+ */
+void ESP32_QC3_CTL::clearTrace() {
+#if QC3_TRACE_ENABLE
+    if (_trace != NULL) {
+        _trace->buf.clear();
+    }
+#endif
+}
+
+/**
+ * @brief トレースイベント種別の名前
+ * @param event イベント種別（TRACE_EVENT）
+ * @return 名前
+ */
+const char *ESP32_QC3_CTL::traceEventName(uint8_t event) {
+    switch (event) {
+        case TRACE_DP: return "dp";
+        case TRACE_DM: return "dm";
+        case TRACE_VBUS_MODE: return "vbus_mode";
+        case TRACE_VAR_PULSE: return "var_pulse";
+        case TRACE_ADC: return "adc";
+        case TRACE_DETECT: return "detect";
+        case TRACE_DETECT_DONE: return "detect_done";
+        case TRACE_REG: return "reg";
+        case TRACE_OUTPUT: return "output";
+        case TRACE_CMD: return "cmd";
+        case TRACE_HOTPLUG: return "hotplug";
+        case TRACE_FAULT: return "fault";
+        default: return "unknown";
+    }
+}
+
+#if defined(ARDUINO)
+/**
+ * @brief トレースイベントをCSV（ts_us,event,arg,value）で出力
+ * @param out 出力先（Serial等）
+ * @return 出力したイベント数
+ */
+size_t ESP32_QC3_CTL::dumpTrace(Print &out) {
+    size_t n = 0U;
+    out.println("ts_us,event,arg,value");
+#if QC3_TRACE_ENABLE
+    if (_trace == NULL) {
+        return n;
+    }
+    // 出力中に上書きされたイベントは読み飛ばす
+    const uint32_t head = _trace->buf.total();
+    QC3TraceEvent ev;
+    for (uint32_t pos = _trace->buf.oldest(); pos < head; pos++) {
+        if (!_trace->buf.read(pos, &ev)) {
+            continue;
+        }
+        out.printf("%lu,%s,%u,%ld\n", (unsigned long)ev.ts_us,
+            traceEventName(ev.event), (unsigned)ev.arg, (long)ev.value);
+        n++;
+    }
+#endif
+    return n;
+}
+#endif
+
+/**
+ * @brief トレースイベントの記録
+ * @param event イベント種別（TRACE_EVENT）
+ * @param arg 引数
+ * @param value 値
+ */
+void ESP32_QC3_CTL::traceEvent(uint8_t event, uint16_t arg, int32_t value) {
+#if QC3_TRACE_ENABLE
+    if (_trace == NULL) {
+        return;
+    }
+    QC3TraceEvent ev;
+    ev.ts_us = _hal->micros();
+    ev.event = event;
+    ev.reserved = 0U;
+    ev.arg = arg;
+    ev.value = value;
+    _trace->buf.push(ev);
+#else
+    (void)event;
+    (void)arg;
+    (void)value;
+#endif
+}
@@ -0,0 +1,121 @@
+/**
+ * @file ESP32_QC3_Trace.h
+ * @brief イベントトレース用のロックフリーなリングバッファ
+ *
+ * QC3_TRACE_ENABLEを1にしてビルドした場合のみ、ESP32_QC3_CTLが端子操作・
+ * パルス・ADC読み取り・検出段階等をusタイムスタンプ付きで記録します。
+ * 0（既定）の場合はQC3_TRACE()が空に展開され、引数の評価も含めて処理は残りません。
+ * バッファが一周すると古いイベントから上書きします。
+ */
+
+#ifndef ESP32_QC3_TRACE_H
+#define ESP32_QC3_TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+
+#ifndef QC3_TRACE_ENABLE
+ #define QC3_TRACE_ENABLE 0   ///< 1: トレースを有効化
+#endif
+
+#ifndef QC3_TRACE_LEN
+ #define QC3_TRACE_LEN 256    ///< 保持するイベント数（2のべき乗）
+#endif
+
+#if QC3_TRACE_ENABLE
+ #define QC3_TRACE(ev, arg, val) traceEvent((uint8_t)(ev), (uint16_t)(arg), (int32_t)(val))
+#else
+ #define QC3_TRACE(ev, arg, val) ((void)0)
+#endif
+
+struct QC3TraceStore;  ///< ESP32_QC3_CTLが保持するトレースバッファ（ESP32_QC3_Trace.cppで定義）
+
+/**
+ * @brief トレースイベント
+ */
+struct QC3TraceEvent {
+    uint32_t ts_us;   ///< タイムスタンプ（us）
+    uint8_t event;    ///< イベント種別
+    uint8_t reserved;
+    uint16_t arg;     ///< 引数（ピン番号・状態等）
+    int32_t value;    ///< 値（電圧・所要時間等）
+};
+
+/**
+ * @brief トレースイベントのリングバッファ（複数の書き込み元に対応）
+ * @tparam N 保持するイベント数（2のべき乗）
+ * @note 書き込みはスロットの確保をfetch_addで行い、完了後にシーケンス番号を公開する。
+ *       読み出し側はシーケンス番号の一致で上書き途中のイベントを除外する。
+ */
+template <uint16_t N>
+class QC3TraceBuffer {
+    static_assert((N >= 2U) && ((N & (N - 1U)) == 0U), "trace length must be a power of two");
+
+public:
+    QC3TraceBuffer() {
+        clear();
+    }
+
+    /**
+     * @brief 全イベントの破棄
+     */
+    void clear() {
+        for (uint16_t i = 0U; i < N; i++) {
+            _seq[i].store(0U, std::memory_order_relaxed);
+        }
+        _head.store(0U, std::memory_order_release);
+    }
+
+    /**
+     * @brief イベントの記録
+     * @param ev イベント
+     */
+    void push(const QC3TraceEvent &ev) {
+        const uint32_t pos = _head.fetch_add(1U, std::memory_order_relaxed);
+        const uint16_t idx = (uint16_t)(pos & (N - 1U));
+        _seq[idx].store(0U, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _buf[idx] = ev;
+        _seq[idx].store(pos + 1U, std::memory_order_release);
+    }
+
+    /**
+     * @brief 記録済みイベントの総数（上書き分を含む）
+     * @return イベント数
+     */
+    uint32_t total() const {
+        return _head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 古い順にイベントを読み出す
+     * @param pos 読み出し位置（total()の通し番号）
+     * @param ev 読み出し先
+     * @return 読み出し結果（true: 成功, false: 上書き済みまたは書き込み途中）
+     */
+    bool read(uint32_t pos, QC3TraceEvent *ev) const {
+        const uint16_t idx = (uint16_t)(pos & (N - 1U));
+        if (_seq[idx].load(std::memory_order_acquire) != (pos + 1U)) {
+            return false;
+        }
+        *ev = _buf[idx];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return _seq[idx].load(std::memory_order_relaxed) == (pos + 1U);
+    }
+
+    /**
+     * @brief 保持しているうち最も古いイベントの通し番号
+     * @return 通し番号
+     */
+    uint32_t oldest() const {
+        const uint32_t head = total();
+        return (head > N) ? (head - N) : 0U;
+    }
+
+private:
+    QC3TraceEvent _buf[N];
+    std::atomic<uint32_t> _seq[N];
+    std::atomic<uint32_t> _head;
+};
+
+#endif // ESP32_QC3_TRACE_H